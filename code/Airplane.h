@@ -3,6 +3,7 @@
 #include <string>
 #include <sstream>
 #include "Seat.h"
+#include "RecordFile.h"
 #ifndef AIRPLANE_H
 #define AIRPLANE_H
 
@@ -60,78 +61,178 @@ class Airplane : public SaveItem {
         dimensions = vec;
     }
 
+    /// @brief Seats a group of travellers would like to have among theirs
+    enum SeatPreference { ANY_SEAT, WINDOW_SEAT, AISLE_SEAT };
+
+    /// @brief Widths of the blocks of seats between the aisles of a category, from its number of columns like the usual cabins (3-3, 2-4-2, 3-4-3...)
+    /// @param cols Columns of the category as in the dimensions of the plane
+    /// @return Block widths from the first column on
+    static vector<int> seatBlocks(int cols) {
+        static const vector<vector<int>> layouts = {{}, {1}, {1, 1}, {1, 2}, {2, 2}, {2, 3}, {3, 3}, {2, 3, 2}, {2, 4, 2}, {3, 3, 3}, {3, 4, 3}};
+        if (cols <= 0)
+            return {};
+        if (cols < (int) layouts.size())
+            return layouts[cols];
+        // Wider cabins get three seats by each window and one or two blocks in the middle
+        int middle = cols - 6;
+        if (middle <= 5)
+            return {3, middle, 3};
+        return {3, middle / 2, middle - middle / 2, 3};
+    }
+
+    /// @brief Columns by a window, bit c set for column c
+    static uint64_t windowColumns(int cols) {
+        if (cols <= 0)
+            return 0;
+        return 1ULL | (1ULL << (min(cols, 64) - 1));
+    }
+
+    /// @brief Columns next to an aisle, bit c set for column c
+    static uint64_t aisleColumns(int cols) {
+        uint64_t aisles = aisleGaps(cols);
+        return aisles | (aisles << 1);
+    }
+
+    /// @brief Aisles between two columns, bit c set if an aisle runs between column c and column c + 1
+    static uint64_t aisleGaps(int cols) {
+        vector<int> blocks = seatBlocks(cols);
+        uint64_t gaps = 0;
+        for (int i = 0, col = 0; i + 1 < blocks.size(); i++) {
+            col += blocks[i];
+            if (col <= 64)
+                gaps |= 1ULL << (col - 1);
+        }
+        return gaps;
+    }
+
     // Getter Functions
     string getID() const { return ID; }
+    string getModel() const { return model; }
     int getNumCategories() const { return num_categories; }
     vector<vector<int>> getDimensions() const { return dimensions; }
 
+    /// @brief Fills in the fixed-width snapshot entry of the plane
+    /// @param entry Entry to fill
+    /// @param dimensions_pool Pool the [rows, columns] pairs are appended to
+    /// @return False if the plane does not fit in a snapshot entry
+    bool toSnapshot(PlaneEntry &entry, vector<uint16_t> &dimensions_pool) const {
+        entry = PlaneEntry();
+        if (ID.empty() || ID.find_first_not_of("0123456789") != string::npos || !copyField(entry.model, sizeof(entry.model), model))
+            return false;
+        entry.ID = stoul(ID);
+        entry.num_categories = num_categories;
+        entry.dimensions_offset = dimensions_pool.size() / 2;
+        for (int i = 0; i < num_categories; i++) {
+            dimensions_pool.push_back(dimensions[i][0]);
+            dimensions_pool.push_back(dimensions[i][1]);
+        }
+        return true;
+    }
+
     /// @brief Implementation of abstract function in SaveItem class. Used to save the plane object to a file
     /// @return True if the writing process was a success, false otherwise
     bool save() {
-        ofstream writer;
-        writer.open(save_path, std::ios_base::app);
-        if (writer.fail()) {
+        vector<string> fields = {ID, model, to_string(num_categories)};
+        for (int i = 0; i < dimensions.size(); i++) {
+            fields.push_back(to_string(dimensions[i][0]) + ' ' + to_string(dimensions[i][1]));
+        }
+        if (!RecordFile::append(save_path, fields)) {
             cerr << "Error saving plane..." << endl;
-            writer.close();
             return false;
         }
-        writer << encrypt(ID) << ',';
-        writer << encrypt(model) << ',';
-        writer << encrypt(to_string(num_categories)) << ',';
-        for (int i = 0; i < dimensions.size(); i++) {
-            writer << encrypt(to_string(dimensions[i][0]) + ' ' + to_string(dimensions[i][1])) << ',';
-        }
-        writer << endl;
-        writer.close();
         return true;
     }
 
-    /// @brief Loads all the Airplanes into a vector from the file save_path
-    /// @return A vector of planes extracted from the files
-    static vector<Airplane> loadAll() {
-        vector<Airplane> planes;
-        ifstream reader;
-        reader.open(save_path);
-        if (reader.fail()) {
-            cerr << "Error loading planes..." << endl;
-            reader.close();
-            return vector<Airplane>();
+    /// @brief Loads the planes stored in the snapshot
+    /// @param planes Vector to add the planes to
+    /// @return Byte offset of the first line of the storage file that is not in the snapshot
+    static uint64_t loadSnapshot(vector<Airplane> &planes) {
+        TRACE_SPAN("Airplane::loadSnapshot");
+        // Planes already in the snapshot are built straight from its fixed-width entries
+        uint64_t resume_offset;
+        Snapshot &snapshot = Snapshot::get();
+        if (snapshot.covers(AIRPLANES_CSV, save_path, resume_offset)) {
+            uint64_t count, dimensions_count;
+            const PlaneEntry* entries = snapshot.entries<PlaneEntry>(PLANES, count);
+            const uint16_t* dimensions_pool = snapshot.entries<uint16_t>(DIMENSIONS, dimensions_count);
+            size_t first = planes.size();
+            for (uint64_t i = 0; i < count; i++) {
+                if (entries[i].dimensions_offset + (uint64_t) entries[i].num_categories > dimensions_count) {
+                    cerr << "Snapshot out of date, reading all planes..." << endl;
+                    while (planes.size() > first)
+                        planes.pop_back();
+                    return 0;
+                }
+                vector<vector<int>> dimensions;
+                for (uint32_t c = 0; c < entries[i].num_categories; c++) {
+                    const uint16_t* pair = dimensions_pool + 2 * (entries[i].dimensions_offset + c);
+                    dimensions.push_back({pair[0], pair[1]});
+                }
+                planes.push_back(Airplane(to_string(entries[i].ID), readField(entries[i].model, sizeof(entries[i].model)), entries[i].num_categories, dimensions));
+            }
         }
-        string temp;
-        num_planes = 0;
-        // csv file read line by line then with commas as delimiters
-        while (getline(reader, temp)) {
-            num_planes++;
+        return resume_offset;
+    }
+
+    /// @brief Builds planes from the plain text of the storage file
+    /// @param plain Records as read by RecordFile::readPlain
+    /// @param planes Vector to add the planes to
+    /// @return Number of records read, including skipped ones
+    static int parseRecords(string_view plain, vector<Airplane> &planes) {
+        TRACE_SPAN("Airplane::parseRecords");
+        int count = 0;
+        // Each line holds the ID, model, category count and then the dimensions of every category
+        Tokenizer lines(plain, RecordFile::record_separator);
+        string_view line, dimension;
+        while (lines.next(line)) {
+            if (line.empty())
+                continue;
+            count++;
+            Tokenizer fields(line, RecordFile::field_separator);
             string ID, model;
             int num_categories;
             vector<vector<int>> dimensions;
-            stringstream s_stream(temp);
-            getline(s_stream, temp, ',');
-            ID = decrypt(temp);
-            getline(s_stream, temp, ',');
-            model = decrypt(temp);
-            getline(s_stream, temp, ',');
-            temp = decrypt(temp);
-            num_categories = stoi(temp);
-            for (int i = 0; i < num_categories; i++) {
-                getline(s_stream, temp, ',');
-                temp = decrypt(temp);
-
-                stringstream s_stream2(temp);
-                vector<int> temp_vec;
-                s_stream2 >> temp;
-                temp_vec.push_back(stoi(temp));
-                s_stream2 >> temp;
-                temp_vec.push_back(stoi(temp));
-
+            bool complete = fields.nextString(ID) && fields.nextString(model) && fields.nextInt(num_categories);
+            for (int i = 0; complete && i < num_categories; i++) {
+                vector<int> temp_vec(2);
+                complete = fields.next(dimension);
+                Tokenizer numbers(dimension, ' ');
+                complete = complete && numbers.nextInt(temp_vec[0]) && numbers.nextInt(temp_vec[1]);
                 dimensions.push_back(temp_vec);
             }
+            if (!complete) {
+                cerr << "Skipping incomplete plane..." << endl;
+                continue;
+            }
             planes.push_back(Airplane(ID, model, num_categories, dimensions));
         }
-        reader.close();
+        return count;
+    }
+
+    /// @brief Loads all the Airplanes into a vector from the file save_path
+    /// @return A vector of planes extracted from the files
+    static vector<Airplane> loadAll() {
+        STATS_TIMER(LOAD_PLANES);
+        TRACE_SPAN("Airplane::loadAll", save_path.c_str());
+        vector<Airplane> planes;
+        uint64_t resume_offset = loadSnapshot(planes);
+        num_planes = planes.size();
+        string plain;
+        if (!RecordFile::readPlain(save_path, resume_offset, plain)) {
+            cerr << "Error loading planes..." << endl;
+            num_planes = 0;
+            return vector<Airplane>();
+        }
+        num_planes += parseRecords(plain, planes);
         return planes;
     }
 
+    /// @brief Sets the number of planes after they were loaded without loadAll
+    static void setCount(int count) { num_planes = count; }
+
+    /// @brief Gives the path of the storage file
+    static string getSavePath() { return save_path; }
+
     /// @brief Prints Airplane details
     void print_details() {
         cout << "ID: " << ID << " | Model: " << model << " | Category count: " << num_categories << endl;
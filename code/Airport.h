@@ -1,5 +1,7 @@
 #include <iostream>
 #include <string>
+#include <string_view>
+#include <cstdint>
 #ifndef AIRPORT_H
 #define AIRPORT_H
 
@@ -9128,7 +9130,7 @@ namespace AirportInfo {
     };
 
     /// @brief Corresponding string value of each Airport enum
-    const char* airport_to_string[] {
+    constexpr const char* airport_to_string[] {
         stringify( AAA ),
         stringify( AAB ),
         stringify( AAC ),
@@ -18246,30 +18248,74 @@ namespace AirportInfo {
         return airport_to_string[airport];
     }
 
-    /// @brief Binary search to find the string that matches the enum name to convert string to Enum.
-    /// @param str String to find
-    /// @param low Left hand bound of search
-    /// @param high Right hand bound of search
-    /// @return The Airport value corresponding with the string
-    Airport binarySearch(string str, int low, int high) {
-        if (low > high)
-            return (Airport) 0; 
-        else {
-            int mid = (low + high) / 2;
-            if (str == Airport_to_String((Airport) mid))
-                return (Airport)mid;
-            else if (str > Airport_to_String((Airport) mid))    // str is on the right side
-                return binarySearch(str, mid + 1, high);
-            else                        // str is on the left side
-                return binarySearch(str, low, mid - 1);
+    /// @brief Number of possible three letter codes (26^3)
+    const int code_count = 26 * 26 * 26;
+    /// @brief Marks codes in the code table that are not a known airport
+    const uint16_t no_airport = 0xFFFF;
+    /// @brief Most codes with a digit (e.g. SB2) the code table can hold
+    const int max_digit_codes = 8;
+
+    /// @brief Converts a code of three uppercase letters to its base-26 value
+    /// @param code Characters of the code
+    /// @return Value below code_count or -1 if the code is not three uppercase letters
+    constexpr int codeValue(const char* code) {
+        int value = 0;
+        for (int i = 0; i < 3; i++) {
+            if (code[i] < 'A' || code[i] > 'Z')
+                return -1;
+            value = value * 26 + (code[i] - 'A');
         }
+        return code[3] == '\0' ? value : -1;
     }
 
-    /// @brief Converts the given string to Airport Enum
+    /// @brief Direct lookup table from code value to Airport, and the few codes containing digits that cannot be in it
+    struct CodeTable {
+        uint16_t airport[code_count];
+        uint16_t digit_codes[max_digit_codes];
+        int num_digit_codes;
+    };
+
+    /// @brief Builds the code table from airport_to_string at compile time
+    /// @return Filled code table
+    constexpr CodeTable buildCodeTable() {
+        CodeTable table = {};
+        for (int i = 0; i < code_count; i++)
+            table.airport[i] = no_airport;
+        for (int i = 0; i < sizeof(airport_to_string) / sizeof(airport_to_string[0]); i++) {
+            int value = codeValue(airport_to_string[i]);
+            if (value >= 0)
+                table.airport[value] = i;
+            else
+                table.digit_codes[table.num_digit_codes++] = i;
+        }
+        return table;
+    }
+
+    /// @brief Code table generated by the compiler
+    constexpr CodeTable code_table = buildCodeTable();
+
+    /// @brief Converts the given string to Airport Enum in constant time
     /// @param str String to be converted
-    /// @return corresponding Airport Enum form given string
-    Airport string_to_Airport(string str) {
-        return binarySearch(str, 0, size - 1);
+    /// @param airport Set to the corresponding Airport Enum
+    /// @return False if str is not the code of any airport
+    bool string_to_Airport(string_view str, Airport &airport) {
+        if (str.length() != 3)
+            return false;
+        char code[4] = {str[0], str[1], str[2], '\0'};
+        int value = codeValue(code);
+        if (value >= 0) {
+            if (code_table.airport[value] == no_airport)
+                return false;
+            airport = (Airport) code_table.airport[value];
+            return true;
+        }
+        for (int i = 0; i < code_table.num_digit_codes; i++) {
+            if (str == airport_to_string[code_table.digit_codes[i]]) {
+                airport = (Airport) code_table.digit_codes[i];
+                return true;
+            }
+        }
+        return false;
     }
 };
 
@@ -0,0 +1,248 @@
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <cstdint>
+#include <climits>
+#include "RoaringBitmap.h"
+#include "SeatMap.h"
+#include "Airport.h"
+#include "DateTime.h"
+#ifndef AVAILABILITYINDEX_H
+#define AVAILABILITYINDEX_H
+
+using namespace std;
+using namespace AirportInfo;
+
+/// @brief Compressed bitmaps of flight handles by departure day, by origin and by availability, for questions over many flights such as
+/// "flights from DXB next week with at least 4 free seats together in category 1". A query unites and intersects bitmaps and never
+/// looks at a flight. For each category there is one bitmap per threshold level, holding the flights with at least that many free seats,
+/// and one holding the flights with at least that many adjacent free seats in one row.
+/// The index watches the seat maps of its flights: a seat change only takes the index lock when the flight crosses a level.
+class AvailabilityIndex : public SeatObserver {
+    public:
+    /// @brief Seat counts with their own bitmaps. Queries for other counts use the level below and check the flights found
+    static constexpr int levels[] = {1, 2, 3, 4, 5, 6, 7, 8, 12, 16, 24, 32, 48, 64, 128, 256};
+    static constexpr int num_levels = sizeof(levels) / sizeof(levels[0]);
+
+    /// @brief Kinds of availability bitmaps
+    enum Measure { FREE_SEATS, SEATS_TOGETHER, NUM_MEASURES };
+
+    private:
+    /// @brief Guards the bitmaps while they change
+    mutex lock;
+    unordered_map<int32_t, RoaringBitmap> by_day;
+    unordered_map<uint16_t, RoaringBitmap> by_origin;
+    /// @brief Bitmaps of each category, measure and level
+    vector<vector<RoaringBitmap>> by_level[NUM_MEASURES];
+
+    /// @brief Seat map of each watched flight, seat changes of other seat maps are ignored
+    vector<SeatMap*> seat_maps;
+    /// @brief Flight appended by a bulk build, waiting for its bitmaps
+    struct Pending {
+        int32_t day = INT32_MIN;
+        uint16_t origin = 0;
+        uint16_t categories = 0;
+    };
+    /// @brief Flights appended since the last build by handle, with day INT32_MIN where nothing was appended
+    vector<Pending> pending;
+    /// @brief Number of levels reached by each category of each flight and measure, as stored in the bitmaps.
+    /// The categories of a flight are next to each other from its first_level on
+    vector<uint8_t> reached[NUM_MEASURES];
+    vector<uint32_t> first_level;
+
+    /// @brief Number of levels a seat count reaches
+    static int levelOf(int count) {
+        int level = 0;
+        while (level < num_levels && levels[level] <= count)
+            level++;
+        return level;
+    }
+
+    static int measure(const SeatMap &seat_map, int category, Measure kind) {
+        return kind == FREE_SEATS ? seat_map.getFree(category) : seat_map.longestFreeBlock(category);
+    }
+
+    /// @brief Moves a flight between the level bitmaps of a category. The lock must be held
+    /// @return True if the flight reached a different level
+    bool updateLocked(int handle, int category, Measure kind) {
+        int level = levelOf(measure(*seat_maps[handle], category, kind));
+        uint8_t &stored = reached[kind][first_level[handle] + category];
+        if (level == stored)
+            return false;
+        vector<RoaringBitmap> &bitmaps = by_level[kind][category];
+        for (int i = level; i < stored; i++)
+            bitmaps[i].remove(handle);
+        for (int i = stored; i < level; i++)
+            bitmaps[i].add(handle);
+        __atomic_store_n(&stored, (uint8_t) level, __ATOMIC_SEQ_CST);
+        return true;
+    }
+
+    /// @brief Flights with at least a number of seats. Counts between two levels need the flights of the lower level checked
+    /// @param exact Set to false if the bitmap holds flights with fewer seats too
+    /// @return nullptr if the category has no bitmaps
+    const RoaringBitmap* findLevel(int category, Measure kind, int count, bool &exact) const {
+        int level = levelOf(count);
+        exact = level > 0 && levels[level - 1] == count;
+        if (category >= by_level[kind].size())
+            return nullptr;
+        return level == 0 ? nullptr : &by_level[kind][category][level - 1];
+    }
+
+    /// @brief Makes room for the levels of a flight, which reaches none yet. The lock must be held
+    void watchFlight(int handle, SeatMap* seat_map) {
+        if (handle >= seat_maps.size()) {
+            seat_maps.resize(handle + 1, nullptr);
+            first_level.resize(handle + 1, 0);
+        }
+        seat_maps[handle] = seat_map;
+        first_level[handle] = reached[0].size();
+        for (int kind = 0; kind < NUM_MEASURES; kind++)
+            reached[kind].resize(reached[kind].size() + seat_map->getNumCategories(), 0);
+    }
+
+    public:
+    /// @brief Forgets all flights. Their seat maps may already be gone, seat changes they still report are ignored
+    void clear() {
+        lock_guard<mutex> guard(lock);
+        by_day.clear();
+        by_origin.clear();
+        seat_maps.clear();
+        pending.clear();
+        for (int kind = 0; kind < NUM_MEASURES; kind++) {
+            by_level[kind].clear();
+            reached[kind].clear();
+        }
+        first_level.clear();
+    }
+
+    /// @brief Adds a flight during a bulk build without touching the bitmaps, build must be called before seats change or searches run
+    /// @param handle Position of the flight in the loaded flights vector
+    /// @param origin
+    /// @param departure
+    /// @param seat_map Seat map of the flight
+    void append(int handle, Airport origin, DateTime departure, SeatMap* seat_map) {
+        lock_guard<mutex> guard(lock);
+        watchFlight(handle, seat_map);
+        if (handle >= pending.size())
+            pending.resize(handle + 1);
+        pending[handle] = Pending{departure.getDayNumber(), (uint16_t) origin, (uint16_t) seat_map->getNumCategories()};
+        for (int kind = 0; kind < NUM_MEASURES; kind++) {
+            for (int c = 0; c < seat_map->getNumCategories(); c++)
+                reached[kind][first_level[handle] + c] = levelOf(measure(*seat_map, c, (Measure) kind));
+        }
+    }
+
+    /// @brief Fills the bitmaps with the flights appended by a bulk build and starts watching their seats
+    void build() {
+        lock_guard<mutex> guard(lock);
+        vector<uint32_t> handles;
+        for (uint32_t handle = 0; handle < pending.size(); handle++) {
+            if (pending[handle].day == INT32_MIN)
+                continue;
+            handles.push_back(handle);
+            by_day[pending[handle].day].add(handle);
+            by_origin[pending[handle].origin].add(handle);
+            for (int kind = 0; kind < NUM_MEASURES; kind++) {
+                while (by_level[kind].size() < pending[handle].categories)
+                    by_level[kind].emplace_back(num_levels);
+            }
+        }
+        // Each level is first set in a plain bit vector, a flight sets one bit in each level it reaches
+        for (int kind = 0; kind < NUM_MEASURES; kind++) {
+            for (int c = 0; c < by_level[kind].size(); c++) {
+                vector<vector<uint64_t>> words(num_levels, vector<uint64_t>((pending.size() + 63) / 64, 0));
+                for (uint32_t handle : handles) {
+                    if (c >= pending[handle].categories)
+                        continue;
+                    for (int level = 0; level < reached[kind][first_level[handle] + c]; level++)
+                        words[level][handle / 64] |= 1ULL << (handle % 64);
+                }
+                for (int level = 0; level < num_levels; level++)
+                    by_level[kind][c][level] = RoaringBitmap::unite(by_level[kind][c][level], RoaringBitmap::fromWords(words[level]));
+            }
+        }
+        for (uint32_t handle : handles)
+            seat_maps[handle]->watch(this, handle);
+        pending.clear();
+    }
+
+    /// @brief Adds one flight to the bitmaps and starts watching its seats. Must not run while seats of any flight are booked
+    /// @param handle Position of the flight in the loaded flights vector
+    /// @param origin
+    /// @param departure
+    /// @param seat_map Seat map of the flight
+    void add(int handle, Airport origin, DateTime departure, SeatMap* seat_map) {
+        lock_guard<mutex> guard(lock);
+        watchFlight(handle, seat_map);
+        by_day[departure.getDayNumber()].add(handle);
+        by_origin[origin].add(handle);
+        for (int kind = 0; kind < NUM_MEASURES; kind++) {
+            while (by_level[kind].size() < seat_map->getNumCategories())
+                by_level[kind].emplace_back(num_levels);
+            for (int c = 0; c < seat_map->getNumCategories(); c++)
+                updateLocked(handle, c, (Measure) kind);
+        }
+        seat_map->watch(this, handle);
+    }
+
+    /// @brief Keeps the level bitmaps of a flight up to date, called by its seat map on every seat change
+    void seatChanged(const SeatMap &seat_map, int handle, int category, int row) override {
+        if (handle < 0 || handle >= seat_maps.size() || seat_maps[handle] != &seat_map)
+            return;
+        // Most changes keep the flight on the same levels, which is checked without the lock
+        bool changed = false;
+        for (int kind = 0; kind < NUM_MEASURES && !changed; kind++)
+            changed = levelOf(measure(seat_map, category, (Measure) kind)) != __atomic_load_n(&reached[kind][first_level[handle] + category], __ATOMIC_SEQ_CST);
+        if (!changed)
+            return;
+        // Under the lock the levels are measured again until they hold, so a change racing with this one is never lost
+        lock_guard<mutex> guard(lock);
+        for (bool moved = true; moved;) {
+            moved = false;
+            for (int kind = 0; kind < NUM_MEASURES; kind++)
+                moved = updateLocked(handle, category, (Measure) kind) || moved;
+        }
+    }
+
+    /// @brief Finds the flights departing in a range of days with enough free seats
+    /// @param origin Origin airport, nullptr for any origin
+    /// @param first_day First departure day
+    /// @param days Number of departure days
+    /// @param category Category the seats must be in
+    /// @param min_free Free seats needed in the category, 0 for any
+    /// @param min_together Adjacent free seats needed in one row of the category, 0 for any
+    /// @param exact Set to false if some of the flights found may have fewer seats than asked, they must then be checked
+    /// @return Handles of the flights found, in increasing order
+    vector<uint32_t> find(const Airport* origin, DateTime first_day, int days, int category, int min_free, int min_together, bool &exact) {
+        lock_guard<mutex> guard(lock);
+        exact = true;
+        vector<const RoaringBitmap*> each_day;
+        for (int32_t day = first_day.getDayNumber(); day < first_day.getDayNumber() + days; day++) {
+            auto it = by_day.find(day);
+            if (it != by_day.end())
+                each_day.push_back(&it->second);
+        }
+        RoaringBitmap departing = RoaringBitmap::unite(each_day);
+        if (origin != nullptr) {
+            auto it = by_origin.find(*origin);
+            if (it == by_origin.end())
+                return vector<uint32_t>();
+            departing = RoaringBitmap::intersect(departing, it->second);
+        }
+        int counts[NUM_MEASURES] = {min_free, min_together};
+        for (int kind = 0; kind < NUM_MEASURES; kind++) {
+            if (counts[kind] <= 0)
+                continue;
+            bool level_exact;
+            const RoaringBitmap* enough = category < 0 ? nullptr : findLevel(category, (Measure) kind, counts[kind], level_exact);
+            if (enough == nullptr)
+                return vector<uint32_t>();
+            departing = RoaringBitmap::intersect(departing, *enough);
+            exact = exact && level_exact;
+        }
+        return departing.toVector();
+    }
+};
+
+#endif
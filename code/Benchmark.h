@@ -0,0 +1,153 @@
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <ctime>
+#include <algorithm>
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+using namespace std;
+
+/// @brief Times small operations and reports percentiles of the time per operation.
+/// Every benchmark is calibrated to a batch of calls that runs long enough for the clock, warmed up, then sampled
+/// a number of times. Results are printed as a table and can be written as JSON to compare releases.
+class Benchmark {
+    public:
+    /// @brief Timing of one benchmark, in nanoseconds per operation
+    struct Result {
+        string name;
+        /// @brief Calls per sample
+        long batch;
+        /// @brief Time per call of every sample, sorted
+        vector<double> samples;
+        double mean;
+
+        /// @brief Percentile of the samples with linear interpolation
+        /// @param p 0 to 100
+        double percentile(double p) const {
+            if (samples.empty())
+                return 0;
+            double position = p / 100 * (samples.size() - 1);
+            size_t below = (size_t) position;
+            if (below + 1 >= samples.size())
+                return samples.back();
+            return samples[below] + (samples[below + 1] - samples[below]) * (position - below);
+        }
+    };
+
+    private:
+    /// @brief Name of the suite in the report
+    string suite;
+    /// @brief Samples run and thrown away before measuring
+    int warmup;
+    /// @brief Samples measured
+    int repetitions;
+    /// @brief Shortest time of one sample, so the clock resolution does not matter
+    chrono::nanoseconds min_sample_time;
+    vector<Result> results;
+
+    /// @brief Times one batch of calls
+    template <class F>
+    static double timeBatch(F &operation, long batch) {
+        auto start = chrono::steady_clock::now();
+        for (long i = 0; i < batch; i++)
+            operation();
+        return chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+    }
+
+    /// @brief Escapes a string for JSON
+    static string quote(const string &str) {
+        string quoted = "\"";
+        for (char c : str) {
+            if (c == '"' || c == '\\')
+                quoted += '\\';
+            quoted += c;
+        }
+        return quoted + '"';
+    }
+
+    public:
+    /// @brief Creates an empty suite
+    /// @param suite Name of the suite
+    /// @param warmup Samples thrown away before measuring
+    /// @param repetitions Samples measured
+    /// @param min_sample_time Shortest time of one sample
+    Benchmark(string suite, int warmup = 5, int repetitions = 30, chrono::nanoseconds min_sample_time = chrono::milliseconds(2))
+        : suite(suite), warmup(warmup), repetitions(max(1, repetitions)), min_sample_time(min_sample_time) {}
+
+    /// @brief Keeps the compiler from optimizing away a value that is computed but not used
+    template <class T>
+    static void keep(T const &value) {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+
+    /// @brief Measures an operation and adds it to the results
+    /// @param name Name of the benchmark
+    /// @param operation Called once per operation. Results should be passed to keep()
+    /// @return The result
+    template <class F>
+    const Result& run(const string &name, F operation) {
+        // Double the batch until one batch takes long enough to time
+        long batch = 1;
+        while (timeBatch(operation, batch) < min_sample_time.count() && batch < (1L << 40))
+            batch *= 2;
+        for (int i = 0; i < warmup; i++)
+            timeBatch(operation, batch);
+        Result result = {name, batch, {}, 0};
+        for (int i = 0; i < repetitions; i++) {
+            result.samples.push_back(timeBatch(operation, batch) / batch);
+            result.mean += result.samples.back() / repetitions;
+        }
+        sort(result.samples.begin(), result.samples.end());
+        results.push_back(result);
+        print(cout, results.back());
+        return results.back();
+    }
+
+    /// @brief Prints the header of the results table
+    void printHeader(ostream &out) const {
+        out << suite << " (" << warmup << " warmup, " << repetitions << " samples, ns per operation)" << endl;
+        out << left << setw(40) << "benchmark" << right << setw(12) << "min" << setw(12) << "p50" << setw(12) << "p90" << setw(12) << "p99" << setw(12) << "mean" << endl;
+    }
+
+    /// @brief Prints one line of the results table
+    static void print(ostream &out, const Result &result) {
+        out << left << setw(40) << result.name << right << fixed << setprecision(1)
+            << setw(12) << result.samples.front() << setw(12) << result.percentile(50) << setw(12) << result.percentile(90)
+            << setw(12) << result.percentile(99) << setw(12) << result.mean << endl;
+    }
+
+    /// @brief Writes all results as JSON
+    void writeJSON(ostream &out) const {
+        time_t now = time(nullptr);
+        char timestamp[32];
+        strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+        out << "{" << endl;
+        out << "  \"suite\": " << quote(suite) << "," << endl;
+        out << "  \"timestamp\": " << quote(timestamp) << "," << endl;
+#ifdef __VERSION__
+        out << "  \"compiler\": " << quote(__VERSION__) << "," << endl;
+#endif
+        out << "  \"warmup\": " << warmup << "," << endl;
+        out << "  \"repetitions\": " << repetitions << "," << endl;
+        out << "  \"unit\": \"ns/op\"," << endl;
+        out << "  \"results\": [" << endl;
+        out << fixed << setprecision(3);
+        for (int i = 0; i < results.size(); i++) {
+            const Result &result = results[i];
+            out << "    {\"name\": " << quote(result.name) << ", \"batch\": " << result.batch
+                << ", \"min\": " << result.samples.front() << ", \"p50\": " << result.percentile(50) << ", \"p90\": " << result.percentile(90)
+                << ", \"p99\": " << result.percentile(99) << ", \"max\": " << result.samples.back() << ", \"mean\": " << result.mean
+                << ", \"ops_per_second\": " << (result.percentile(50) > 0 ? 1e9 / result.percentile(50) : 0) << "}" << (i + 1 < results.size() ? "," : "") << endl;
+        }
+        out << "  ]" << endl << "}" << endl;
+    }
+
+    // Getter functions
+    const vector<Result>& getResults() const { return results; }
+};
+
+#endif
@@ -0,0 +1,339 @@
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <mutex>
+#include <unordered_map>
+#include "Flight.h"
+#ifndef BOOKING_H
+#define BOOKING_H
+
+using namespace std;
+
+/// @brief The booking path shared by the client interface and the booking benchmark.
+/// A booking has three phases: finding the seat, reserving it in the seat map and persisting it
+/// (the record line, the seat's journal entry and, once enough entries piled up, a checkpoint of Flights.csv).
+/// A booking that cannot be persisted is rolled back in the seat map, so no booking exists only in memory.
+/// Bookings may run on several threads: the seat is won with an atomic operation on the seat map, record IDs are allocated
+/// atomically and the only lock on the way is the short one around adding to the loaded records.
+namespace Booking {
+
+    /// @brief Outcome of a booking
+    enum Result { BOOKED, NO_SUCH_SEAT, ALREADY_RESERVED, CANCELLED, NOT_RESERVED, NOT_ENOUGH_SEATS, NOT_SAVED };
+
+    /// @brief Times a group booking looks for new seats after other bookers took some of the ones it found
+    const int group_attempts = 3;
+
+    /// @brief Seats of one flight of a trip booked with bookTrip
+    struct TripLeg {
+        Flight* flight;
+        int category;
+        /// @brief Travellers of a group seated together by the booking, 0 when the seats are given
+        int group_size;
+        Airplane::SeatPreference preference;
+        /// @brief Row and column of each seat, filled in by the booking for a group
+        vector<pair<int, int>> seats;
+    };
+
+    /// @brief Nanoseconds spent in each phase of one booking
+    struct PhaseTimes {
+        double search = 0;
+        double reserve = 0;
+        double persist = 0;
+    };
+
+    /// @brief Guards the loaded records vector and the seat holders, the only shared containers a booking changes
+    mutex records_lock;
+    /// @brief ID of the client holding each booked seat, so a seat can only be cancelled by the client who booked it
+    unordered_map<const Inventory*, string> holders;
+    /// @brief Held by the thread running a checkpoint, so bookers that find one due at the same time do not all rewrite Flights.csv
+    mutex checkpoint_lock;
+
+    /// @brief Nanoseconds since a point in time
+    inline double nanoseconds(chrono::steady_clock::time_point start) {
+        return chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+    }
+
+    /// @brief Books a flight seat for a client and records the transaction
+    /// @param flights Loaded flights, checkpointed when the journal has grown
+    /// @param records Loaded records, the new record is added to them. Other threads must not read them while bookings run
+    /// @param flight The flight to book, one of flights
+    /// @param client The client to book for
+    /// @param category Which category of seat to book
+    /// @param row Row of the booked seat
+    /// @param col Column of the booked seat
+    /// @param times Filled with the time of each phase if not nullptr
+    /// @return BOOKED if the seat was booked, NOT_SAVED if it could not be persisted and was freed again
+    Result bookFlightSeat(vector<Flight> &flights, vector<Record> &records, Flight &flight, Client* client, int category, int row, int col, PhaseTimes* times = nullptr) {
+        STATS_TIMER(BOOK_FLIGHT_SEAT);
+        TRACE_SPAN("Booking::bookFlightSeat");
+        auto start = chrono::steady_clock::now();
+        Seat* seat = flight.getSeat(category, row, col);
+        if (times != nullptr) {
+            times->search = nanoseconds(start);
+            start = chrono::steady_clock::now();
+        }
+        if (seat == nullptr) {
+            STATS_ADD(BOOKINGS_REJECTED, 1);
+            return NO_SUCH_SEAT;
+        }
+        // Same steps as Seat::Purchase, split so the reservation and the saving can be timed on their own
+        if (!seat->Reserve()) {
+            STATS_ADD(BOOKINGS_REJECTED, 1);
+            return ALREADY_RESERVED;
+        }
+        if (times != nullptr) {
+            times->reserve = nanoseconds(start);
+            start = chrono::steady_clock::now();
+        }
+        // The record is built and saved outside the lock, only adding it to the vector is serialized.
+        // A record line whose journal entry failed stays behind as history, like the record of a cancelled seat
+        Record record(Record::allocateID(), seat, client, flight.getT_Depart());
+        if (!record.save() || !flight.saveSeat(category, row, col)) {
+            seat->Cancel();
+            STATS_ADD(BOOKINGS_REJECTED, 1);
+            return NOT_SAVED;
+        }
+        {
+            lock_guard<mutex> guard(records_lock);
+            records.push_back(record);
+            holders[seat] = client->getID();
+        }
+        // Fold the journal back into Flights.csv every once in a while to keep start up replay short
+        if (BookingJournal::checkpointDue() && checkpoint_lock.try_lock()) {
+            Flight::checkpoint(flights);
+            checkpoint_lock.unlock();
+        }
+        if (times != nullptr)
+            times->persist = nanoseconds(start);
+        STATS_ADD(SEATS_BOOKED, 1);
+        return BOOKED;
+    }
+
+    /// @brief Books several seats of one category for a client as one group: all of them are reserved or none is,
+    /// and the records and journal entries of the group are each written with a single append
+    /// @param flights Loaded flights, checkpointed when the journal has grown
+    /// @param records Loaded records, the new records are added to them. Other threads must not read them while bookings run
+    /// @param flight The flight to book, one of flights
+    /// @param client The client to book for
+    /// @param category Category of the seats
+    /// @param seats Row and column of each seat
+    /// @param times Filled with the time of each phase if not nullptr
+    /// @return BOOKED if every seat was booked, NOT_SAVED if the group could not be persisted and was freed again
+    Result bookFlightSeats(vector<Flight> &flights, vector<Record> &records, Flight &flight, Client* client, int category, const vector<pair<int, int>> &seats,
+        PhaseTimes* times = nullptr) {
+        STATS_TIMER(BOOK_FLIGHT_SEAT);
+        TRACE_SPAN("Booking::bookFlightSeats");
+        auto start = chrono::steady_clock::now();
+        vector<Seat*> group;
+        for (int i = 0; i < seats.size(); i++)
+            group.push_back(flight.getSeat(category, seats[i].first, seats[i].second));
+        if (times != nullptr) {
+            times->search = nanoseconds(start);
+            start = chrono::steady_clock::now();
+        }
+        if (seats.empty() || find(group.begin(), group.end(), nullptr) != group.end()) {
+            STATS_ADD(BOOKINGS_REJECTED, 1);
+            return NO_SUCH_SEAT;
+        }
+        if (!flight.getSeatMap()->reserveGroup(category, seats)) {
+            STATS_ADD(BOOKINGS_REJECTED, 1);
+            return ALREADY_RESERVED;
+        }
+        if (times != nullptr) {
+            times->reserve = nanoseconds(start);
+            start = chrono::steady_clock::now();
+        }
+        vector<Record> group_records;
+        for (int i = 0; i < group.size(); i++)
+            group_records.push_back(Record(Record::allocateID(), group[i], client, flight.getT_Depart()));
+        if (!Record::saveAll(group_records) || !flight.saveSeats(category, seats)) {
+            for (int i = 0; i < group.size(); i++)
+                group[i]->Cancel();
+            STATS_ADD(BOOKINGS_REJECTED, 1);
+            return NOT_SAVED;
+        }
+        {
+            lock_guard<mutex> guard(records_lock);
+            for (int i = 0; i < group_records.size(); i++) {
+                records.push_back(group_records[i]);
+                holders[group[i]] = client->getID();
+            }
+        }
+        if (BookingJournal::checkpointDue() && checkpoint_lock.try_lock()) {
+            Flight::checkpoint(flights);
+            checkpoint_lock.unlock();
+        }
+        if (times != nullptr)
+            times->persist = nanoseconds(start);
+        STATS_ADD(SEATS_BOOKED, seats.size());
+        return BOOKED;
+    }
+
+    /// @brief Picks seats together for a group and books them. If another booker takes some of them first, new seats are looked for
+    /// @param flights Loaded flights, checkpointed when the journal has grown
+    /// @param records Loaded records, the new records are added to them
+    /// @param flight The flight to book, one of flights
+    /// @param client The client to book for
+    /// @param category Category of the seats
+    /// @param count Number of seats
+    /// @param preference Seat the group would like one of
+    /// @param seats Set to the row and column of each booked seat
+    /// @return BOOKED if the group was booked, NOT_ENOUGH_SEATS if the category has no room for it
+    Result bookGroup(vector<Flight> &flights, vector<Record> &records, Flight &flight, Client* client, int category, int count,
+        Airplane::SeatPreference preference, vector<pair<int, int>> &seats) {
+        Result result = NOT_ENOUGH_SEATS;
+        for (int attempt = 0; attempt < group_attempts; attempt++) {
+            seats = flight.findSeatGroup(category, count, preference);
+            if (seats.empty())
+                return NOT_ENOUGH_SEATS;
+            result = bookFlightSeats(flights, records, flight, client, category, seats);
+            if (result != ALREADY_RESERVED)
+                break;
+        }
+        if (result != BOOKED)
+            seats.clear();
+        return result;
+    }
+
+    /// @brief Reserves the seats of one flight of a trip in the seat map. A group is seated again if another booker takes some of its seats first
+    /// @param leg Flight and seats, the seats of a group are filled in
+    /// @param handles Set to the seat of each reserved seat
+    /// @return BOOKED if every seat of the leg was reserved
+    Result reserveLeg(TripLeg &leg, vector<Seat*> &handles) {
+        for (int attempt = 0; attempt < group_attempts; attempt++) {
+            if (leg.group_size > 0) {
+                leg.seats = leg.flight->findSeatGroup(leg.category, leg.group_size, leg.preference);
+                if (leg.seats.empty())
+                    return NOT_ENOUGH_SEATS;
+            }
+            handles.clear();
+            for (int i = 0; i < leg.seats.size(); i++)
+                handles.push_back(leg.flight->getSeat(leg.category, leg.seats[i].first, leg.seats[i].second));
+            if (leg.seats.empty() || find(handles.begin(), handles.end(), nullptr) != handles.end())
+                return NO_SUCH_SEAT;
+            if (leg.flight->getSeatMap()->reserveGroup(leg.category, leg.seats))
+                return BOOKED;
+            if (leg.group_size == 0)
+                break;
+        }
+        return ALREADY_RESERVED;
+    }
+
+    /// @brief Books the seats of every flight of a trip for a client: all of them are reserved or none is.
+    /// The seats are only written once every flight has them, with one append of the records and one of the journal entries,
+    /// so a trip that fails part way leaves no record and no journal entry behind
+    /// @param flights Loaded flights, checkpointed when the journal has grown
+    /// @param records Loaded records, the new records are added to them
+    /// @param client The client to book for
+    /// @param legs Flights of the trip and their seats, the seats of groups are filled in
+    /// @param failed_leg Set to the position of the leg that could not be booked, -1 if the trip was booked or could not be saved
+    /// @return BOOKED if the whole trip was booked, otherwise the result of the failed leg or NOT_SAVED
+    Result bookTrip(vector<Flight> &flights, vector<Record> &records, Client* client, vector<TripLeg> &legs, int &failed_leg) {
+        STATS_TIMER(BOOK_FLIGHT_SEAT);
+        TRACE_SPAN("Booking::bookTrip");
+        failed_leg = -1;
+        vector<vector<Seat*>> handles(legs.size());
+        Result result = BOOKED;
+        int reserved = 0;
+        for (; reserved < legs.size() && result == BOOKED; reserved++)
+            result = reserveLeg(legs[reserved], handles[reserved]);
+        if (result != BOOKED) {
+            // The failed leg reserved nothing, the legs before it are freed again before anything was written
+            failed_leg = reserved - 1;
+            if (legs[failed_leg].group_size > 0)
+                legs[failed_leg].seats.clear();
+            for (int i = 0; i < failed_leg; i++) {
+                for (int j = 0; j < handles[i].size(); j++)
+                    handles[i][j]->Cancel();
+            }
+            STATS_ADD(BOOKINGS_REJECTED, 1);
+            return result;
+        }
+        vector<Record> trip_records;
+        vector<BookingJournal::Entry> entries;
+        for (int i = 0; i < legs.size(); i++) {
+            for (int j = 0; j < handles[i].size(); j++)
+                trip_records.push_back(Record(Record::allocateID(), handles[i][j], client, legs[i].flight->getT_Depart()));
+            legs[i].flight->addJournalEntries(legs[i].category, legs[i].seats, entries);
+        }
+        bool saved = Record::saveAll(trip_records);
+        if (saved) {
+            STATS_TIMER(JOURNAL_SEAT);
+            saved = BookingJournal::append(entries);
+        }
+        if (!saved) {
+            for (int i = 0; i < legs.size(); i++) {
+                for (int j = 0; j < handles[i].size(); j++)
+                    handles[i][j]->Cancel();
+            }
+            STATS_ADD(BOOKINGS_REJECTED, 1);
+            return NOT_SAVED;
+        }
+        {
+            lock_guard<mutex> guard(records_lock);
+            for (int i = 0; i < trip_records.size(); i++) {
+                records.push_back(trip_records[i]);
+                holders[trip_records[i].getInventory()] = client->getID();
+            }
+        }
+        if (BookingJournal::checkpointDue() && checkpoint_lock.try_lock()) {
+            Flight::checkpoint(flights);
+            checkpoint_lock.unlock();
+        }
+        STATS_ADD(SEATS_BOOKED, trip_records.size());
+        return BOOKED;
+    }
+
+    /// @brief Finds the holder of every seat from the loaded records. A later record of a seat replaces an earlier one, whose seat was cancelled
+    /// @param records Loaded records in the order they were written
+    void indexHolders(const vector<Record> &records) {
+        lock_guard<mutex> guard(records_lock);
+        holders.clear();
+        for (int i = 0; i < records.size(); i++) {
+            if (records[i].getInventory() != nullptr && records[i].getClient() != nullptr)
+                holders[records[i].getInventory()] = records[i].getClient()->getID();
+        }
+    }
+
+    /// @brief Frees a booked flight seat and journals the change. The record of the booking is kept as the history of the transaction
+    /// @param flights Loaded flights, checkpointed when the journal has grown
+    /// @param flight The flight of the seat, one of flights
+    /// @param client Client cancelling, who must hold the seat. nullptr frees the seat whoever holds it
+    /// @param category Category of the seat
+    /// @param row Row of the seat
+    /// @param col Column of the seat
+    /// @return CANCELLED if the seat was freed, NOT_RESERVED if it is not booked by the client,
+    /// NOT_SAVED if the cancellation could not be persisted and the seat was reserved again
+    Result cancelFlightSeat(vector<Flight> &flights, Flight &flight, Client* client, int category, int row, int col) {
+        TRACE_SPAN("Booking::cancelFlightSeat");
+        Seat* seat = flight.getSeat(category, row, col);
+        if (seat == nullptr)
+            return NO_SUCH_SEAT;
+        // The holder is checked and dropped together with freeing the seat, so a booker who wins the seat right after is not cancelled
+        string holder;
+        {
+            lock_guard<mutex> guard(records_lock);
+            auto it = holders.find(seat);
+            if (it != holders.end())
+                holder = it->second;
+            if ((client != nullptr && holder != client->getID()) || !seat->Cancel())
+                return NOT_RESERVED;
+            holders.erase(seat);
+        }
+        if (!flight.saveSeat(category, row, col)) {
+            seat->Reserve();
+            if (!holder.empty()) {
+                lock_guard<mutex> guard(records_lock);
+                holders[seat] = holder;
+            }
+            return NOT_SAVED;
+        }
+        if (BookingJournal::checkpointDue() && checkpoint_lock.try_lock()) {
+            Flight::checkpoint(flights);
+            checkpoint_lock.unlock();
+        }
+        return CANCELLED;
+    }
+}
+
+#endif
@@ -0,0 +1,452 @@
+#include <iostream>
+#include <memory>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "BookingService.h"
+#ifndef BOOKINGCLIENT_H
+#define BOOKINGCLIENT_H
+
+using namespace std;
+
+/// @brief Connection of an interface to the booking server.
+/// If a server is listening on Protocol::socket_path every request goes to it, so all terminals share one loaded model and their bookings
+/// are serialized by the server. Otherwise the requests are served by a BookingService in this process, which loads the files itself.
+class BookingClient {
+    private:
+    /// @brief Socket connected to the server, -1 when running in-process
+    int fd = -1;
+    /// @brief Service of this process serving the requests when not connected to a server
+    BookingService* local = nullptr;
+    /// @brief Service created for this connection when no server is running
+    unique_ptr<BookingService> owned;
+    /// @brief Client logged in through this connection
+    unique_ptr<Client> user;
+    /// @brief ID the in-process service keeps for the login of this connection, as the server does for each of its connections
+    string login_ID;
+
+    /// @brief Connects to the booking server
+    /// @return Connected socket or -1 if no server is listening
+    static int connectToServer() {
+        sockaddr_un address = {};
+        address.sun_family = AF_UNIX;
+        if (Protocol::socket_path.length() >= sizeof(address.sun_path))
+            return -1;
+        strcpy(address.sun_path, Protocol::socket_path.c_str());
+        int socket_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (socket_fd < 0)
+            return -1;
+        if (connect(socket_fd, (sockaddr*) &address, sizeof(address)) != 0) {
+            close(socket_fd);
+            return -1;
+        }
+        return socket_fd;
+    }
+
+    /// @brief Sends a request and waits for its response
+    /// @param request Type of the request
+    /// @param payload Payload of the request
+    /// @param response Filled with the payload of the response
+    /// @return Status of the response, BAD_REQUEST if the server cannot be reached
+    Protocol::Status call(Protocol::Request request, const Protocol::Writer &payload, string &response) {
+        if (fd < 0) {
+            Protocol::Writer out;
+            Protocol::Status status = local->handle(request, payload.bytes(), out, login_ID);
+            response = out.bytes();
+            return status;
+        }
+        uint8_t status;
+        if (!Protocol::sendFrame(fd, request, payload.bytes()) || !Protocol::receiveFrame(fd, status, response)) {
+            cerr << "Error: lost the connection to the booking server..." << endl;
+            return Protocol::BAD_REQUEST;
+        }
+        return (Protocol::Status) status;
+    }
+
+    /// @brief Sends a request without payload
+    Protocol::Status call(Protocol::Request request, string &response) {
+        return call(request, Protocol::Writer(), response);
+    }
+
+    /// @brief Reads a list of flight summaries from a response
+    static vector<Protocol::FlightSummary> readFlights(const string &response) {
+        vector<Protocol::FlightSummary> found;
+        Protocol::Reader in(response);
+        uint32_t count;
+        if (!in.nextU32(count))
+            return found;
+        for (uint32_t i = 0; i < count; i++) {
+            found.emplace_back();
+            if (!found.back().read(in)) {
+                found.pop_back();
+                break;
+            }
+        }
+        return found;
+    }
+
+    public:
+    /// @brief Connects to the booking server, or prepares an in-process service if none is running
+    BookingClient() {
+        fd = connectToServer();
+        if (fd < 0) {
+            owned = make_unique<BookingService>();
+            local = owned.get();
+        }
+    }
+
+    /// @brief Sends the requests straight to a service of this process, as the sessions hosted by the booking server do
+    /// @param service Service to use, must outlive the connection
+    explicit BookingClient(BookingService &service) : local(&service) {}
+
+    BookingClient(const BookingClient&) = delete;
+    BookingClient& operator=(const BookingClient&) = delete;
+
+    ~BookingClient() {
+        if (fd >= 0)
+            close(fd);
+    }
+
+    /// @brief Checks if the requests go to a booking server
+    bool isRemote() const { return fd >= 0; }
+
+    /// @brief Loads the files up front when running in-process. Does nothing when connected, the server has them loaded already
+    void load() {
+        if (local != nullptr)
+            local->load();
+    }
+
+    /// @brief Logs in
+    /// @param username
+    /// @param password
+    /// @return The logged in client, valid until the next login, or nullptr if the details do not match a client
+    Client* login(const string &username, const string &password) {
+        Protocol::Writer request;
+        request.addString(username);
+        request.addString(password);
+        string response;
+        user.reset();
+        if (call(Protocol::LOGIN, request, response) != Protocol::OK)
+            return nullptr;
+        Protocol::Reader in(response);
+        Protocol::readClient(in, user);
+        return user.get();
+    }
+
+    /// @brief Creates a new account
+    /// @return False if the username is already taken
+    bool signUp(const string &name, const string &username, const string &password, const Passport &passport, const string &email, long phone) {
+        Protocol::Writer request;
+        request.addString(name);
+        request.addString(username);
+        request.addString(password);
+        Protocol::writePassport(request, passport);
+        request.addString(email);
+        request.addLong(phone);
+        string response;
+        return call(Protocol::SIGN_UP, request, response) == Protocol::OK;
+    }
+
+    /// @brief Finds the flights on a route departing on a given day
+    /// @param min_seats Free seats a flight needs to be listed, 0 to list all flights
+    /// @param category Category the free seats must be in, negative for any category
+    vector<Protocol::FlightSummary> search(Airport from, Airport to, DateTime departure, int min_seats = 0, int category = -1) {
+        Protocol::Writer request;
+        request.addU16(from);
+        request.addU16(to);
+        request.addDateTime(departure);
+        request.addU16(min_seats);
+        request.addInt(category);
+        string response;
+        if (call(Protocol::SEARCH, request, response) != Protocol::OK)
+            return vector<Protocol::FlightSummary>();
+        return readFlights(response);
+    }
+
+    /// @brief Finds itineraries of one or more connecting flights
+    /// @param from Origin airport
+    /// @param to Destination airport
+    /// @param departure Departure date of the first leg
+    /// @param min_connection Minutes needed between landing and the next departure
+    /// @param max_legs Most legs of an itinerary
+    /// @return Legs of each itinerary, from the fewest legs to the earliest arrival
+    vector<vector<Protocol::FlightSummary>> searchConnections(Airport from, Airport to, DateTime departure, int min_connection = ConnectionScan::default_min_connection, int max_legs = ConnectionScan::default_max_legs) {
+        Protocol::Writer request;
+        request.addU16(from);
+        request.addU16(to);
+        request.addDateTime(departure);
+        request.addU16(min_connection);
+        request.addU8(max_legs);
+        string response;
+        vector<vector<Protocol::FlightSummary>> found;
+        if (call(Protocol::SEARCH_CONNECTIONS, request, response) != Protocol::OK)
+            return found;
+        Protocol::Reader in(response);
+        uint32_t count = 0;
+        uint8_t legs;
+        in.nextU32(count);
+        for (uint32_t i = 0; i < count && in.nextU8(legs); i++) {
+            found.emplace_back(legs);
+            for (int j = 0; j < legs; j++)
+                found.back()[j].read(in);
+            if (!in.ok()) {
+                found.pop_back();
+                break;
+            }
+        }
+        return found;
+    }
+
+    /// @brief Finds the cheapest round trips when both dates may move by a few days
+    /// @param from Origin airport of the outbound flight
+    /// @param to Destination airport of the outbound flight
+    /// @param outbound Preferred outbound date
+    /// @param inbound Preferred return date
+    /// @param window Days each date may move either way
+    /// @param fares Set to the lowest fare of each combination
+    /// @return Outbound and return flight of each combination, cheapest first
+    vector<vector<Protocol::FlightSummary>> roundTrips(Airport from, Airport to, DateTime outbound, DateTime inbound, int window, vector<double> &fares, int max_results = FareCalendar::default_results) {
+        Protocol::Writer request;
+        request.addU16(from);
+        request.addU16(to);
+        request.addDateTime(outbound);
+        request.addDateTime(inbound);
+        request.addU8(window);
+        request.addU8(max_results);
+        string response;
+        vector<vector<Protocol::FlightSummary>> found;
+        fares.clear();
+        if (call(Protocol::ROUND_TRIPS, request, response) != Protocol::OK)
+            return found;
+        Protocol::Reader in(response);
+        uint32_t count = 0;
+        double fare;
+        in.nextU32(count);
+        for (uint32_t i = 0; i < count && in.nextDouble(fare); i++) {
+            found.emplace_back(2);
+            found.back()[0].read(in);
+            found.back()[1].read(in);
+            if (!in.ok()) {
+                found.pop_back();
+                break;
+            }
+            fares.push_back(fare);
+        }
+        return found;
+    }
+
+    /// @brief Gets the lowest fare of a route on every day of a month
+    /// @param year Full year
+    /// @param month 1 to 12
+    /// @return Fare per day of the month, negative on days without a flight. Empty if the request failed
+    vector<double> fareCalendar(Airport from, Airport to, int year, int month) {
+        Protocol::Writer request;
+        request.addU16(from);
+        request.addU16(to);
+        request.addU16(year);
+        request.addU8(month);
+        string response;
+        vector<double> fares;
+        if (call(Protocol::FARE_CALENDAR, request, response) != Protocol::OK)
+            return fares;
+        Protocol::Reader in(response);
+        uint8_t count = 0;
+        in.nextU8(count);
+        fares.assign(count, -1);
+        for (int i = 0; i < count; i++)
+            in.nextDouble(fares[i]);
+        if (!in.ok())
+            fares.clear();
+        return fares;
+    }
+
+    /// @brief Finds the flights departing in a range of days with enough free seats
+    /// @param origin Origin airport, nullptr for any origin
+    /// @param first_day First departure day
+    /// @param days Number of departure days
+    /// @param category Category the seats must be in
+    /// @param min_free Free seats needed in the category, 0 for any
+    /// @param min_together Adjacent free seats needed in one row of the category, 0 for any
+    vector<Protocol::FlightSummary> findAvailable(const Airport* origin, DateTime first_day, int days, int category, int min_free, int min_together) {
+        Protocol::Writer request;
+        request.addU8(origin == nullptr);
+        request.addU16(origin == nullptr ? 0 : *origin);
+        request.addDateTime(first_day);
+        request.addU16(days);
+        request.addInt(category);
+        request.addU16(min_free);
+        request.addU16(min_together);
+        string response;
+        if (call(Protocol::FIND_AVAILABLE, request, response) != Protocol::OK)
+            return vector<Protocol::FlightSummary>();
+        return readFlights(response);
+    }
+
+    /// @brief Gets the current seat map of a flight
+    /// @param flight_ID
+    /// @param category_price Set to the price of each category
+    /// @param seat_map Set to the reservation state of the seats
+    /// @return False if there is no such flight
+    bool seatMap(const string &flight_ID, vector<double> &category_price, SeatMap &seat_map) {
+        Protocol::Writer request;
+        request.addString(flight_ID);
+        string response;
+        if (call(Protocol::SEAT_MAP, request, response) != Protocol::OK)
+            return false;
+        Protocol::Reader in(response);
+        vector<vector<int>> dimensions;
+        if (!Protocol::readDimensions(in, dimensions))
+            return false;
+        category_price.assign(dimensions.size(), 0);
+        for (int c = 0; c < dimensions.size(); c++)
+            in.nextDouble(category_price[c]);
+        seat_map = SeatMap(dimensions);
+        vector<uint64_t> words(seat_map.getWordCount());
+        for (int w = 0; w < words.size(); w++)
+            in.nextU64(words[w]);
+        if (!in.ok())
+            return false;
+        seat_map.fromWords(words.data());
+        return true;
+    }
+
+    /// @brief Books a seat for the logged in client
+    /// @return Status of the booking, OK if the seat was booked
+    Protocol::Status book(const string &flight_ID, int category, int row, int col) {
+        Protocol::Writer request;
+        request.addString(flight_ID);
+        request.addInt(category);
+        request.addInt(row);
+        request.addInt(col);
+        string response;
+        return call(Protocol::BOOK, request, response);
+    }
+
+    /// @brief Books seats together for a group of the logged in client, picked by the server
+    /// @param category Category of the seats
+    /// @param count Number of seats
+    /// @param preference Seat the group would like one of
+    /// @param seats Set to the row and column of each booked seat
+    /// @return Status of the booking, OK if the group was booked and FAILED if the category has no room for it
+    Protocol::Status bookGroup(const string &flight_ID, int category, int count, Airplane::SeatPreference preference, vector<pair<int, int>> &seats) {
+        Protocol::Writer request;
+        request.addString(flight_ID);
+        request.addInt(category);
+        request.addU16(count);
+        request.addU8(preference);
+        string response;
+        seats.clear();
+        Protocol::Status status = call(Protocol::BOOK_GROUP, request, response);
+        Protocol::Reader in(response);
+        uint16_t booked = 0;
+        in.nextU16(booked);
+        for (int i = 0; i < booked; i++) {
+            int32_t row, col;
+            if (!in.nextInt(row) || !in.nextInt(col))
+                break;
+            seats.push_back(make_pair(row, col));
+        }
+        return status;
+    }
+
+    /// @brief Books the seats of every flight of a trip for the logged in client, all of them or none
+    /// @param legs Flights of the trip and their seats, the seats of groups are filled in once booked
+    /// @param failed_leg Set to the position of the leg that could not be booked, the number of legs if none failed
+    /// @return Status of the booking, OK if the whole trip was booked
+    Protocol::Status bookTrip(vector<Protocol::TripLeg> &legs, int &failed_leg) {
+        Protocol::Writer request;
+        request.addU8(legs.size());
+        for (int i = 0; i < legs.size(); i++)
+            legs[i].write(request);
+        string response;
+        Protocol::Status status = call(Protocol::BOOK_TRIP, request, response);
+        Protocol::Reader in(response);
+        uint8_t failed = 0;
+        in.nextU8(failed);
+        failed_leg = min((int) failed, (int) legs.size());
+        for (int i = 0; status == Protocol::OK && i < legs.size(); i++)
+            legs[i].readSeats(in);
+        return status;
+    }
+
+    /// @brief Frees a seat booked by the logged in client
+    /// @return Status of the cancellation, OK if the seat was freed
+    Protocol::Status cancel(const string &flight_ID, int category, int row, int col) {
+        Protocol::Writer request;
+        request.addString(flight_ID);
+        request.addInt(category);
+        request.addInt(row);
+        request.addInt(col);
+        string response;
+        return call(Protocol::CANCEL, request, response);
+    }
+
+    /// @brief Lists all planes, in the order their index is used by createFlight
+    vector<Airplane> listPlanes() {
+        vector<Airplane> planes;
+        string response;
+        if (call(Protocol::LIST_PLANES, response) != Protocol::OK)
+            return planes;
+        Protocol::Reader in(response);
+        uint32_t count = 0;
+        in.nextU32(count);
+        for (uint32_t i = 0; i < count && Protocol::readPlane(in, planes); i++);
+        return planes;
+    }
+
+    /// @brief Adds a plane
+    /// @return False if the plane was not created
+    bool createPlane(const string &model, const vector<vector<int>> &dimensions) {
+        Protocol::Writer request;
+        request.addString(model);
+        Protocol::writeDimensions(request, dimensions);
+        string response;
+        return call(Protocol::CREATE_PLANE, request, response) == Protocol::OK;
+    }
+
+    /// @brief Lists all flights
+    vector<Protocol::FlightSummary> listFlights() {
+        string response;
+        if (call(Protocol::LIST_FLIGHTS, response) != Protocol::OK)
+            return vector<Protocol::FlightSummary>();
+        return readFlights(response);
+    }
+
+    /// @brief Creates a flight
+    /// @param plane_index Position of the plane in listPlanes
+    /// @return False if the flight was not created
+    bool createFlight(int plane_index, DateTime t_depart, DateTime t_arrive, Airport origin, Airport destination, const vector<double> &category_price) {
+        Protocol::Writer request;
+        request.addU32(plane_index);
+        request.addDateTime(t_depart);
+        request.addDateTime(t_arrive);
+        request.addU16(origin);
+        request.addU16(destination);
+        request.addU8(category_price.size());
+        for (int i = 0; i < category_price.size(); i++)
+            request.addDouble(category_price[i]);
+        string response;
+        return call(Protocol::CREATE_FLIGHT, request, response) == Protocol::OK;
+    }
+
+    /// @brief Clears all data in the model and in the files
+    bool reset() {
+        string response;
+        return call(Protocol::RESET, response) == Protocol::OK;
+    }
+
+    /// @brief Gets the statistics of the process serving the requests
+    /// @param json True for JSON, false for a table
+    string stats(bool json) {
+        Protocol::Writer request;
+        request.addU8(json);
+        string response, text;
+        if (call(Protocol::STATS, request, response) != Protocol::OK)
+            return "";
+        Protocol::Reader in(response);
+        in.nextString(text);
+        return text;
+    }
+};
+
+#endif
@@ -0,0 +1,477 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include "ParallelLoader.h"
+#include "Booking.h"
+#include "Protocol.h"
+#ifndef BOOKINGSERVICE_H
+#define BOOKINGSERVICE_H
+
+using namespace std;
+
+/// @brief The in-memory model behind the booking server: all planes, flights, clients and records, and the requests served on them.
+/// The server runs one service for every terminal. When no server is running an interface runs its own service in-process, so both go
+/// through the same requests. Requests may come from several threads: searches and bookings share the model lock (a booking wins its seat
+/// with an atomic operation on the seat map), while sign ups, new planes and flights and resets hold it alone since they grow the vectors.
+class BookingService {
+    private:
+    vector<Airplane> planes;
+    vector<Flight> flights;
+    vector<Client> clients;
+    vector<Record> records;
+
+    /// @brief Position of each client in clients by username, for constant time login and duplicate checks
+    unordered_map<string, int> username_index;
+    /// @brief Loaded flights by ID. IDs are not positions: a line skipped at load still used up its ID
+    IdRegistry<Flight> flight_registry;
+    /// @brief Loaded clients by ID
+    IdRegistry<Client> client_registry;
+
+    /// @brief Shared by requests that only read the vectors, held alone by requests that change them
+    shared_mutex model_lock;
+    /// @brief The model is loaded from the files by the first request
+    atomic<bool> loaded{false};
+
+    /// @brief Loads all files and builds the username index. The model lock must be held alone
+    void loadLocked() {
+        ParallelLoader::loadFiles(&planes, &flights, &clients, &records);
+        TRACE_SPAN("username index build");
+        username_index.clear();
+        username_index.reserve(clients.size());
+        for (int i = 0; i < clients.size(); i++)
+            username_index[clients[i].getUsername()] = i;
+        flight_registry = IdRegistry<Flight>(flights);
+        client_registry = IdRegistry<Client>(clients);
+        Booking::indexHolders(records);
+        loaded = true;
+    }
+
+    /// @brief Adds a plane. Flights point at their plane, so when the vector has to move its planes to grow
+    /// every flight is linked to the moved one. The model lock must be held alone
+    void addPlane(const Airplane &plane) {
+        if (planes.size() < planes.capacity()) {
+            planes.push_back(plane);
+            return;
+        }
+        vector<size_t> plane_of(flights.size());
+        for (int i = 0; i < flights.size(); i++)
+            plane_of[i] = flights[i].getPlane() - planes.data();
+        planes.push_back(plane);
+        for (int i = 0; i < flights.size(); i++)
+            flights[i].setPlane(&planes[plane_of[i]]);
+    }
+
+    /// @brief Adds a client. Records point at their client, so when the vector has to move its clients to grow
+    /// every record is linked to the moved one. The model lock must be held alone
+    void addClient(const Client &client) {
+        if (clients.size() < clients.capacity()) {
+            clients.push_back(client);
+            client_registry.add(clients.back().getID(), &clients.back());
+            return;
+        }
+        vector<size_t> client_of(records.size());
+        for (int i = 0; i < records.size(); i++)
+            client_of[i] = records[i].getClient() - clients.data();
+        clients.push_back(client);
+        for (int i = 0; i < records.size(); i++)
+            records[i].setClient(&clients[client_of[i]]);
+        client_registry = IdRegistry<Client>(clients);
+    }
+
+    /// @brief Adds a flight and indexes it for searches. The registry is rebuilt when the vector has to move its flights to grow.
+    /// The model lock must be held alone
+    void addFlight(const Flight &flight) {
+        bool moved = flights.size() == flights.capacity();
+        flights.push_back(flight);
+        Flight::indexFlight(flights.back(), flights.size() - 1);
+        if (moved)
+            flight_registry = IdRegistry<Flight>(flights);
+        else
+            flight_registry.add(flights.back().getID(), &flights.back());
+    }
+
+    /// @brief Converts the result of a booking or cancellation to a response status
+    static Protocol::Status toStatus(Booking::Result result) {
+        switch (result) {
+            case Booking::BOOKED:
+            case Booking::CANCELLED:
+                return Protocol::OK;
+            case Booking::NO_SUCH_SEAT:
+                return Protocol::NO_SUCH_SEAT;
+            case Booking::ALREADY_RESERVED:
+                return Protocol::ALREADY_RESERVED;
+            case Booking::NOT_ENOUGH_SEATS:
+                return Protocol::FAILED;
+            case Booking::NOT_SAVED:
+                return Protocol::NOT_SAVED;
+            default:
+                return Protocol::NOT_RESERVED;
+        }
+    }
+
+    /// @brief Logs a client in on the connection
+    /// @param client_ID Set to the ID of the client, cleared if the login failed
+    Protocol::Status login(Protocol::Reader &in, Protocol::Writer &out, string &client_ID) {
+        string username, password;
+        client_ID.clear();
+        if (!in.nextString(username) || !in.nextString(password))
+            return Protocol::BAD_REQUEST;
+        shared_lock<shared_mutex> guard(model_lock);
+        auto it = username_index.find(username);
+        if (it == username_index.end() || clients[it->second].validate(password) == nullptr)
+            return Protocol::FAILED;
+        client_ID = clients[it->second].getID();
+        Protocol::writeClient(out, clients[it->second]);
+        return Protocol::OK;
+    }
+
+    Protocol::Status signUp(Protocol::Reader &in, Protocol::Writer &out) {
+        string name, username, password, passport_ID, passport_name, email;
+        char type, sex;
+        CountryEnum country;
+        DateTime DoB, DoI, DoE;
+        int64_t phone;
+        if (!in.nextString(name) || !in.nextString(username) || !in.nextString(password) || !Protocol::readPassport(in, passport_ID, type, passport_name, country, DoB, DoI, DoE, sex)
+            || !in.nextString(email) || !in.nextLong(phone))
+            return Protocol::BAD_REQUEST;
+        unique_lock<shared_mutex> guard(model_lock);
+        if (username_index.count(username) > 0)
+            return Protocol::FAILED;
+        addClient(Client(name, Passport(passport_ID, type, passport_name, country, DoB, DoI, DoE, sex), email, phone, username, password));
+        username_index[username] = clients.size() - 1;
+        out.addString(clients.back().getID());
+        return Protocol::OK;
+    }
+
+    Protocol::Status search(Protocol::Reader &in, Protocol::Writer &out) {
+        STATS_TIMER(DISPLAY_FLIGHTS);
+        uint16_t from, to, min_seats;
+        DateTime departure;
+        int32_t category;
+        if (!in.nextU16(from) || !in.nextU16(to) || !in.nextDateTime(departure) || !in.nextU16(min_seats) || !in.nextInt(category) || from >= AirportInfo::size || to >= AirportInfo::size)
+            return Protocol::BAD_REQUEST;
+        shared_lock<shared_mutex> guard(model_lock);
+        // Only the flights of the route and day are looked at, through the route index
+        vector<Flight*> found = Flight::findFlights(flights, (Airport) from, (Airport) to, departure, min_seats, category);
+        out.addU32(found.size());
+        for (int i = 0; i < found.size(); i++)
+            Protocol::FlightSummary::of(*found[i]).write(out);
+        return Protocol::OK;
+    }
+
+    Protocol::Status searchConnections(Protocol::Reader &in, Protocol::Writer &out) {
+        STATS_TIMER(SEARCH_CONNECTIONS);
+        uint16_t from, to, min_connection;
+        DateTime departure;
+        uint8_t max_legs;
+        if (!in.nextU16(from) || !in.nextU16(to) || !in.nextDateTime(departure) || !in.nextU16(min_connection) || !in.nextU8(max_legs)
+            || from >= AirportInfo::size || to >= AirportInfo::size || max_legs < 1 || max_legs > ConnectionScan::max_legs_limit)
+            return Protocol::BAD_REQUEST;
+        shared_lock<shared_mutex> guard(model_lock);
+        vector<vector<Flight*>> found = Flight::findItineraries(flights, (Airport) from, (Airport) to, departure, min_connection, max_legs);
+        out.addU32(found.size());
+        for (int i = 0; i < found.size(); i++) {
+            out.addU8(found[i].size());
+            for (int j = 0; j < found[i].size(); j++)
+                Protocol::FlightSummary::of(*found[i][j]).write(out);
+        }
+        return Protocol::OK;
+    }
+
+    Protocol::Status roundTrips(Protocol::Reader &in, Protocol::Writer &out) {
+        uint16_t from, to;
+        DateTime outbound, inbound;
+        uint8_t window, max_results;
+        if (!in.nextU16(from) || !in.nextU16(to) || !in.nextDateTime(outbound) || !in.nextDateTime(inbound) || !in.nextU8(window) || !in.nextU8(max_results)
+            || from >= AirportInfo::size || to >= AirportInfo::size || window > FareCalendar::max_window)
+            return Protocol::BAD_REQUEST;
+        shared_lock<shared_mutex> guard(model_lock);
+        vector<pair<Flight*, Flight*>> found = Flight::findRoundTrips(flights, (Airport) from, (Airport) to, outbound, inbound, window, max_results);
+        out.addU32(found.size());
+        for (int i = 0; i < found.size(); i++) {
+            out.addDouble(found[i].first->getLowestAvailableFare() + found[i].second->getLowestAvailableFare());
+            Protocol::FlightSummary::of(*found[i].first).write(out);
+            Protocol::FlightSummary::of(*found[i].second).write(out);
+        }
+        return Protocol::OK;
+    }
+
+    Protocol::Status fareCalendar(Protocol::Reader &in, Protocol::Writer &out) {
+        uint16_t from, to, year;
+        uint8_t month;
+        if (!in.nextU16(from) || !in.nextU16(to) || !in.nextU16(year) || !in.nextU8(month) || from >= AirportInfo::size || to >= AirportInfo::size || month < 1 || month > 12)
+            return Protocol::BAD_REQUEST;
+        shared_lock<shared_mutex> guard(model_lock);
+        vector<double> fares = Flight::findMonthFares((Airport) from, (Airport) to, year, month);
+        out.addU8(fares.size());
+        for (int i = 0; i < fares.size(); i++)
+            out.addDouble(fares[i]);
+        return Protocol::OK;
+    }
+
+    Protocol::Status findAvailable(Protocol::Reader &in, Protocol::Writer &out) {
+        uint8_t any_origin;
+        uint16_t origin, days, min_free, min_together;
+        DateTime first_day;
+        int32_t category;
+        if (!in.nextU8(any_origin) || !in.nextU16(origin) || !in.nextDateTime(first_day) || !in.nextU16(days) || !in.nextInt(category) || !in.nextU16(min_free)
+            || !in.nextU16(min_together) || origin >= AirportInfo::size || category < 0)
+            return Protocol::BAD_REQUEST;
+        Airport from = (Airport) origin;
+        shared_lock<shared_mutex> guard(model_lock);
+        vector<Flight*> found = Flight::findAvailable(flights, any_origin ? nullptr : &from, first_day, days, category, min_free, min_together);
+        out.addU32(found.size());
+        for (int i = 0; i < found.size(); i++)
+            Protocol::FlightSummary::of(*found[i]).write(out);
+        return Protocol::OK;
+    }
+
+    Protocol::Status seatMap(Protocol::Reader &in, Protocol::Writer &out) {
+        string flight_ID;
+        if (!in.nextString(flight_ID))
+            return Protocol::BAD_REQUEST;
+        shared_lock<shared_mutex> guard(model_lock);
+        Flight* flight = flight_registry.find(flight_ID);
+        if (flight == nullptr)
+            return Protocol::BAD_REQUEST;
+        // The seat map goes out as its packed words, one bit per seat
+        SeatMap* seat_map = flight->getSeatMap();
+        vector<double> prices = flight->getCategoryPrice();
+        vector<vector<int>> dimensions;
+        for (int c = 0; c < seat_map->getNumCategories(); c++)
+            dimensions.push_back({seat_map->getRows(c), seat_map->getCols(c)});
+        Protocol::writeDimensions(out, dimensions);
+        for (int c = 0; c < prices.size() && c < dimensions.size(); c++)
+            out.addDouble(prices[c]);
+        for (int w = 0; w < seat_map->getWordCount(); w++)
+            out.addU64(seat_map->loadWord(w));
+        return Protocol::OK;
+    }
+
+    /// @brief Books or cancels a seat for the client logged in on the connection. Only a seat the client booked can be cancelled
+    /// @param book True to book, false to cancel
+    /// @param client_ID Client logged in on the connection
+    Protocol::Status changeSeat(Protocol::Reader &in, Protocol::Writer &out, bool book, const string &client_ID) {
+        string flight_ID;
+        int32_t category, row, col;
+        if (!in.nextString(flight_ID) || !in.nextInt(category) || !in.nextInt(row) || !in.nextInt(col))
+            return Protocol::BAD_REQUEST;
+        shared_lock<shared_mutex> guard(model_lock);
+        Client* client = client_registry.find(client_ID);
+        if (client == nullptr)
+            return Protocol::NOT_LOGGED_IN;
+        Flight* flight = flight_registry.find(flight_ID);
+        if (flight == nullptr)
+            return Protocol::BAD_REQUEST;
+        if (!book)
+            return toStatus(Booking::cancelFlightSeat(flights, *flight, client, category, row, col));
+        return toStatus(Booking::bookFlightSeat(flights, records, *flight, client, category, row, col));
+    }
+
+    /// @brief Books seats together for the client logged in on the connection
+    /// @param client_ID Client logged in on the connection
+    Protocol::Status bookGroup(Protocol::Reader &in, Protocol::Writer &out, const string &client_ID) {
+        string flight_ID;
+        int32_t category;
+        uint16_t count;
+        uint8_t preference;
+        if (!in.nextString(flight_ID) || !in.nextInt(category) || !in.nextU16(count) || !in.nextU8(preference) || preference > Airplane::AISLE_SEAT)
+            return Protocol::BAD_REQUEST;
+        shared_lock<shared_mutex> guard(model_lock);
+        Client* client = client_registry.find(client_ID);
+        if (client == nullptr)
+            return Protocol::NOT_LOGGED_IN;
+        Flight* flight = flight_registry.find(flight_ID);
+        if (flight == nullptr)
+            return Protocol::BAD_REQUEST;
+        vector<pair<int, int>> seats;
+        Protocol::Status status = toStatus(Booking::bookGroup(flights, records, *flight, client, category, count, (Airplane::SeatPreference) preference, seats));
+        out.addU16(seats.size());
+        for (int i = 0; i < seats.size(); i++) {
+            out.addInt(seats[i].first);
+            out.addInt(seats[i].second);
+        }
+        return status;
+    }
+
+    /// @brief Books the seats of every flight of a trip for the client logged in on the connection, all of them or none.
+    /// The response holds the position of the leg that failed (the number of legs if none did) and the seats of each leg
+    /// @param client_ID Client logged in on the connection
+    Protocol::Status bookTrip(Protocol::Reader &in, Protocol::Writer &out, const string &client_ID) {
+        uint8_t count;
+        if (!in.nextU8(count) || count == 0 || count > ConnectionScan::max_legs_limit)
+            return Protocol::BAD_REQUEST;
+        vector<Protocol::TripLeg> wanted(count);
+        for (int i = 0; i < count; i++) {
+            if (!wanted[i].read(in))
+                return Protocol::BAD_REQUEST;
+        }
+        shared_lock<shared_mutex> guard(model_lock);
+        Client* client = client_registry.find(client_ID);
+        if (client == nullptr)
+            return Protocol::NOT_LOGGED_IN;
+        vector<Booking::TripLeg> legs;
+        for (int i = 0; i < count; i++) {
+            Flight* flight = flight_registry.find(wanted[i].flight_ID);
+            if (flight == nullptr || (wanted[i].group && wanted[i].group_size <= 0))
+                return Protocol::BAD_REQUEST;
+            legs.push_back({flight, wanted[i].category, wanted[i].group ? wanted[i].group_size : 0, wanted[i].preference, wanted[i].seats});
+        }
+        int failed_leg;
+        Protocol::Status status = toStatus(Booking::bookTrip(flights, records, client, legs, failed_leg));
+        out.addU8(failed_leg < 0 ? count : failed_leg);
+        for (int i = 0; i < count; i++) {
+            wanted[i].seats = legs[i].seats;
+            wanted[i].writeSeats(out);
+        }
+        return status;
+    }
+
+    Protocol::Status listPlanes(Protocol::Writer &out) {
+        shared_lock<shared_mutex> guard(model_lock);
+        out.addU32(planes.size());
+        for (int i = 0; i < planes.size(); i++)
+            Protocol::writePlane(out, planes[i]);
+        return Protocol::OK;
+    }
+
+    Protocol::Status createPlane(Protocol::Reader &in, Protocol::Writer &out) {
+        string model;
+        vector<vector<int>> dimensions;
+        if (!in.nextString(model) || !Protocol::readDimensions(in, dimensions))
+            return Protocol::BAD_REQUEST;
+        unique_lock<shared_mutex> guard(model_lock);
+        addPlane(Airplane(model, dimensions.size(), dimensions));
+        out.addString(planes.back().getID());
+        return Protocol::OK;
+    }
+
+    Protocol::Status listFlights(Protocol::Writer &out) {
+        shared_lock<shared_mutex> guard(model_lock);
+        out.addU32(flights.size());
+        for (int i = 0; i < flights.size(); i++)
+            Protocol::FlightSummary::of(flights[i]).write(out);
+        return Protocol::OK;
+    }
+
+    Protocol::Status createFlight(Protocol::Reader &in, Protocol::Writer &out) {
+        uint32_t plane_index;
+        DateTime t_depart, t_arrive;
+        uint16_t from, to;
+        uint8_t num_prices;
+        if (!in.nextU32(plane_index) || !in.nextDateTime(t_depart) || !in.nextDateTime(t_arrive) || !in.nextU16(from) || !in.nextU16(to) || !in.nextU8(num_prices))
+            return Protocol::BAD_REQUEST;
+        vector<double> category_price(num_prices);
+        for (int i = 0; i < num_prices; i++)
+            in.nextDouble(category_price[i]);
+        if (!in.ok() || from >= AirportInfo::size || to >= AirportInfo::size)
+            return Protocol::BAD_REQUEST;
+        unique_lock<shared_mutex> guard(model_lock);
+        if (plane_index >= planes.size() || num_prices != planes[plane_index].getNumCategories())
+            return Protocol::BAD_REQUEST;
+        addFlight(Flight(&planes[plane_index], t_depart, t_arrive, (Airport) from, (Airport) to, category_price));
+        out.addString(flights.back().getID());
+        return Protocol::OK;
+    }
+
+    /// @brief Clears all data in the model and in the files
+    Protocol::Status reset() {
+        unique_lock<shared_mutex> guard(model_lock);
+        const string journal_path = BookingJournal::getSavePath();
+        for (const string &path : {Airplane::getSavePath(), Client::getSavePath(), Flight::getSavePath(), Record::getSavePath()})
+            RecordFile::clear(path);
+        // Storage files keep their format, the journal is simply emptied
+        ofstream clearer(journal_path, ofstream::out | ofstream::trunc);
+        clearer.close();
+        // The snapshot is removed rather than truncated since it may still be mapped
+        remove(Snapshot::getSavePath().c_str());
+        // Reloading the empty files also resets the ID counters and the route index
+        loadLocked();
+        return Protocol::OK;
+    }
+
+    Protocol::Status stats(Protocol::Reader &in, Protocol::Writer &out) {
+        uint8_t json;
+        if (!in.nextU8(json))
+            return Protocol::BAD_REQUEST;
+        ostringstream text;
+        if (json)
+            Stats::printJSON(text);
+        else
+            Stats::print(text);
+        out.addString(text.str());
+        return Protocol::OK;
+    }
+
+    public:
+    BookingService() {}
+
+    BookingService(const BookingService&) = delete;
+    BookingService& operator=(const BookingService&) = delete;
+
+    /// @brief Loads the model from the files unless it is loaded already
+    void load() {
+        if (loaded)
+            return;
+        unique_lock<shared_mutex> guard(model_lock);
+        if (!loaded)
+            loadLocked();
+    }
+
+    /// @brief Serves one request
+    /// @param request Type of the request frame
+    /// @param payload Payload of the request frame
+    /// @param out Filled with the payload of the response
+    /// @param client_ID Client logged in on the connection the request came from, set by a login. Bookings are made as this client
+    /// @return Status of the response
+    Protocol::Status handle(uint8_t request, const string &payload, Protocol::Writer &out, string &client_ID) {
+        load();
+        Protocol::Reader in(payload);
+        switch (request) {
+            case Protocol::LOGIN:
+                return login(in, out, client_ID);
+            case Protocol::SIGN_UP:
+                return signUp(in, out);
+            case Protocol::SEARCH:
+                return search(in, out);
+            case Protocol::SEAT_MAP:
+                return seatMap(in, out);
+            case Protocol::BOOK:
+                return changeSeat(in, out, true, client_ID);
+            case Protocol::CANCEL:
+                return changeSeat(in, out, false, client_ID);
+            case Protocol::LIST_PLANES:
+                return listPlanes(out);
+            case Protocol::CREATE_PLANE:
+                return createPlane(in, out);
+            case Protocol::LIST_FLIGHTS:
+                return listFlights(out);
+            case Protocol::CREATE_FLIGHT:
+                return createFlight(in, out);
+            case Protocol::RESET:
+                return reset();
+            case Protocol::STATS:
+                return stats(in, out);
+            case Protocol::SEARCH_CONNECTIONS:
+                return searchConnections(in, out);
+            case Protocol::ROUND_TRIPS:
+                return roundTrips(in, out);
+            case Protocol::FARE_CALENDAR:
+                return fareCalendar(in, out);
+            case Protocol::FIND_AVAILABLE:
+                return findAvailable(in, out);
+            case Protocol::BOOK_GROUP:
+                return bookGroup(in, out, client_ID);
+            case Protocol::BOOK_TRIP:
+                return bookTrip(in, out, client_ID);
+        }
+        return Protocol::BAD_REQUEST;
+    }
+};
+
+#endif
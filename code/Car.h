@@ -30,7 +30,7 @@ class Car : public Inventory {
     /// @param client Pointer to client performing the purchase
     /// @param reservation_date Reservation date
     /// @return Record of transaction (PNR)
-    Record Purchase(Client* client, tm reservation_date) {
+    Record Purchase(Client* client, DateTime reservation_date) {
         return Record(this, client, reservation_date);
     }  
 };
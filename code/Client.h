@@ -2,6 +2,7 @@
 #include <vector>
 #include "Passport.h"
 #include "SaveItem.h"
+#include "RecordFile.h"
 #ifndef CLIENT_H
 #define CLIENT_H
 using namespace std;
@@ -93,113 +94,136 @@ class Client : public SaveItem {
         return nullptr;
     }
 
+    /// @brief Fills in the fixed-width snapshot entry of the client
+    /// @param entry Entry to fill
+    /// @return False if the client does not fit in a snapshot entry
+    bool toSnapshot(ClientEntry &entry) const {
+        entry = ClientEntry();
+        if (ID.empty() || ID.find_first_not_of("0123456789") != string::npos || password.length() > 32)
+            return false;
+        if (!copyField(entry.name, sizeof(entry.name), name) || !copyField(entry.passport_ID, sizeof(entry.passport_ID), passport.getID())
+            || !copyField(entry.email, sizeof(entry.email), email) || !copyField(entry.username, sizeof(entry.username), username))
+            return false;
+        entry.ID = stoul(ID);
+        entry.DoB = passport.getDoB().getDate().getMinutes();
+        entry.DoI = passport.getDoI().getDate().getMinutes();
+        entry.DoE = passport.getDoE().getDate().getMinutes();
+        entry.phone = phone;
+        entry.country = (uint8_t) passport.getCountry();
+        entry.type = passport.getType();
+        entry.sex = passport.getSex();
+        entry.password_length = password.length();
+        for (int i = 0; i < password.length(); i++)
+            entry.password[i] = encryptChar(password[i]);
+        return true;
+    }
+
     /// @brief Prints client details
-    void print_details() {
-        cout << "Client " << ID << endl;
-        passport.print_details();
+    /// @param out Stream to print to
+    void print_details(ostream &out = cout) {
+        out << "Client " << ID << endl;
+        passport.print_details(out);
     }
 
     /// @brief Implemtation of abstract function save from SaveItem class. Saves the client into corresponding storage file
     /// @return True if writing was successful, false otherwise.
     bool save() {
-        ofstream writer;
-        writer.open(save_path, std::ios_base::app);
-        if (writer.fail()) {
+        vector<string> fields = {
+            ID, name, passport.getID(), to_string(passport.getType()), passport.getName(), CountryEnum_to_string(passport.getCountry()),
+            DateTime_to_date(passport.getDoB()), DateTime_to_date(passport.getDoI()), DateTime_to_date(passport.getDoE()), to_string(passport.getSex()),
+            email, to_string(phone), username, password
+        };
+        if (!RecordFile::append(save_path, fields)) {
             cerr << "Error saving client..." << endl;
-            writer.close();
             return false;
         }
-        writer << encrypt(ID) << ',';
-        writer << encrypt(name) << ',';
-        writer << encrypt(passport.getID()) << ',';
-        writer << encrypt(to_string(passport.getType())) << ',';
-        writer << encrypt(passport.getName()) << ',';
-        writer << encrypt(CountryEnum_to_string(passport.getCountry())) << ',';
-        writer << encrypt(tm_to_date(passport.getDoB())) << ',';
-        writer << encrypt(tm_to_date(passport.getDoI())) << ',';
-        writer << encrypt(tm_to_date(passport.getDoE())) << ',';
-        writer << encrypt(to_string(passport.getSex())) << ',';
-        writer << encrypt(email) << ',';
-        writer << encrypt(to_string(phone)) << ',';
-        writer << encrypt(username) << ',';
-        writer << encrypt(password) << ',';
-        writer << endl;
-        writer.close();
         return true;
     }
 
+    /// @brief Loads the clients stored in the snapshot
+    /// @param clients Vector to add the clients to
+    /// @return Byte offset of the first line of the storage file that is not in the snapshot
+    static uint64_t loadSnapshot(vector<Client> &clients) {
+        TRACE_SPAN("Client::loadSnapshot");
+        // Clients already in the snapshot are built straight from its fixed-width entries
+        uint64_t resume_offset;
+        Snapshot &snapshot = Snapshot::get();
+        if (snapshot.covers(CLIENTS_CSV, save_path, resume_offset)) {
+            uint64_t count;
+            const ClientEntry* entries = snapshot.entries<ClientEntry>(CLIENTS, count);
+            clients.reserve(clients.size() + count);
+            for (uint64_t i = 0; i < count; i++) {
+                const ClientEntry &entry = entries[i];
+                string name = readField(entry.name, sizeof(entry.name));
+                string password;
+                for (int c = 0; c < entry.password_length && c < 32; c++)
+                    password += decryptChar((int16_t) entry.password[c]);
+                Passport passport(readField(entry.passport_ID, sizeof(entry.passport_ID)), entry.type, name, (CountryEnum) entry.country, DateTime(entry.DoB), DateTime(entry.DoI), DateTime(entry.DoE), entry.sex);
+                clients.push_back(Client(to_string(entry.ID), name, passport, readField(entry.email, sizeof(entry.email)), entry.phone, readField(entry.username, sizeof(entry.username)), password));
+            }
+        }
+        return resume_offset;
+    }
+
+    /// @brief Builds clients from the plain text of the storage file
+    /// @param plain Records as read by RecordFile::readPlain
+    /// @param clients Vector to add the clients to
+    /// @return Number of records read, including skipped ones
+    static int parseRecords(string_view plain, vector<Client> &clients) {
+        TRACE_SPAN("Client::parseRecords");
+        int count = 0;
+        Tokenizer lines(plain, RecordFile::record_separator);
+        string_view line, type, country, DoB, DoI, DoE, sex;
+        while (lines.next(line)) {
+            if (line.empty())
+                continue;
+            count++;
+            Tokenizer fields(line, RecordFile::field_separator);
+            string ID, name, email, username, password, passport_ID;
+            long phone;
+            // The passport name is stored again after the type and overrides the first copy
+            bool complete = fields.nextString(ID) && fields.nextString(name) && fields.nextString(passport_ID) && fields.next(type) && fields.nextString(name)
+                && fields.next(country) && fields.next(DoB) && fields.next(DoI) && fields.next(DoE) && fields.next(sex)
+                && fields.nextString(email) && fields.nextLong(phone) && fields.nextString(username) && fields.nextString(password);
+            if (!complete || type.empty() || sex.empty()) {
+                cerr << "Skipping incomplete client..." << endl;
+                continue;
+            }
+            DateTime birth, issue, expiry;
+            if (!date_to_DateTime(DoB, birth) || !date_to_DateTime(DoI, issue) || !date_to_DateTime(DoE, expiry)) {
+                cerr << "Invalid passport date in client " << ID << ", skipping it..." << endl;
+                continue;
+            }
+            Passport passport(passport_ID, type[0], name, string_to_CountryEnum(string(country)), birth, issue, expiry, sex[0]);
+            clients.push_back(Client(ID, name, passport, email, phone, username, password));
+        }
+        return count;
+    }
+
     /// @brief Loads all the Clients stored in the corresponding file into a vector
     /// @return Vector of all loaded clients
     static vector<Client> loadAll() {
+        STATS_TIMER(LOAD_CLIENTS);
+        TRACE_SPAN("Client::loadAll", save_path.c_str());
         vector<Client> clients;
-        ifstream reader;
-        reader.open(save_path);
-        if (reader.fail()) {
+        uint64_t resume_offset = loadSnapshot(clients);
+        num_clients = clients.size();
+        string plain;
+        if (!RecordFile::readPlain(save_path, resume_offset, plain)) {
             cerr << "Error loading clients..." << endl;
-            reader.close();
+            num_clients = 0;
             return vector<Client>();
         }
-        string temp;
-        num_clients = 0;
-        while (getline(reader, temp)) {
-            num_clients++;
-            string ID, name, email, username, password, passport_ID;
-            tm DoB, DoI, DoE;
-            CountryEnum country;
-            char type, sex;
-            long phone;
-            stringstream s_stream(temp);
-            getline(s_stream, temp, ',');
-            ID = decrypt(temp);
-            cout << ID << endl;
-            getline(s_stream, temp, ',');
-            name = decrypt(temp);
-            cout << name << endl;
-            getline(s_stream, temp, ',');
-            passport_ID = decrypt(temp);
-            cout << passport_ID << endl;
-            getline(s_stream, temp, ',');
-            type = decrypt(temp)[0];
-            cout << type << endl;
-            getline(s_stream, temp, ',');
-            name = decrypt(temp);
-            getline(s_stream, temp, ',');
-            temp = decrypt(temp);
-            cout << temp << endl;
-            country = string_to_CountryEnum(temp);
-            getline(s_stream, temp, ',');
-            temp = decrypt(temp);
-            cout << temp << endl;
-            DoB = date_to_tm(temp);
-            getline(s_stream, temp, ',');
-            temp = decrypt(temp);
-            cout << temp << endl;
-            DoI = date_to_tm(temp);
-            getline(s_stream, temp, ',');
-            temp = decrypt(temp);
-            cout << temp << endl;
-            DoE = date_to_tm(temp);
-            getline(s_stream, temp, ',');
-            sex = decrypt(temp)[0];
-            cout << "Test" << endl;
-            getline(s_stream, temp, ',');
-            email = decrypt(temp);
-            cout << "Test" << endl;
-            getline(s_stream, temp, ',');
-            phone = stol(decrypt(temp));
-            cout << "Test" << endl;
-            getline(s_stream, temp, ',');
-            username = decrypt(temp);
-            cout << "Test" << endl;
-            getline(s_stream, temp, ',');
-            password = decrypt(temp);
-            cout << "Test" << endl;
-            clients.push_back(Client(ID, name, Passport(passport_ID, type, name, country, DoB, DoI, DoE, sex), email, phone, username, password));
-        }
-        reader.close();
+        num_clients += parseRecords(plain, clients);
         return clients;
     }
 
+    /// @brief Sets the number of clients after they were loaded without loadAll
+    static void setCount(int count) { num_clients = count; }
+
+    /// @brief Gives the path of the storage file
+    static string getSavePath() { return save_path; }
+
 };
 
 // Static variables
@@ -0,0 +1,970 @@
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include "BookingClient.h"
+#ifndef CLIENTSESSION_H
+#define CLIENTSESSION_H
+
+using namespace std;
+
+/// @brief One interactive client session: the log in, home, booking and flight screens as an explicit state machine.
+/// The session never blocks on input. Text is fed in as it arrives and every complete answer moves it to the next screen or prompt,
+/// so the terminal client drives one session from cin while the booking server drives thousands of them from its event loop.
+/// Answers are read like cin >> would: whitespace separated words, single characters, and a full line for the passport name.
+class ClientSession {
+    public:
+    /// @brief Screen or prompt the session waits on
+    enum State {
+        WELCOME,
+        LOGIN_USERNAME,
+        LOGIN_PASSWORD,
+        LOGIN_RETRY,
+        REGISTER_COUNTRY,
+        REGISTER_NAME,
+        REGISTER_PASSPORT_ID,
+        REGISTER_PASSPORT_TYPE,
+        REGISTER_DOB,
+        REGISTER_DOI,
+        REGISTER_DOE,
+        REGISTER_SEX,
+        REGISTER_USERNAME,
+        REGISTER_PASSWORD,
+        REGISTER_EMAIL,
+        REGISTER_PHONE,
+        REGISTER_FAILED,
+        HOME,
+        BOOKING,
+        FLIGHT_FROM,
+        FLIGHT_TO,
+        FLIGHT_DATE,
+        FLIGHT_RETURN_DATE,
+        FLIGHT_FLEXIBILITY,
+        CALENDAR_MONTH,
+        FLIGHT_PICK,
+        ITINERARY_PICK,
+        SEAT_CATEGORY,
+        SEAT_COLUMN,
+        SEAT_ROW,
+        GROUP_CATEGORY,
+        GROUP_SIZE,
+        GROUP_PREFERENCE,
+        STATISTICS,
+        /// @brief Any answer returns to the home screen
+        RETURN_HOME,
+        FINISHED
+    };
+
+    /// @brief Longest answer accepted, a session sending more without a separator is cut off
+    static const size_t max_input = 4096;
+    /// @brief Unix domain socket the booking server hosts text sessions on, e.g. for nc -U
+    static const string socket_path;
+
+    private:
+    BookingClient connection;
+    State state = WELCOME;
+    /// @brief Text received and not consumed yet, starting at position
+    string input;
+    size_t position = 0;
+    /// @brief True once no more input will come, so the last answer needs no separator
+    bool closing = false;
+    /// @brief Text to show, taken by the driver of the session
+    string output;
+
+    /// @brief Logged in client, owned by the connection
+    Client* current_user = nullptr;
+
+    /// @brief Answers collected over several prompts
+    string username, password, country, name, passport_ID, DoB, DoI, DoE, email;
+    char passport_type = 0, sex = 0;
+    /// @brief Kind of flight search the search prompts are for
+    enum SearchKind { ONE_WAY, ROUND_TRIP, LOWEST_FARES };
+    SearchKind search_kind = ONE_WAY;
+    string origin_code, destination_code;
+    Airport search_from, search_to;
+    DateTime departure_date, return_date;
+    vector<Protocol::FlightSummary> available;
+    /// @brief Connecting itineraries offered when a route has no direct flight, and the legs still to book of the picked one
+    vector<vector<Protocol::FlightSummary>> itineraries;
+    vector<Protocol::FlightSummary> next_legs;
+    bool connecting = false;
+    string flight_ID;
+    int category = 0;
+    string column;
+    /// @brief Travellers of a group booking
+    int group_size = 0;
+
+    /// @brief Picks of the flights of the trip so far, booked together once every flight has one. A group leaves the seats to the server and gets them once booked
+    vector<Protocol::TripLeg> picks;
+
+    static constexpr const char* whitespace = " \t\r\n\v\f";
+
+    /// @brief Reads the next whitespace separated word
+    /// @return False if no complete word has arrived yet
+    bool nextWord(string &word) {
+        size_t start = input.find_first_not_of(whitespace, position);
+        if (start == string::npos)
+            return false;
+        size_t end = input.find_first_of(whitespace, start);
+        if (end == string::npos) {
+            if (!closing)
+                return false;
+            end = input.length();
+        }
+        word = input.substr(start, end - start);
+        position = end;
+        return true;
+    }
+
+    /// @brief Converts an answer to a number
+    /// @return The number, -1 if the word is not one
+    static long toNumber(const string &word) {
+        char* end;
+        long value = strtol(word.c_str(), &end, 10);
+        return end == word.c_str() ? -1 : value;
+    }
+
+    /// @brief Reads the next word as a number
+    /// @param value Set to the number, -1 if the word is not one
+    bool nextNumber(long &value) {
+        string word;
+        if (!nextWord(word))
+            return false;
+        value = toNumber(word);
+        return true;
+    }
+
+    bool nextNumber(int &value) {
+        long number;
+        if (!nextNumber(number))
+            return false;
+        value = (int) number;
+        return true;
+    }
+
+    /// @brief Reads the next non whitespace character
+    bool nextChar(char &c) {
+        size_t start = input.find_first_not_of(whitespace, position);
+        if (start == string::npos)
+            return false;
+        c = input[start];
+        position = start + 1;
+        return true;
+    }
+
+    /// @brief Skips the separator after the last answer and reads the rest of the line
+    bool nextLine(string &line) {
+        if (position >= input.length())
+            return false;
+        size_t end = input.find('\n', position + 1);
+        if (end == string::npos) {
+            if (!closing)
+                return false;
+            end = input.length();
+        }
+        line = input.substr(position + 1, end - position - 1);
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        position = min(end + 1, input.length());
+        return true;
+    }
+
+    /// @brief Starts a new screen
+    void beginScreen() {
+        output += "\033[H\033[2J";
+        output += "---------------------------------------------------------\n";
+    }
+
+    void returnPrompt() {
+        output += "Enter any number to return...\n";
+    }
+
+    // Screens, each one prints itself and waits on its first prompt
+
+    void showWelcome() {
+        beginScreen();
+        output += "Welcome to Mistika Airways Computer Reservation System...\n";
+        output += "---------------------------------------------------------\n";
+        output += "Log in or Register\n";
+        output += "Enter the associated number for your choice:\n";
+        output += "0 - Log in\n";
+        output += "1 - Register\n";
+        output += "2 - Exit\n";
+        state = WELCOME;
+    }
+
+    void showLogin() {
+        beginScreen();
+        output += "Log in\n";
+        output += "Username: ";
+        state = LOGIN_USERNAME;
+    }
+
+    void showRegister() {
+        beginScreen();
+        output += "Register\n";
+        output += "~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~\n";
+        output += "Passport details: \n";
+        output += "Country: ";
+        state = REGISTER_COUNTRY;
+    }
+
+    void showHome() {
+        beginScreen();
+        output += "Home Screen\n";
+        output += "Enter the associated number for your choice:\n";
+        output += "0 - Book\n";
+        output += "1 - Manage\n";
+        output += "2 - Check user info\n";
+        output += "3 - Statistics\n";
+        output += "4 - Log Out\n";
+        state = HOME;
+    }
+
+    void showBooking() {
+        beginScreen();
+        output += "Booking Screen\n";
+        output += "Enter the associated number for your choice:\n";
+        output += "0 - Flights\n";
+        output += "1 - Car Rental\n";
+        output += "2 - Hotel Booking\n";
+        output += "3 - Return\n";
+        output += "4 - Round Trip Flights\n";
+        output += "5 - Lowest Fares Calendar\n";
+        state = BOOKING;
+    }
+
+    void showFlightSearch(SearchKind kind) {
+        beginScreen();
+        if (kind == ONE_WAY)
+            output += "One Way Flight\n";
+        else if (kind == ROUND_TRIP)
+            output += "Round Trip\n";
+        else
+            output += "Lowest Fares Calendar\n";
+        output += "~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~\n";
+        output += "From (Airport Code): ";
+        search_kind = kind;
+        state = FLIGHT_FROM;
+    }
+
+    /// @brief Screen of a module that is not built yet
+    void showUnderConstruction(const string &title) {
+        beginScreen();
+        output += title + "\n";
+        output += "Under Construction :(\n";
+        returnPrompt();
+        state = RETURN_HOME;
+    }
+
+    void showUserInfo() {
+        beginScreen();
+        output += "User info: \n";
+        ostringstream details;
+        current_user->print_details(details);
+        output += details.str();
+        returnPrompt();
+        state = RETURN_HOME;
+    }
+
+    void showStatistics() {
+        beginScreen();
+        output += "Statistics\n";
+        output += "Enter the associated number for your choice:\n";
+        output += "0 - Text\n";
+        output += "1 - JSON\n";
+        state = STATISTICS;
+    }
+
+    /// @brief Lists the flights of the chosen route and day, or connecting itineraries if there is no direct flight
+    void showFlights(Airport from, Airport to, DateTime departure) {
+        beginScreen();
+        output += "Available Flights: \n";
+        available = connection.search(from, to, departure);
+        connecting = false;
+        picks.clear();
+        ostringstream list;
+        for (int i = 0; i < available.size(); i++) {
+            list << i << " - ";
+            available[i].print_info(list);
+            available[i].print_availability(list);
+        }
+        output += list.str();
+        if (available.size() == 0) {
+            showItineraries(from, to, departure);
+            return;
+        }
+        state = FLIGHT_PICK;
+    }
+
+    /// @brief Lists the itineraries with connections, from the fewest legs to the earliest arrival
+    void showItineraries(Airport from, Airport to, DateTime departure) {
+        itineraries = connection.searchConnections(from, to, departure);
+        if (itineraries.empty()) {
+            output += "No such flights found...\n";
+            returnPrompt();
+            state = RETURN_HOME;
+            return;
+        }
+        output += "No direct flights, connecting flights: \n";
+        ostringstream list;
+        for (int i = 0; i < itineraries.size(); i++) {
+            list << i << " - " << itineraries[i].size() << " flights, arriving " << DateTime_to_date_time(itineraries[i].back().t_arrive);
+            if (itineraries.size() > 1 && i == 0)
+                list << " (fewest connections)";
+            else if (itineraries.size() > 1 && i == itineraries.size() - 1)
+                list << " (earliest arrival)";
+            list << endl;
+            for (int j = 0; j < itineraries[i].size(); j++) {
+                list << "    ";
+                itineraries[i][j].print_info(list);
+            }
+        }
+        output += list.str();
+        state = ITINERARY_PICK;
+    }
+
+    /// @brief Lists the cheapest round trips around the chosen dates, picking one books both flights or neither
+    void showRoundTrips(int window) {
+        beginScreen();
+        output += "Round Trips: \n";
+        vector<double> fares;
+        itineraries = connection.roundTrips(search_from, search_to, departure_date, return_date, max(0, min(window, FareCalendar::max_window)), fares);
+        if (itineraries.empty()) {
+            output += "No such flights found...\n";
+            returnPrompt();
+            state = RETURN_HOME;
+            return;
+        }
+        ostringstream list;
+        for (int i = 0; i < itineraries.size(); i++) {
+            list << i << " - $" << fares[i] << endl;
+            for (int j = 0; j < itineraries[i].size(); j++) {
+                list << "    ";
+                itineraries[i][j].print_info(list);
+            }
+        }
+        output += list.str();
+        state = ITINERARY_PICK;
+    }
+
+    /// @brief Shows the lowest fare of every day of a month as a calendar, weeks starting on Monday
+    void showFareCalendar(DateTime month) {
+        beginScreen();
+        vector<double> fares = connection.fareCalendar(search_from, search_to, month.getYear(), month.getMonth());
+        ostringstream calendar;
+        calendar << "Lowest Fares: " << Airport_to_String(search_from) << " --> " << Airport_to_String(search_to) << " (" << DateTime_to_date(month).substr(3) << ")" << endl;
+        calendar << left;
+        for (const char* day : {"Mon", "Tue", "Wed", "Thu", "Fri", "Sat", "Sun"})
+            calendar << setw(10) << day;
+        calendar << endl;
+        // 01/01/1970 was a Thursday
+        int weekday = ((month.getDayNumber() % 7) + 10) % 7;
+        for (int i = 0; i < weekday; i++)
+            calendar << setw(10) << "";
+        for (int day = 0; day < fares.size(); day++) {
+            ostringstream cell;
+            cell << setw(2) << setfill('0') << right << day + 1 << ' ';
+            if (fares[day] < 0)
+                cell << '-';
+            else
+                cell << '$' << fares[day];
+            calendar << setw(10) << cell.str();
+            if ((weekday + day) % 7 == 6 || day == fares.size() - 1)
+                calendar << endl;
+        }
+        output += calendar.str();
+        returnPrompt();
+        state = RETURN_HOME;
+    }
+
+    /// @brief Starts picking seats on the legs of the picked itinerary, the legs are booked together after the last one
+    void pickItinerary(int selection) {
+        if (selection < 0 || selection >= itineraries.size()) {
+            itineraries.clear();
+            output += "No such flight...\n";
+            returnPrompt();
+            state = RETURN_HOME;
+            return;
+        }
+        next_legs = itineraries[selection];
+        itineraries.clear();
+        picks.clear();
+        connecting = true;
+        showNextLeg();
+    }
+
+    /// @brief Shows the seats of the next leg of the picked itinerary
+    void showNextLeg() {
+        available.assign(1, next_legs.front());
+        next_legs.erase(next_legs.begin());
+        showSeats(0);
+    }
+
+    /// @brief Shows the seats of the picked flight
+    void showSeats(int selection) {
+        vector<double> category_price;
+        SeatMap seat_map;
+        if (selection < 0 || selection >= available.size() || !connection.seatMap(available[selection].ID, category_price, seat_map)) {
+            // Nothing is booked before every flight of the trip has its seats
+            next_legs.clear();
+            picks.clear();
+            output += "No such flight...\n";
+            returnPrompt();
+            state = RETURN_HOME;
+            return;
+        }
+        flight_ID = available[selection].ID;
+        beginScreen();
+        ostringstream seats;
+        // Each leg of an itinerary says which flight its seats are on, the two flights of a round trip also which way they go
+        if (connecting && search_kind == ROUND_TRIP)
+            seats << (picks.empty() ? "Outbound " : "Return ");
+        if (connecting)
+            available[selection].print_info(seats);
+        available.clear();
+        Flight::printSeats(category_price, seat_map, seats);
+        output += seats.str();
+        output += "Pick seat (e.g. 0 A 3) or G to seat a group together: ";
+        state = SEAT_CATEGORY;
+    }
+
+    /// @brief Picks a seat on the shown flight and moves on to the next flight of the trip, or books the trip once it is the last
+    void pickSeat(int row) {
+        Protocol::TripLeg pick;
+        pick.flight_ID = flight_ID;
+        pick.category = category;
+        pick.seats.push_back(make_pair(row, (int) string_to_Column(column)));
+        picks.push_back(pick);
+        nextPick();
+    }
+
+    /// @brief Lets the server pick seats together for a group on the shown flight, then moves on like pickSeat
+    void pickGroup(int preference) {
+        if (preference < Airplane::ANY_SEAT || preference > Airplane::AISLE_SEAT)
+            preference = Airplane::ANY_SEAT;
+        Protocol::TripLeg pick;
+        pick.flight_ID = flight_ID;
+        pick.category = category;
+        pick.group = true;
+        pick.group_size = group_size;
+        pick.preference = (Airplane::SeatPreference) preference;
+        picks.push_back(pick);
+        nextPick();
+    }
+
+    /// @brief Shows the next flight of the trip, or books all picks once every flight has one
+    void nextPick() {
+        if (!next_legs.empty()) {
+            showNextLeg();
+            return;
+        }
+        bookPicks();
+    }
+
+    /// @brief Explains why a pick could not be booked
+    /// @param status Status of the booking
+    /// @param group True if the pick was a group
+    void reportFailure(Protocol::Status status, bool group) {
+        if (status == Protocol::NOT_SAVED)
+            output += "Booking could not be saved, please try again...\n";
+        else if (status == Protocol::NOT_LOGGED_IN)
+            output += "Please log in again...\n";
+        else if (group && status == Protocol::FAILED)
+            output += "Not enough seats together in this category...\n";
+        else if (group)
+            output += "No such seats...\n";
+        else if (status == Protocol::NO_SUCH_SEAT)
+            output += "No such seat...\n";
+        else if (status == Protocol::ALREADY_RESERVED)
+            output += "Seat already reserved...\n";
+    }
+
+    /// @brief Books the picks of every flight of the trip for the current user. A trip of several flights goes to the server as one request,
+    /// which books it whole or not at all
+    void bookPicks() {
+        Protocol::Status status = Protocol::OK;
+        bool groups = false;
+        int failed = 0;
+        for (int i = 0; i < picks.size(); i++) {
+            groups = groups || picks[i].group;
+            if (status == Protocol::OK && picks[i].group && picks[i].group_size <= 0) {
+                status = Protocol::BAD_REQUEST;
+                failed = i;
+            }
+        }
+        Protocol::TripLeg &pick = picks[0];
+        if (status == Protocol::OK && picks.size() > 1)
+            status = connection.bookTrip(picks, failed);
+        else if (status == Protocol::OK && pick.group)
+            status = connection.bookGroup(pick.flight_ID, pick.category, pick.group_size, pick.preference, pick.seats);
+        else if (status == Protocol::OK)
+            status = connection.book(pick.flight_ID, pick.category, pick.seats[0].first, pick.seats[0].second);
+        if (status != Protocol::OK) {
+            reportFailure(status, failed < picks.size() && picks[failed].group);
+            if (picks.size() > 1 && search_kind == ROUND_TRIP)
+                output += "Neither flight was booked, the round trip is not booked...\n";
+            else if (picks.size() > 1)
+                output += "None of the flights of the trip were booked...\n";
+        }
+        else if (groups) {
+            output += "Seats booked:";
+            for (int i = 0; i < picks.size(); i++) {
+                for (int j = 0; j < picks[i].seats.size(); j++)
+                    output += " " + to_string(picks[i].category) + Col_to_String((Column) picks[i].seats[j].second) + to_string(picks[i].seats[j].first);
+            }
+            output += "\n";
+        }
+        // Seats go straight back home like they always did, groups and trips that failed part way wait so the outcome can be read
+        bool wait = groups || (status != Protocol::OK && picks.size() > 1);
+        picks.clear();
+        next_legs.clear();
+        if (!wait) {
+            showHome();
+            return;
+        }
+        returnPrompt();
+        state = RETURN_HOME;
+    }
+
+    void finish() {
+        output += "Thanks for using our services...\n";
+        current_user = nullptr;
+        state = FINISHED;
+    }
+
+    /// @brief Converts the airport codes of a search, checked once the date is in like the one way search always did
+    /// @return False if a code is unknown, the session then waits to return home
+    bool readRoute() {
+        if (string_to_Airport(origin_code, search_from) && string_to_Airport(destination_code, search_to))
+            return true;
+        output += "Unknown airport code...\n";
+        returnPrompt();
+        state = RETURN_HOME;
+        return false;
+    }
+
+    /// @brief Checks a date typed while registering, asking for it again if it does not parse
+    /// @param date Answer to check
+    /// @param prompt Question to ask again
+    /// @return True if the date is valid
+    bool checkDate(const string &date, const string &prompt) {
+        DateTime parsed;
+        if (date_to_DateTime(date, parsed))
+            return true;
+        output += "Invalid date...\n" + prompt;
+        return false;
+    }
+
+    /// @brief Reports a search date that does not parse and leaves the search
+    void invalidDate() {
+        output += "Invalid date...\n";
+        returnPrompt();
+        state = RETURN_HOME;
+    }
+
+    /// @brief Consumes the answer the current state waits for
+    /// @return False if the answer has not arrived completely yet
+    bool step() {
+        int selection;
+        string word;
+        switch (state) {
+            case WELCOME:
+                if (!nextNumber(selection))
+                    return false;
+                if (selection == 0)
+                    showLogin();
+                else if (selection == 1)
+                    showRegister();
+                else if (selection == 2)
+                    finish();
+                else
+                    showWelcome();
+                return true;
+
+            case LOGIN_USERNAME:
+                if (!nextWord(username))
+                    return false;
+                output += "Password: ";
+                state = LOGIN_PASSWORD;
+                return true;
+
+            case LOGIN_PASSWORD:
+                if (!nextWord(password))
+                    return false;
+                current_user = connection.login(username, password);
+                password.clear();
+                if (current_user != nullptr) {
+                    showHome();
+                    return true;
+                }
+                output += "~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~\n";
+                output += "Incorrect user details...\n";
+                output += "Enter 0 to retry, any other number else to return: ";
+                state = LOGIN_RETRY;
+                return true;
+
+            case LOGIN_RETRY:
+                if (!nextNumber(selection))
+                    return false;
+                if (selection == 0) {
+                    output += "Username: ";
+                    state = LOGIN_USERNAME;
+                }
+                else
+                    showWelcome();
+                return true;
+
+            case REGISTER_COUNTRY:
+                if (!nextWord(country))
+                    return false;
+                output += "Full name: ";
+                state = REGISTER_NAME;
+                return true;
+
+            case REGISTER_NAME:
+                if (!nextLine(name))
+                    return false;
+                output += "Passport ID: ";
+                state = REGISTER_PASSPORT_ID;
+                return true;
+
+            case REGISTER_PASSPORT_ID:
+                if (!nextWord(passport_ID))
+                    return false;
+                output += "Passport Type: ";
+                state = REGISTER_PASSPORT_TYPE;
+                return true;
+
+            case REGISTER_PASSPORT_TYPE:
+                if (!nextChar(passport_type))
+                    return false;
+                output += "Date of Birth (DD/MM/YYYY): ";
+                state = REGISTER_DOB;
+                return true;
+
+            case REGISTER_DOB:
+                if (!nextWord(DoB))
+                    return false;
+                if (!checkDate(DoB, "Date of Birth (DD/MM/YYYY): "))
+                    return true;
+                output += "Date of Issue (DD/MM/YYYY): ";
+                state = REGISTER_DOI;
+                return true;
+
+            case REGISTER_DOI:
+                if (!nextWord(DoI))
+                    return false;
+                if (!checkDate(DoI, "Date of Issue (DD/MM/YYYY): "))
+                    return true;
+                output += "Date of Expiry (DD/MM/YYYY): ";
+                state = REGISTER_DOE;
+                return true;
+
+            case REGISTER_DOE:
+                if (!nextWord(DoE))
+                    return false;
+                if (!checkDate(DoE, "Date of Expiry (DD/MM/YYYY): "))
+                    return true;
+                output += "Sex: ";
+                state = REGISTER_SEX;
+                return true;
+
+            case REGISTER_SEX:
+                if (!nextChar(sex))
+                    return false;
+                output += "Account Details: \n";
+                output += "\033[H\033[2J";
+                output += "Register\n";
+                output += "~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~\n";
+                output += "Username: ";
+                state = REGISTER_USERNAME;
+                return true;
+
+            case REGISTER_USERNAME:
+                if (!nextWord(username))
+                    return false;
+                output += "Password: ";
+                state = REGISTER_PASSWORD;
+                return true;
+
+            case REGISTER_PASSWORD:
+                if (!nextWord(password))
+                    return false;
+                output += "Email: ";
+                state = REGISTER_EMAIL;
+                return true;
+
+            case REGISTER_EMAIL:
+                if (!nextWord(email))
+                    return false;
+                output += "Phone number: ";
+                state = REGISTER_PHONE;
+                return true;
+
+            case REGISTER_PHONE: {
+                long phone;
+                if (!nextNumber(phone))
+                    return false;
+                // The dates were checked when they were entered
+                DateTime birth, issue, expiry;
+                date_to_DateTime(DoB, birth);
+                date_to_DateTime(DoI, issue);
+                date_to_DateTime(DoE, expiry);
+                Passport passport(passport_ID, passport_type, name, string_to_CountryEnum(country), birth, issue, expiry, sex);
+                bool created = connection.signUp(name, username, password, passport, email, phone);
+                password.clear();
+                if (created) {
+                    showLogin();
+                    return true;
+                }
+                output += "~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~\n";
+                output += "Username already taken...\n";
+                returnPrompt();
+                state = REGISTER_FAILED;
+                return true;
+            }
+
+            case REGISTER_FAILED:
+                if (!nextWord(word))
+                    return false;
+                showWelcome();
+                return true;
+
+            case HOME:
+                if (!nextNumber(selection))
+                    return false;
+                if (selection == 0)
+                    showBooking();
+                else if (selection == 1)
+                    showUnderConstruction("Manage Booking Screen");
+                else if (selection == 2)
+                    showUserInfo();
+                else if (selection == 3)
+                    showStatistics();
+                else if (selection == 4) {
+                    current_user = nullptr;
+                    showWelcome();
+                }
+                else
+                    showHome();
+                return true;
+
+            case BOOKING:
+                if (!nextNumber(selection))
+                    return false;
+                if (selection == 0)
+                    showFlightSearch(ONE_WAY);
+                else if (selection == 1)
+                    showUnderConstruction("Car Rental Interface");
+                else if (selection == 2)
+                    showUnderConstruction("Hotel Reservation Interface");
+                else if (selection == 3)
+                    showHome();
+                else if (selection == 4)
+                    showFlightSearch(ROUND_TRIP);
+                else if (selection == 5)
+                    showFlightSearch(LOWEST_FARES);
+                else
+                    showBooking();
+                return true;
+
+            case FLIGHT_FROM:
+                if (!nextWord(origin_code))
+                    return false;
+                output += "To (Airport Code): ";
+                state = FLIGHT_TO;
+                return true;
+
+            case FLIGHT_TO:
+                if (!nextWord(destination_code))
+                    return false;
+                if (search_kind == LOWEST_FARES) {
+                    output += "Month (MM/YYYY): ";
+                    state = CALENDAR_MONTH;
+                    return true;
+                }
+                output += "Departure Date (DD/MM/YYYY): ";
+                state = FLIGHT_DATE;
+                return true;
+
+            case FLIGHT_DATE:
+                if (!nextWord(word))
+                    return false;
+                if (!readRoute())
+                    return true;
+                if (!date_to_DateTime(word, departure_date)) {
+                    invalidDate();
+                    return true;
+                }
+                if (search_kind == ONE_WAY) {
+                    showFlights(search_from, search_to, departure_date);
+                    return true;
+                }
+                output += "Return Date (DD/MM/YYYY): ";
+                state = FLIGHT_RETURN_DATE;
+                return true;
+
+            case FLIGHT_RETURN_DATE:
+                if (!nextWord(word))
+                    return false;
+                if (!date_to_DateTime(word, return_date)) {
+                    invalidDate();
+                    return true;
+                }
+                output += "Days either way the dates may move (0-" + to_string(FareCalendar::max_window) + "): ";
+                state = FLIGHT_FLEXIBILITY;
+                return true;
+
+            case FLIGHT_FLEXIBILITY:
+                if (!nextNumber(selection))
+                    return false;
+                showRoundTrips(selection);
+                return true;
+
+            case CALENDAR_MONTH: {
+                if (!nextWord(word))
+                    return false;
+                if (!readRoute())
+                    return true;
+                DateTime month;
+                if (!DateTime::parseDate("01/" + word, month)) {
+                    output += "Invalid month...\n";
+                    returnPrompt();
+                    state = RETURN_HOME;
+                    return true;
+                }
+                showFareCalendar(month);
+                return true;
+            }
+
+            case FLIGHT_PICK:
+                if (!nextNumber(selection))
+                    return false;
+                showSeats(selection);
+                return true;
+
+            case ITINERARY_PICK:
+                if (!nextNumber(selection))
+                    return false;
+                pickItinerary(selection);
+                return true;
+
+            case SEAT_CATEGORY:
+                if (!nextWord(word))
+                    return false;
+                if (word == "G" || word == "g") {
+                    output += "Category: ";
+                    state = GROUP_CATEGORY;
+                    return true;
+                }
+                category = toNumber(word);
+                state = SEAT_COLUMN;
+                return true;
+
+            case SEAT_COLUMN:
+                if (!nextWord(column))
+                    return false;
+                state = SEAT_ROW;
+                return true;
+
+            case SEAT_ROW:
+                if (!nextNumber(selection))
+                    return false;
+                pickSeat(selection);
+                return true;
+
+            case GROUP_CATEGORY:
+                if (!nextNumber(category))
+                    return false;
+                output += "Number of travellers: ";
+                state = GROUP_SIZE;
+                return true;
+
+            case GROUP_SIZE:
+                if (!nextNumber(group_size))
+                    return false;
+                output += "Seat preference (0 - None, 1 - Window, 2 - Aisle): ";
+                state = GROUP_PREFERENCE;
+                return true;
+
+            case GROUP_PREFERENCE:
+                if (!nextNumber(selection))
+                    return false;
+                pickGroup(selection);
+                return true;
+
+            case STATISTICS:
+                if (!nextNumber(selection))
+                    return false;
+                output += connection.stats(selection == 1);
+                returnPrompt();
+                state = RETURN_HOME;
+                return true;
+
+            case RETURN_HOME:
+                if (!nextWord(word))
+                    return false;
+                showHome();
+                return true;
+
+            case FINISHED:
+                return false;
+        }
+        return false;
+    }
+
+    public:
+    /// @brief Session of the terminal client, connected to the booking server if one is running
+    ClientSession() {
+        // Without a server this process loads the files itself
+        connection.load();
+        showWelcome();
+    }
+
+    /// @brief Session hosted by the booking server on its own service
+    explicit ClientSession(BookingService &service) : connection(service) {
+        showWelcome();
+    }
+
+    ClientSession(const ClientSession&) = delete;
+    ClientSession& operator=(const ClientSession&) = delete;
+
+    /// @brief Adds received text and runs the session as far as the complete answers go
+    /// @param text Text as it arrived, may end in the middle of an answer
+    void feed(string_view text) {
+        input.append(text.data(), text.length());
+        while (step());
+        // Consumed answers are dropped so the buffer only holds the answer being typed
+        input.erase(0, position);
+        position = 0;
+    }
+
+    /// @brief Marks the end of the input, so a last answer without a separator is still read
+    void close() {
+        closing = true;
+        feed("");
+    }
+
+    /// @brief Takes the text the session printed since the last call
+    string takeOutput() {
+        string text;
+        text.swap(output);
+        return text;
+    }
+
+    /// @brief Checks if the user exited
+    bool finished() const { return state == FINISHED; }
+
+    /// @brief Checks if the input holds more unanswered text than any answer needs
+    bool overflowing() const { return input.length() > max_input; }
+
+    State getState() const { return state; }
+};
+
+// Static variables
+const string ClientSession::socket_path = "SaveData/Session.sock";
+
+#endif
@@ -0,0 +1,147 @@
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <climits>
+#include "Airport.h"
+#include "DateTime.h"
+#ifndef CONNECTIONSCAN_H
+#define CONNECTIONSCAN_H
+
+using namespace std;
+using namespace AirportInfo;
+
+/// @brief Timetable of all loaded flights as connections between airports, sorted by departure, for itinerary searches.
+/// Searches use the Connection Scan Algorithm: the connections departing after the start are scanned once in order, and each one is
+/// taken if its origin was reached early enough. Each scan allows one more leg than the last, which gives the earliest arrival for
+/// every number of legs, so both the fewest leg and the earliest arriving itineraries come out of one search.
+class ConnectionScan {
+    public:
+    /// @brief Flight as seen by the scan, kept small so the sorted array streams through the cache
+    struct Connection {
+        int32_t depart;
+        int32_t arrive;
+        uint16_t origin;
+        uint16_t destination;
+        /// @brief Position of the flight in the loaded flights vector
+        int32_t handle;
+
+        bool operator<(const Connection &other) const { return depart < other.depart; }
+    };
+
+    /// @brief Legs of one itinerary in travel order, as flight handles
+    struct Itinerary {
+        vector<int> legs;
+        DateTime arrival;
+    };
+
+    /// @brief Minutes between landing and the next departure when a search does not give one
+    static const int default_min_connection = 60;
+    /// @brief Most legs an itinerary may have when a search does not give a limit
+    static const int default_max_legs = 3;
+    /// @brief Most legs a search may ask for
+    static const int max_legs_limit = 6;
+    /// @brief Connections departing this long after the start are not scanned, so unreachable destinations end quickly
+    static const int max_trip_minutes = 2 * 1440;
+
+    private:
+    /// @brief All connections, sorted by departure once sorted is true
+    vector<Connection> connections;
+    bool sorted = true;
+
+    public:
+    /// @brief Removes all connections
+    void clear() {
+        connections.clear();
+        sorted = true;
+    }
+
+    /// @brief Prepares for a bulk build
+    /// @param count Expected number of flights
+    void reserve(size_t count) {
+        connections.reserve(count);
+    }
+
+    /// @brief Adds a flight during a bulk build, sort must be called before searching
+    void append(Airport origin, Airport destination, DateTime depart, DateTime arrive, int handle) {
+        connections.push_back({depart.getMinutes(), arrive.getMinutes(), (uint16_t) origin, (uint16_t) destination, handle});
+        sorted = false;
+    }
+
+    /// @brief Sorts the connections appended by a bulk build
+    void sort() {
+        if (!sorted)
+            stable_sort(connections.begin(), connections.end());
+        sorted = true;
+    }
+
+    /// @brief Adds one flight in its place, keeping the connections sorted
+    void insert(Airport origin, Airport destination, DateTime depart, DateTime arrive, int handle) {
+        sort();
+        Connection connection = {depart.getMinutes(), arrive.getMinutes(), (uint16_t) origin, (uint16_t) destination, handle};
+        connections.insert(upper_bound(connections.begin(), connections.end(), connection), connection);
+    }
+
+    size_t size() const { return connections.size(); }
+
+    /// @brief Finds the itineraries from one airport to another whose first leg departs on a given day
+    /// @param from Origin airport
+    /// @param to Destination airport
+    /// @param departure Departure date
+    /// @param min_connection Minutes needed between landing and the next departure
+    /// @param max_legs Most legs of an itinerary
+    /// @return The earliest arriving itinerary for each number of legs that arrives earlier than with fewer legs,
+    /// so the first one has the fewest legs and the last one arrives first. Empty if the destination cannot be reached
+    vector<Itinerary> search(Airport from, Airport to, DateTime departure, int min_connection = default_min_connection, int max_legs = default_max_legs) const {
+        vector<Itinerary> found;
+        if (!sorted || from == to || from >= AirportInfo::size || to >= AirportInfo::size || max_legs < 1)
+            return found;
+        int32_t start = departure.getDate().getMinutes();
+        int32_t last_departure = start + 1440;
+        int32_t horizon = last_departure + max_trip_minutes;
+        size_t first = lower_bound(connections.begin(), connections.end(), Connection{start, 0, 0, 0, 0}) - connections.begin();
+
+        // Per round: the earliest time a next leg may depart from each airport, and the connection that got there
+        vector<int32_t> previous_ready(AirportInfo::size, INT32_MAX), ready;
+        vector<vector<int32_t>> vias(1, vector<int32_t>(AirportInfo::size, -1));
+        previous_ready[from] = start;
+        int32_t best_arrival = INT32_MAX;
+        for (int round = 1; round <= max_legs; round++) {
+            ready = previous_ready;
+            vias.push_back(vias.back());
+            vector<int32_t> &via = vias.back();
+            bool improved = false;
+            for (size_t i = first; i < connections.size(); i++) {
+                const Connection &c = connections[i];
+                // Nothing departing after the best arrival so far can arrive earlier
+                if (c.depart >= best_arrival || c.depart >= horizon)
+                    break;
+                if (previous_ready[c.origin] > c.depart || (c.origin == from && c.depart >= last_departure))
+                    continue;
+                int32_t next_ready = c.destination == to ? c.arrive : c.arrive + min_connection;
+                if (next_ready < ready[c.destination]) {
+                    ready[c.destination] = next_ready;
+                    via[c.destination] = i;
+                    improved = improved || c.destination == to;
+                }
+            }
+            if (improved) {
+                best_arrival = ready[to];
+                // Walks back through the rounds, each leg was taken from where the previous round left the traveller
+                Itinerary itinerary;
+                itinerary.arrival = DateTime(best_arrival);
+                int airport = to;
+                for (int r = round; r > 0 && airport != from && vias[r][airport] >= 0; r--) {
+                    const Connection &leg = connections[vias[r][airport]];
+                    itinerary.legs.push_back(leg.handle);
+                    airport = leg.origin;
+                }
+                reverse(itinerary.legs.begin(), itinerary.legs.end());
+                found.push_back(itinerary);
+            }
+            previous_ready.swap(ready);
+        }
+        return found;
+    }
+};
+
+#endif
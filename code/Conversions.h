@@ -1,57 +1,42 @@
 #include <iostream>
-#include <iomanip>
-#include <ctime>
+#include <string>
+#include "DateTime.h"
 #ifndef CONVERSIONS_H
 #define CONVERSIONS_H
 
 using namespace std;
 
-/// @brief Namespace for converting date time conversions between strings and tm
+/// @brief Namespace for converting date times between strings and DateTime
 namespace Conversions {
 
-    namespace tm_conversions {
+    namespace DateTime_conversions {
 
-        string tm_to_date(tm time) {
-            stringstream stream;
-            stream << setfill('0') << setw(2) << time.tm_mday << '/' << setfill('0') << setw(2) << time.tm_mon << '/' << setfill('0') << setw(2) << time.tm_year;
-            string date;
-            stream >> date; 
-            return date;
+        string DateTime_to_date(DateTime time) {
+            char buffer[DateTime::date_length];
+            return string(buffer, time.formatDate(buffer));
         }
 
-        tm date_to_tm(string date) {
-            tm time;
-            time.tm_year = stoi(date.substr(6,4));
-            time.tm_mon = stoi(date.substr(3,2));
-            time.tm_mday = stoi(date.substr(0,2));
-            return time;
+        /// @brief Converts a DD/MM/YYYY date
+        /// @param date Text to be converted
+        /// @param time Set to the date at midnight
+        /// @return False if date is not a valid date, time is left unchanged then
+        bool date_to_DateTime(string_view date, DateTime &time) {
+            return DateTime::parseDate(date, time);
         }
 
-        string tm_to_date_time(tm time) {
-            stringstream stream;
-            stream << setfill('0') << setw(2) << time.tm_hour << ':' << setfill('0') << setw(2) << time.tm_min << " "; 
-            stream << setfill('0') << setw(2) << time.tm_mday << '/' << setfill('0') << setw(2) << time.tm_mon << '/' << setfill('0') << setw(2) << time.tm_year;
-            string time_str;
-            string date;
-            stream >> time_str;
-            stream >> date; 
-            return time_str + ' ' + date;
+        string DateTime_to_date_time(DateTime time) {
+            char buffer[DateTime::date_time_length];
+            return string(buffer, time.formatDateTime(buffer));
         }
 
-        tm date_time_to_tm(string date, string time_str) {
-        tm time;
-        time.tm_year = stoi(date.substr(6,4));
-        time.tm_mon = stoi(date.substr(3,2));
-        time.tm_mday = stoi(date.substr(0,2));
-        time.tm_hour = stoi(time_str.substr(0,2));
-        time.tm_min = stoi(time_str.substr(3,2));
-        return time;
-    }
+        bool date_time_to_DateTime(string_view date, string_view time_str, DateTime &time) {
+            return DateTime::parseDateTime(date, time_str, time);
+        }
 
     }
 
 }
 
-using namespace Conversions::tm_conversions;
+using namespace Conversions::DateTime_conversions;
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,182 @@
+#include <cstdint>
+#include <string_view>
+#ifndef DATETIME_H
+#define DATETIME_H
+
+using namespace std;
+
+/// @brief Date and time packed into minutes since 01/01/1970 00:00 (GMT).
+/// Ordering two values is a single integer compare, and the calendar fields are computed only when they are asked for.
+class DateTime {
+    private:
+    /// @brief Minutes since 01/01/1970 00:00, negative before
+    int32_t minutes;
+
+    /// @brief Civil date of a day number
+    /// @param days Days since 01/01/1970
+    /// @param year Set to the full year
+    /// @param month Set to the month (1 to 12)
+    /// @param day Set to the day of the month
+    static constexpr void civil_from_days(int32_t days, int &year, int &month, int &day) {
+        days += 719468;
+        int era = (days >= 0 ? days : days - 146096) / 146097;
+        int doe = days - era * 146097;
+        int yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+        int doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+        int mp = (5 * doy + 2) / 153;
+        day = doy - (153 * mp + 2) / 5 + 1;
+        month = mp < 10 ? mp + 3 : mp - 9;
+        year = yoe + era * 400 + (month <= 2);
+    }
+
+    /// @brief Writes a number with a fixed number of digits
+    static constexpr void writeDigits(char* out, int value, int digits) {
+        for (int i = digits - 1; i >= 0; i--) {
+            out[i] = '0' + value % 10;
+            value /= 10;
+        }
+    }
+
+    /// @brief Reads a fixed number of digits
+    /// @return False if any of the characters is not a digit
+    static constexpr bool readDigits(string_view text, size_t position, int digits, int &value) {
+        if (position + digits > text.length())
+            return false;
+        value = 0;
+        for (int i = 0; i < digits; i++) {
+            char c = text[position + i];
+            if (c < '0' || c > '9')
+                return false;
+            value = value * 10 + (c - '0');
+        }
+        return true;
+    }
+
+    public:
+    /// @brief Length of a formatted date "DD/MM/YYYY"
+    static constexpr size_t date_length = 10;
+    /// @brief Length of a formatted date and time "hh:mm DD/MM/YYYY"
+    static constexpr size_t date_time_length = 16;
+
+    /// @brief Creates 01/01/1970 00:00
+    constexpr DateTime() : minutes(0) {}
+
+    /// @brief Creates a date time from minutes since 01/01/1970 00:00
+    constexpr explicit DateTime(int32_t minutes) : minutes(minutes) {}
+
+    /// @brief Creates a date time from its calendar fields
+    /// @param year Full year
+    /// @param month 1 to 12
+    /// @param day Day of the month
+    /// @param hour
+    /// @param minute
+    constexpr DateTime(int year, int month, int day, int hour = 0, int minute = 0) : minutes(days_from_civil(year, month, day) * 1440 + hour * 60 + minute) {}
+
+    /// @brief Number of days since 01/01/1970 of a civil date
+    /// @param year
+    /// @param month 1 to 12
+    /// @param day
+    /// @return Number of days (negative before 1970)
+    static constexpr int32_t days_from_civil(int year, int month, int day) {
+        year -= month <= 2;
+        int era = (year >= 0 ? year : year - 399) / 400;
+        int yoe = year - era * 400;
+        int doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+        int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+        return era * 146097 + doe - 719468;
+    }
+
+    /// @brief Number of days in a month
+    /// @param year
+    /// @param month 1 to 12
+    /// @return 28 to 31
+    static constexpr int daysInMonth(int year, int month) {
+        if (month == 2)
+            return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0 ? 29 : 28;
+        return month == 4 || month == 6 || month == 9 || month == 11 ? 30 : 31;
+    }
+
+    // Getter functions
+    constexpr int32_t getMinutes() const { return minutes; }
+    /// @brief Days since 01/01/1970, rounded down
+    constexpr int32_t getDayNumber() const { return minutes >= 0 ? minutes / 1440 : -((-minutes + 1439) / 1440); }
+    constexpr int getMinuteOfDay() const { return minutes - getDayNumber() * 1440; }
+    constexpr int getHour() const { return getMinuteOfDay() / 60; }
+    constexpr int getMinute() const { return getMinuteOfDay() % 60; }
+    constexpr int getYear() const { int year = 0, month = 0, day = 0; civil_from_days(getDayNumber(), year, month, day); return year; }
+    constexpr int getMonth() const { int year = 0, month = 0, day = 0; civil_from_days(getDayNumber(), year, month, day); return month; }
+    constexpr int getDay() const { int year = 0, month = 0, day = 0; civil_from_days(getDayNumber(), year, month, day); return day; }
+
+    /// @brief Gives the start of the day
+    constexpr DateTime getDate() const { return DateTime(getDayNumber() * 1440); }
+
+    // Comparisons of the packed values
+    constexpr bool operator==(const DateTime &other) const { return minutes == other.minutes; }
+    constexpr bool operator!=(const DateTime &other) const { return minutes != other.minutes; }
+    constexpr bool operator<(const DateTime &other) const { return minutes < other.minutes; }
+    constexpr bool operator<=(const DateTime &other) const { return minutes <= other.minutes; }
+    constexpr bool operator>(const DateTime &other) const { return minutes > other.minutes; }
+    constexpr bool operator>=(const DateTime &other) const { return minutes >= other.minutes; }
+
+    /// @brief Formats the date as "DD/MM/YYYY" without allocating
+    /// @param out Buffer of at least date_length characters (not terminated)
+    /// @return Number of characters written
+    constexpr size_t formatDate(char* out) const {
+        int year = 0, month = 0, day = 0;
+        civil_from_days(getDayNumber(), year, month, day);
+        writeDigits(out, day, 2);
+        out[2] = '/';
+        writeDigits(out + 3, month, 2);
+        out[5] = '/';
+        writeDigits(out + 6, year, 4);
+        return date_length;
+    }
+
+    /// @brief Formats the date and time as "hh:mm DD/MM/YYYY" without allocating
+    /// @param out Buffer of at least date_time_length characters (not terminated)
+    /// @return Number of characters written
+    constexpr size_t formatDateTime(char* out) const {
+        writeDigits(out, getHour(), 2);
+        out[2] = ':';
+        writeDigits(out + 3, getMinute(), 2);
+        out[5] = ' ';
+        return 6 + formatDate(out + 6);
+    }
+
+    /// @brief Parses a date "DD/MM/YYYY"
+    /// @param text Text to parse
+    /// @param date Set to the start of the day
+    /// @return False if the text is not a valid date
+    static constexpr bool parseDate(string_view text, DateTime &date) {
+        int day = 0, month = 0, year = 0;
+        if (!readDigits(text, 0, 2, day) || !readDigits(text, 3, 2, month) || !readDigits(text, 6, 4, year))
+            return false;
+        if (month < 1 || month > 12 || day < 1 || day > daysInMonth(year, month))
+            return false;
+        date = DateTime(year, month, day);
+        return true;
+    }
+
+    /// @brief Parses a date "DD/MM/YYYY" and a time "hh:mm"
+    /// @param date_text Date to parse
+    /// @param time_text Time to parse
+    /// @param date_time Set to the date and time
+    /// @return False if the text is not a valid date and time
+    static constexpr bool parseDateTime(string_view date_text, string_view time_text, DateTime &date_time) {
+        int hour = 0, minute = 0;
+        DateTime date;
+        if (!parseDate(date_text, date) || !readDigits(time_text, 0, 2, hour) || !readDigits(time_text, 3, 2, minute))
+            return false;
+        if (hour > 23 || minute > 59)
+            return false;
+        date_time = DateTime(date.minutes + hour * 60 + minute);
+        return true;
+    }
+
+    /// @brief Parses a date and time "hh:mm DD/MM/YYYY" as written by formatDateTime
+    static constexpr bool parseDateTime(string_view text, DateTime &date_time) {
+        return text.length() >= date_time_length && parseDateTime(text.substr(6, date_length), text.substr(0, 5), date_time);
+    }
+};
+
+#endif
@@ -0,0 +1,87 @@
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include "Airport.h"
+#include "DateTime.h"
+#ifndef FARECALENDAR_H
+#define FARECALENDAR_H
+
+using namespace std;
+using namespace AirportInfo;
+
+/// @brief Lowest fare of each route on each departure day, kept up to date as flights are added.
+/// Month calendars and flexible date searches read one entry per day instead of looking at every flight of the route.
+class FareCalendar {
+    public:
+    /// @brief Cheapest flight of a route on one day
+    struct DayFare {
+        /// @brief Price of the cheapest category of the flight
+        double fare;
+        /// @brief Position of the flight in the loaded flights vector
+        int handle;
+    };
+
+    /// @brief Most days a flexible search may move each date by
+    static constexpr int max_window = 14;
+    /// @brief Combinations a round trip search gives back when it does not ask for a number
+    static constexpr int default_results = 10;
+
+    private:
+    /// @brief Cheapest flight by route and departure day
+    unordered_map<uint64_t, DayFare> days;
+
+    /// @brief Packs a route and day into a single hash key
+    static inline uint64_t makeKey(Airport origin, Airport destination, int32_t day) {
+        return ((uint64_t) origin << 48) | ((uint64_t) destination << 32) | (uint32_t) day;
+    }
+
+    public:
+    /// @brief Removes all fares
+    void clear() {
+        days.clear();
+    }
+
+    /// @brief Prepares for a bulk build
+    /// @param count Expected number of flights
+    void reserve(size_t count) {
+        days.reserve(count);
+    }
+
+    /// @brief Adds a flight, which becomes the cheapest of its route and day if no flight there is cheaper
+    /// @param origin
+    /// @param destination
+    /// @param departure Departure of the flight
+    /// @param fare Lowest price of the flight
+    /// @param handle Position of the flight in the loaded flights vector
+    void insert(Airport origin, Airport destination, DateTime departure, double fare, int handle) {
+        auto inserted = days.try_emplace(makeKey(origin, destination, departure.getDayNumber()), DayFare{fare, handle});
+        if (!inserted.second && fare < inserted.first->second.fare)
+            inserted.first->second = DayFare{fare, handle};
+    }
+
+    /// @brief Finds the cheapest flight of a route on a day
+    /// @param day Day number since 01/01/1970
+    /// @return nullptr if no flight of the route departs that day
+    const DayFare* find(Airport origin, Airport destination, int32_t day) const {
+        auto it = days.find(makeKey(origin, destination, day));
+        return it == days.end() ? nullptr : &it->second;
+    }
+
+    /// @brief Lowest fare of every day of a month
+    /// @param year Full year
+    /// @param month 1 to 12
+    /// @return Fare per day of the month, negative on days without a flight
+    vector<double> month(Airport origin, Airport destination, int year, int month) const {
+        int32_t first = DateTime::days_from_civil(year, month, 1);
+        int32_t next = month == 12 ? DateTime::days_from_civil(year + 1, 1, 1) : DateTime::days_from_civil(year, month + 1, 1);
+        vector<double> fares(next - first, -1);
+        for (int32_t day = first; day < next; day++) {
+            const DayFare* cheapest = find(origin, destination, day);
+            if (cheapest != nullptr)
+                fares[day - first] = cheapest->fare;
+        }
+        return fares;
+    }
+};
+
+#endif
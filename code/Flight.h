@@ -1,8 +1,18 @@
 #include <iostream>
 #include <iomanip>
 #include <vector>
-#include <ctime>
+#include <cstdio>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
 #include "Airplane.h"
+#include "Journal.h"
+#include "RecordFile.h"
+#include "RouteIndex.h"
+#include "ConnectionScan.h"
+#include "FareCalendar.h"
+#include "AvailabilityIndex.h"
+#include "IdRegistry.h"
 #include "Airport.h"
 #ifndef FLIGHT_H
 #define FLIGHT_H
@@ -17,18 +27,33 @@ class Flight : public SaveItem {
     static const string save_path;
     /// @brief Number of created flights
     static int num_flights;
+    /// @brief Index of the loaded flights by route and departure day
+    static RouteIndex route_index;
+    /// @brief The loaded flights sorted by departure, for itinerary searches
+    static ConnectionScan connection_scan;
+    /// @brief Lowest fare of each route and day
+    static FareCalendar fare_calendar;
+    /// @brief Bitmaps of the loaded flights by day, origin and free seats, kept up to date by the seat maps
+    static AvailabilityIndex availability_index;
     /// @brief Corresponding flight ID
     const string ID;
-    /// @brief 3D array of seats (2D array for each category)
-    vector<vector<vector<Seat>>> seats;
+    /// @brief Bit-packed reservation state of every seat, shared by all copies of the flight
+    shared_ptr<SeatMap> seat_map;
+    /// @brief Seat objects created so far, keyed by seat index. Seats are only created when an Inventory handle is needed
+    struct SeatHandles {
+        /// @brief Guards the map, as bookers on different threads may create handles of the same flight
+        mutex lock;
+        unordered_map<int, Seat> seats;
+    };
+    shared_ptr<SeatHandles> seat_handles;
     /// @brief Prive per category
     vector<double> category_price;
     /// @brief Associated plane
     Airplane* plane;
     /// @brief Departure time and date
-    tm t_depart;
+    DateTime t_depart;
     /// @brief Arrival time and date
-    tm t_arrive;
+    DateTime t_arrive;
     /// @brief Origin airport
     Airport origin;
     /// @brief Destination airport
@@ -40,22 +65,10 @@ class Flight : public SaveItem {
         return to_string(num_flights++);
     }
 
-    /// @brief Generates 3D array of seats based on the dimensions of the given plane
+    /// @brief Generates an empty seat map based on the dimensions of the given plane
     void generateSeats() {
-        int numCategories = plane->getNumCategories();
-        for (int i = 0 ; i < plane->getNumCategories(); i++) {
-            int numRows = plane->getDimensions()[i][0];
-            int numColumns = plane->getDimensions()[i][1];
-            vector<vector<Seat>> temp_2D;
-            for (int r = 0; r < numRows; r++) {
-                vector<Seat> temp;
-                for (int c = 0; c < numColumns; c++) {
-                    temp.push_back(Seat(ID, r, (Column)c, category_price[i]));
-                }
-                temp_2D.push_back(temp);
-            }
-            seats.push_back(temp_2D);
-        }    
+        seat_map = make_shared<SeatMap>(plane->getDimensions());
+        seat_handles = make_shared<SeatHandles>();
     }
 
     public:
@@ -67,7 +80,7 @@ class Flight : public SaveItem {
     /// @param origin 
     /// @param destination 
     /// @param category_price 
-    Flight(string ID, Airplane* plane, tm t_depart, tm t_arrive, Airport origin, Airport destination, vector<double> category_price) : ID(ID) {
+    Flight(string ID, Airplane* plane, DateTime t_depart, DateTime t_arrive, Airport origin, Airport destination, vector<double> category_price) : ID(ID) {
         this->plane = plane;
         this->t_depart = t_depart;
         this->t_arrive = t_arrive;
@@ -84,7 +97,7 @@ class Flight : public SaveItem {
     /// @param origin 
     /// @param destination 
     /// @param category_price 
-    Flight(Airplane* plane, tm t_depart, tm t_arrive, Airport origin, Airport destination, vector<double> category_price) : ID(generateID()) {
+    Flight(Airplane* plane, DateTime t_depart, DateTime t_arrive, Airport origin, Airport destination, vector<double> category_price) : ID(generateID()) {
         this->plane = plane;
         this->t_depart = t_depart;
         this->t_arrive = t_arrive;
@@ -98,216 +111,775 @@ class Flight : public SaveItem {
     // Getter functions
 
     string getID() const { return ID; }
-    Seat* getSeat(int category, int row, int col) { return &(seats[category][row][col]); }
+    SeatMap* getSeatMap() const { return seat_map.get(); }
     vector<double> getCategoryPrice() const { return category_price; }
     Airplane* getPlane() const { return plane; }
-    tm getT_Depart() const { return t_depart; }
-    tm getT_Arrive() const { return t_arrive; }
+    DateTime getT_Depart() const { return t_depart; }
+    DateTime getT_Arrive() const { return t_arrive; }
     Airport getOrigin() const { return origin; }
     Airport getDestination() const { return destination; }
 
+    // Setter functions
+    /// @brief Links the flight to its plane again after the plane moved in memory
+    void setPlane(Airplane* plane) { this->plane = plane; }
+
+    /// @brief Free seats of a category, kept up to date by the seat map without looking at the seats
+    int getFreeSeats(int category) const { return seat_map->getFree(category); }
+
+    /// @brief Share of all seats that are reserved, from 0 to 1
+    double getLoadFactor() const {
+        int capacity = seat_map->getTotalCapacity();
+        return capacity == 0 ? 0 : 1 - (double) seat_map->getTotalFree() / capacity;
+    }
+
+    /// @brief Checks if a flight has enough free seats
+    /// @param min_seats Free seats needed
+    /// @param category Category the seats must be in, negative for any category
+    /// @return True if there are at least min_seats free seats
+    bool hasFreeSeats(int min_seats, int category = -1) const {
+        if (category < 0)
+            return seat_map->getTotalFree() >= min_seats;
+        return category < seat_map->getNumCategories() && seat_map->getFree(category) >= min_seats;
+    }
+
+    /// @brief Price of the cheapest category
+    double getLowestFare() const {
+        double lowest = category_price.empty() ? 0 : category_price[0];
+        for (int i = 1; i < category_price.size(); i++)
+            lowest = min(lowest, category_price[i]);
+        return lowest;
+    }
+
+    /// @brief Price of the cheapest category that still has a free seat, read from the free seat counters
+    /// @return Negative if the flight is sold out
+    double getLowestAvailableFare() const {
+        double lowest = -1;
+        for (int i = 0; i < category_price.size() && i < seat_map->getNumCategories(); i++) {
+            if (seat_map->getFree(i) > 0 && (lowest < 0 || category_price[i] < lowest))
+                lowest = category_price[i];
+        }
+        return lowest;
+    }
+
+    /// @brief Gives the Seat object of a seat, creating it the first time it is needed
+    /// @param category
+    /// @param row
+    /// @param col
+    /// @return Pointer to the seat, which stays valid as long as any copy of the flight exists. nullptr if there is no such seat.
+    /// Safe to call from several threads
+    Seat* getSeat(int category, int row, int col) {
+        if (!seat_map->contains(category, row, col))
+            return nullptr;
+        int key = 0;
+        for (int i = 0; i < category; i++)
+            key += seat_map->getRows(i) * seat_map->getCols(i);
+        key += row * seat_map->getCols(category) + col;
+        lock_guard<mutex> guard(seat_handles->lock);
+        auto it = seat_handles->seats.find(key);
+        if (it == seat_handles->seats.end())
+            it = seat_handles->seats.emplace(key, Seat(ID, category, row, (Column) col, category_price[category], seat_map.get())).first;
+        return &(it->second);
+    }
+
+    /// @brief Checks if a seat is reserved without creating its Seat object
+    /// @return True if the seat exists and is reserved
+    bool isSeatReserved(int category, int row, int col) const {
+        return seat_map->contains(category, row, col) && seat_map->test(category, row, col);
+    }
+
+    /// @brief Picks where a run of adjacent free seats fits best in a row: the fewest aisles between the seats, then a seat in a liked column
+    /// @param free Free seats of the row, from SeatMap::freeMask
+    /// @param length Seats of the run
+    /// @param gaps Aisles of the row, from Airplane::aisleGaps
+    /// @param liked Columns the group would like one of its seats in
+    /// @param col Set to the first column of the run
+    /// @param score Set to the score of the run, lower is better and 0 cannot be beaten
+    /// @return False if the row has no such run
+    static bool bestRun(uint64_t free, int length, uint64_t gaps, uint64_t liked, int &col, int &score) {
+        uint64_t starts = SeatMap::runStarts(free, length);
+        if (starts == 0)
+            return false;
+        uint64_t span = length >= 64 ? ~0ULL : (1ULL << length) - 1;
+        score = INT_MAX;
+        for (; starts != 0; starts &= starts - 1) {
+            int start = __builtin_ctzll(starts);
+            uint64_t run = span << start;
+            int run_score = 2 * __builtin_popcountll(gaps & run & (run >> 1)) + ((liked & run) == 0);
+            if (run_score < score) {
+                score = run_score;
+                col = start;
+            }
+        }
+        return true;
+    }
+
+    /// @brief Finds seats for a group in one category, adjacent in one row if possible and otherwise spread over the fewest consecutive rows.
+    /// Rows are searched as free seat masks: runs of free seats are found with shifts and the candidates are walked with bit scans
+    /// @param category Category of the seats
+    /// @param count Number of seats
+    /// @param preference Seat the group would like one of, window and aisle columns come from the number of columns of the category
+    /// @return Row and column of each seat, empty if the category does not have enough free seats
+    vector<pair<int, int>> findSeatGroup(int category, int count, Airplane::SeatPreference preference = Airplane::ANY_SEAT) const {
+        vector<pair<int, int>> seats;
+        if (category < 0 || category >= seat_map->getNumCategories() || count < 1 || seat_map->getFree(category) < count)
+            return seats;
+        int rows = seat_map->getRows(category), cols = min(seat_map->getCols(category), 64);
+        uint64_t gaps = Airplane::aisleGaps(cols);
+        uint64_t liked = ~0ULL;
+        if (preference == Airplane::WINDOW_SEAT)
+            liked = Airplane::windowColumns(cols);
+        else if (preference == Airplane::AISLE_SEAT)
+            liked = Airplane::aisleColumns(cols);
+
+        // The whole group in one row, the front-most of the best scored
+        int best_row = -1, best_col = -1, best_score = INT_MAX;
+        for (int row = 0; row < rows && count <= cols && best_score > 0; row++) {
+            int col, score;
+            if (bestRun(seat_map->freeMask(category, row), count, gaps, liked, col, score) && score < best_score) {
+                best_row = row;
+                best_col = col;
+                best_score = score;
+            }
+        }
+        if (best_row >= 0) {
+            for (int i = 0; i < count; i++)
+                seats.push_back(make_pair(best_row, best_col + i));
+            return seats;
+        }
+
+        // Otherwise the fewest consecutive rows, taking the longest run of free seats of each. The free seat masks of the best rows
+        // are kept, so the seats are taken from the rows as they were searched even if other bookers change them meanwhile
+        int first_row = -1, fewest_rows = INT_MAX;
+        vector<uint64_t> masks, best_masks;
+        for (int first = 0; first < rows; first++) {
+            int needed = count, row = first;
+            masks.clear();
+            for (; needed > 0 && row < rows && row - first < fewest_rows; row++) {
+                uint64_t free = seat_map->freeMask(category, row);
+                if (free == 0)
+                    break;
+                masks.push_back(free);
+                needed -= min(needed, SeatMap::longestRun(free));
+            }
+            if (needed == 0 && row - first < fewest_rows) {
+                first_row = first;
+                fewest_rows = row - first;
+                best_masks.swap(masks);
+            }
+        }
+        for (int i = 0, needed = count; first_row >= 0 && i < best_masks.size(); i++) {
+            int length = min(needed, SeatMap::longestRun(best_masks[i])), col = 0, score = 0;
+            if (!bestRun(best_masks[i], length, gaps, liked, col, score))
+                return vector<pair<int, int>>();
+            for (int j = 0; j < length; j++)
+                seats.push_back(make_pair(first_row + i, col + j));
+            needed -= length;
+        }
+        return seats;
+    }
+
     /// @brief Generate strings of the reservation state of the seats in each category
     /// @return vector of strings detailing the resercation state of each category's seat
     vector<string> getAllSeatStates() {
         vector <string> res;
-        for (int i = 0; i < seats.size(); i++) {
-            string str = "";
-            for (int r = 0; r < seats[i].size(); r++) {
-                for (int c = 0; c < seats[i][r].size(); c++) {
-                    str += to_string(seats[i][r][c].getReserved());
-                }
-            }
-            res.push_back(str);
-        }
+        for (int i = 0; i < seat_map->getNumCategories(); i++)
+            res.push_back(seat_map->toString(i));
         return res;
     }
 
-    /// @brief Takes in the reservation state of all the seats in each category and reflects them on the actual seat objects
+    /// @brief Takes in the reservation state of all the seats in each category and reflects them on the seat map
     /// @param string_vec vector of strings storing the reservation state of all seats
     void AssignSeatStatesfromStrings(vector<string> string_vec) {
-        for (int i = 0; i < seats.size(); i++) {
-            for (int r = 0; r < seats[i].size(); r++) {
-                for (int c = 0; c < seats[i][r].size(); c++) {
-                    if (string_vec[i][r*seats[i][r].size() + c] == '1') {
-                        seats[i][r][c].Reserve();
-                    }
-                }
-            }
-        }
+        for (int i = 0; i < seat_map->getNumCategories() && i < string_vec.size(); i++)
+            seat_map->fromString(i, string_vec[i]);
+    }
+
+    /// @brief Copies a bit-packed seat map in the same layout as the flight's own seat map
+    /// @param words Seat words of the flight
+    void AssignSeatStatesfromWords(const uint64_t* words) {
+        seat_map->fromWords(words);
+    }
+
+    /// @brief Number of seat words needed for the bit-packed seat map of a plane
+    /// @param plane
+    /// @return Word count over all categories
+    static uint64_t countSeatWords(const Airplane* plane) {
+        uint64_t count = 0;
+        vector<vector<int>> dimensions = plane->getDimensions();
+        for (int i = 0; i < plane->getNumCategories(); i++)
+            count += ((uint64_t) dimensions[i][0] * dimensions[i][1] + 63) / 64;
+        return count;
     }
 
+    /// @brief Fills in the fixed-width snapshot entry of the flight
+    /// @param entry Entry to fill
+    /// @param prices_pool Pool the category prices are appended to
+    /// @param seat_words Pool the bit-packed seat map is appended to
+    /// @return False if the flight does not fit in a snapshot entry
+    bool toSnapshot(FlightEntry &entry, vector<double> &prices_pool, vector<uint64_t> &seat_words) const {
+        entry = FlightEntry();
+        if (ID.empty() || ID.find_first_not_of("0123456789") != string::npos || plane->getID().find_first_not_of("0123456789") != string::npos)
+            return false;
+        entry.ID = stoul(ID);
+        entry.plane_ID = stoul(plane->getID());
+        entry.t_depart = t_depart.getMinutes();
+        entry.t_arrive = t_arrive.getMinutes();
+        entry.origin = origin;
+        entry.destination = destination;
+        entry.prices_offset = prices_pool.size();
+        prices_pool.insert(prices_pool.end(), category_price.begin(), category_price.end());
+        entry.seats_offset = seat_words.size();
+        seat_words.insert(seat_words.end(), seat_map->getWords(), seat_map->getWords() + seat_map->getWordCount());
+        return true;
+    }
 
     /// @brief Prints all the seats including prices, categories, columns, rows, and reservation state
     void printSeats() const {
-        int numCategories = plane->getNumCategories();
-        for (int i = 0 ; i < plane->getNumCategories(); i++) {
-            int numRows = plane->getDimensions()[i][0];
-            int numColumns = plane->getDimensions()[i][1];
-            cout << "Category " << i << " ($" << category_price[i] << ")" << endl;
+        printSeats(category_price, *seat_map);
+    }
+
+    /// @brief Prints the seats of a seat map, also used for seat maps received from the booking server
+    /// @param category_price Price of each category
+    /// @param seat_map Reservation state of the seats
+    /// @param out Stream to print to
+    static void printSeats(const vector<double> &category_price, const SeatMap &seat_map, ostream &out = cout) {
+        for (int i = 0 ; i < seat_map.getNumCategories(); i++) {
+            int numRows = seat_map.getRows(i);
+            int numColumns = seat_map.getCols(i);
+            out << "Category " << i << " ($" << category_price[i] << ")" << endl;
             for (int c = 0; c < numColumns; c++)
-                cout << ' ' << ColumnInfo::Col_to_String((Column) c) << ' ';
-            cout << endl;
+                out << ' ' << ColumnInfo::Col_to_String((Column) c) << ' ';
+            out << endl;
             for (int r = 0; r < numRows; r++) {
                 for (int c = 0; c < numColumns; c++)
-                    cout << '[' << seats[i][r][c].getReserved() << ']';
-                cout << r << endl;
+                    out << '[' << seat_map.test(i, r, c) << ']';
+                out << r << endl;
             }
         }   
     }
 
     /// @brief Prints flight information
     void print_info() const {
-        cout << "Flight: " << ID << " | " << Airport_to_String(origin) << " (" << tm_to_date_time(t_depart) << ") --> " << Airport_to_String(destination) << "(" << tm_to_date_time(t_arrive) << ")" << endl;
-    }
-
-    /// @brief Updates the flight record in the storage file to match any changes
-    /// @return True if the update works, false otherwise
-    bool OverwriteSave() {
-        bool saved = false;
-        vector<string> flights;
-        ifstream reader;
-        reader.open(save_path);
-        if (reader.fail()) {
-            cerr << "Error loading planes..." << endl;
-            reader.close();
-            return false;
+        printInfo(ID, origin, t_depart, destination, t_arrive);
+    }
+
+    /// @brief Prints the information line of a flight, also used for flights received from the booking server
+    static void printInfo(const string &ID, Airport origin, DateTime t_depart, Airport destination, DateTime t_arrive, ostream &out = cout) {
+        out << "Flight: " << ID << " | " << Airport_to_String(origin) << " (" << DateTime_to_date_time(t_depart) << ") --> " << Airport_to_String(destination) << "(" << DateTime_to_date_time(t_arrive) << ")" << endl;
+    }
+
+    /// @brief Prints the free seats of each category and the load factor
+    void print_availability() const {
+        vector<int> free_seats, capacity;
+        for (int i = 0; i < seat_map->getNumCategories(); i++) {
+            free_seats.push_back(seat_map->getFree(i));
+            capacity.push_back(seat_map->getCapacity(i));
         }
-        string temp;
-        // Save old file
-        while(getline(reader, temp)) {
-            flights.push_back(temp);
+        printAvailability(free_seats, capacity);
+    }
+
+    /// @brief Prints the availability line of a flight, also used for flights received from the booking server
+    /// @param free_seats Free seats of each category
+    /// @param capacity Number of seats of each category
+    /// @param out Stream to print to
+    static void printAvailability(const vector<int> &free_seats, const vector<int> &capacity, ostream &out = cout) {
+        int total_free = 0, total = 0;
+        out << "    Free seats:";
+        for (int i = 0; i < capacity.size() && i < free_seats.size(); i++) {
+            out << " Category " << i << ": " << free_seats[i] << "/" << capacity[i] << " |";
+            total_free += free_seats[i];
+            total += capacity[i];
         }
-        reader.close();
-        ofstream writer;
-        writer.open(save_path, ios::out | std::ofstream::trunc); // Clear the file
-        if (writer.fail()) {
-            cerr << "Error updating flights..." << endl;
+        out << " Load factor: " << (total == 0 ? 0 : ((total - total_free) * 200 + total) / (2 * total)) << "%" << endl;
+    }
+
+    /// @brief Records the current state of one seat in the booking journal instead of rewriting the storage file
+    /// @param category Category of the changed seat
+    /// @param row Row of the changed seat
+    /// @param col Column of the changed seat
+    /// @return True if the journal entry was written, false otherwise
+    bool saveSeat(int category, int row, int col) {
+        STATS_TIMER(JOURNAL_SEAT);
+        BookingJournal::Operation op = seat_map->test(category, row, col) ? BookingJournal::RESERVE : BookingJournal::CANCEL;
+        return BookingJournal::append(BookingJournal::makeEntry(op, stoul(ID), category, row, col));
+    }
+
+    /// @brief Records the current state of several seats of a category in the booking journal with one write, so a group is committed at once
+    /// @param category Category of the changed seats
+    /// @param seats Row and column of each changed seat
+    /// @return True if the journal entries were written, false otherwise
+    bool saveSeats(int category, const vector<pair<int, int>> &seats) {
+        STATS_TIMER(JOURNAL_SEAT);
+        vector<BookingJournal::Entry> entries;
+        addJournalEntries(category, seats, entries);
+        return BookingJournal::append(entries);
+    }
+
+    /// @brief Adds the journal entries recording the current state of several seats of a category, for changes of several flights committed with one write
+    /// @param category Category of the changed seats
+    /// @param seats Row and column of each changed seat
+    /// @param entries Entries the new ones are added to
+    void addJournalEntries(int category, const vector<pair<int, int>> &seats, vector<BookingJournal::Entry> &entries) const {
+        for (int i = 0; i < seats.size(); i++) {
+            BookingJournal::Operation op = seat_map->test(category, seats[i].first, seats[i].second) ? BookingJournal::RESERVE : BookingJournal::CANCEL;
+            entries.push_back(BookingJournal::makeEntry(op, stoul(ID), category, seats[i].first, seats[i].second));
+        }
+    }
+
+    /// @brief Applies a journal entry to the matching seat
+    /// @param entry Journal entry to apply
+    /// @return True if the entry refers to an existing seat, false otherwise
+    bool applyJournalEntry(const BookingJournal::Entry &entry) {
+        if (!seat_map->contains(entry.category, entry.row, entry.col))
             return false;
+        if (entry.op == BookingJournal::RESERVE)
+            seat_map->reserve(entry.category, entry.row, entry.col);
+        else
+            seat_map->cancel(entry.category, entry.row, entry.col);
+        return true;
+    }
+
+    /// @brief Replays the journal entries this process has not applied yet on top of the loaded flights
+    /// @param flights Vector of loaded flights passed by reference
+    static void replayJournal(vector<Flight> &flights) {
+        TRACE_SPAN("Flight::replayJournal");
+        vector<BookingJournal::Entry> entries = BookingJournal::readUnapplied();
+        if (entries.empty())
+            return;
+        unordered_map<uint32_t, Flight*> by_ID;
+        for (int i = 0; i < flights.size(); i++)
+            by_ID[stoul(flights[i].getID())] = &flights[i];
+        for (int i = 0; i < entries.size(); i++) {
+            auto it = by_ID.find(entries[i].flight_ID);
+            if (it == by_ID.end() || !it->second->applyJournalEntry(entries[i]))
+                cerr << "Skipping journal entry for unknown seat of flight " << entries[i].flight_ID << "..." << endl;
         }
-        // Rewrite all the flight records except for the one with representing the calling Flight object
-        // For the calling flight object, the save() function is called to reflect the new changes
-        for (int i = 0; i < flights.size(); i++) {
-            if (!saved) {
-                string temp2;
-                stringstream s_stream(flights[i]);
-                getline(s_stream, temp2, ',');
-                temp2 = decrypt(temp2);
-                if (temp2 == ID) {
-                    writer.close();
-                    save();
-                    saved = true;
-                    writer.open(save_path, ios::app);
-                    if (writer.fail()) {
-                        cerr << "Error updating flights..." << endl;
-                        return false;
-                    }
-                    continue;
-                }
-            }
-            writer << flights[i] << endl;
+    }
+
+    /// @brief Applies journal entries to the seat states of a flight line read from the storage file
+    /// @param fields Plain fields of the line, its seat strings are replaced
+    /// @param entries Entries of the flight in the order they were written
+    /// @return False if the line does not match the layout of the flight's plane
+    bool mergeSeatStates(vector<string> &fields, const vector<BookingJournal::Entry> &entries) const {
+        SeatMap merged(plane->getDimensions());
+        int num_categories = merged.getNumCategories();
+        if (fields.size() != 6 + 2 * num_categories)
+            return false;
+        for (int i = 0; i < num_categories; i++)
+            merged.fromString(i, fields[6 + num_categories + i]);
+        for (int i = 0; i < entries.size(); i++) {
+            if (!merged.contains(entries[i].category, entries[i].row, entries[i].col))
+                continue;
+            if (entries[i].op == BookingJournal::RESERVE)
+                merged.reserve(entries[i].category, entries[i].row, entries[i].col);
+            else
+                merged.cancel(entries[i].category, entries[i].row, entries[i].col);
         }
-        writer.close();
+        for (int i = 0; i < num_categories; i++)
+            fields[6 + num_categories + i] = merged.toString(i);
         return true;
     }
 
-    /// @brief Implementation of the abstract function in the SaveItem class to save Flight to the storage file
-    /// @return True if the writing is successful, false otherwise
-    bool save() {
-        ofstream writer;
-        writer.open(save_path, std::ios_base::app);
-        if (writer.fail()) {
-            cerr << "Error saving plane..." << endl;
-            writer.close();
+    /// @brief Folds the journal into the storage file and empties the journal.
+    /// Each flight line keeps the seat states of the file and gets every journal entry of the flight applied on top, so the seats
+    /// another process sold and checkpointed are kept. The seat maps in memory are not written: all their changes are in the journal.
+    /// Entries of flights this process has not loaded are written back into the emptied journal for a process that has them.
+    /// @param flights Vector of loaded flights passed by reference
+    /// @return True if the checkpoint was written, false otherwise
+    static bool checkpoint(vector<Flight> &flights) {
+        STATS_TIMER(CHECKPOINT);
+        TRACE_SPAN("Flight::checkpoint");
+        int journal = BookingJournal::lock();
+        if (journal < 0) {
+            cerr << "Error locking booking journal..." << endl;
             return false;
         }
-        writer << encrypt(ID) << ',';
-        writer << encrypt(plane->getID()) << ',';
-        writer << encrypt(tm_to_date_time(t_depart)) << ',';
-        writer << encrypt(tm_to_date_time(t_arrive)) << ',';
-        writer << encrypt(Airport_to_String(origin)) << ',';
-        writer << encrypt(Airport_to_String(destination)) << ',';
+        // Pick up bookings journaled by other processes since these flights were loaded. Entries this process wrote are
+        // skipped: their seats may have changed again since, and replaying them would undo that
+        replayJournal(flights);
+        vector<BookingJournal::Entry> entries = BookingJournal::readAll();
+        unordered_map<uint32_t, vector<BookingJournal::Entry>> pending;
+        for (int i = 0; i < entries.size(); i++)
+            pending[entries[i].flight_ID].push_back(entries[i]);
+        unordered_map<string, Flight*> by_ID;
+        for (int i = 0; i < flights.size(); i++)
+            by_ID[flights[i].getID()] = &flights[i];
+        // The storage file stays locked from the read to the rename, so a flight appended by another process is not lost
+        int storage = RecordFile::lock(save_path);
+        vector<vector<string>> lines;
+        if (storage < 0 || !RecordFile::readAll(save_path, 0, lines)) {
+            cerr << "Error updating flights..." << endl;
+            if (storage >= 0)
+                RecordFile::unlock(storage);
+            BookingJournal::unlock(journal);
+            return false;
+        }
+        for (int i = 0; i < lines.size(); i++) {
+            auto flight = by_ID.find(lines[i][0]);
+            if (flight == by_ID.end())
+                continue;
+            auto changes = pending.find(stoul(lines[i][0]));
+            if (changes != pending.end() && flight->second->mergeSeatStates(lines[i], changes->second))
+                pending.erase(changes);
+        }
+        vector<BookingJournal::Entry> kept;
+        for (int i = 0; i < entries.size(); i++) {
+            if (pending.count(entries[i].flight_ID) > 0)
+                kept.push_back(entries[i]);
+        }
+        // The file keeps its storage format and is replaced in one rename, so a crash never leaves a truncated file behind
+        bool written = RecordFile::rewriteLocked(save_path, lines, RecordFile::detect(storage));
+        RecordFile::unlock(storage);
+        if (!written) {
+            cerr << "Error updating flights..." << endl;
+            BookingJournal::unlock(journal);
+            return false;
+        }
+        return BookingJournal::clearAndUnlock(journal, kept);
+    }
+
+    /// @brief Fields of the flight as stored in one line of the storage file
+    /// @return Plain fields in storage order
+    vector<string> toFields() {
+        vector<string> fields = {ID, plane->getID(), DateTime_to_date_time(t_depart), DateTime_to_date_time(t_arrive), Airport_to_String(origin), Airport_to_String(destination)};
         for (int i = 0; i < category_price.size(); i++) {
-            writer << encrypt(to_string(category_price[i])) << ',';
+            fields.push_back(to_string(category_price[i]));
         }
         vector<string> seat_strings = getAllSeatStates();
         for (int i = 0; i < seat_strings.size(); i++) {
-            writer << encrypt(seat_strings[i]) << ',';
+            fields.push_back(seat_strings[i]);
+        }
+        return fields;
+    }
+
+    /// @brief Implementation of the abstract function in the SaveItem class to save Flight to the storage file
+    /// @return True if the writing is successful, false otherwise
+    bool save() {
+        if (!RecordFile::append(save_path, toFields())) {
+            cerr << "Error saving flight..." << endl;
+            return false;
         }
-        writer << endl;
-        writer.close();
         return true;
     }
 
 
-    /// @brief Returns the plane with the corresponding ID
-    /// @param ID ID to search for
-    /// @param planes Vector of all planes passed by reference
-    /// @return Airplane pointer for the matching plane
-    static Airplane* findPlanefromID(string ID, vector<Airplane> &planes) {
-        for (int i = 0; i < planes.size(); i++) {
-            if (planes[i].getID() == ID)
-                return &(planes[i]);
+    /// @brief Adds a flight to the route index, the connection timetable, the fare calendar and the availability index
+    /// @param flight Flight to add
+    /// @param handle Position of the flight in the loaded flights vector
+    static void indexFlight(const Flight &flight, int handle) {
+        route_index.insert(flight.origin, flight.destination, flight.t_depart, handle);
+        connection_scan.insert(flight.origin, flight.destination, flight.t_depart, flight.t_arrive, handle);
+        fare_calendar.insert(flight.origin, flight.destination, flight.t_depart, flight.getLowestFare(), handle);
+        availability_index.add(handle, flight.origin, flight.t_depart, flight.seat_map.get());
+    }
+
+    /// @brief Finds the loaded flights on a route departing on a given day using the route index
+    /// @param flights Vector of loaded flights passed by reference
+    /// @param from Origin airport
+    /// @param to Destination airport
+    /// @param departure Departure date
+    /// @param min_seats Free seats a flight needs to be listed, 0 to list all flights
+    /// @param category Category the free seats must be in, negative for any category
+    /// @return Pointers to the matching flights
+    static vector<Flight*> findFlights(vector<Flight> &flights, Airport from, Airport to, DateTime departure, int min_seats = 0, int category = -1) {
+        vector<Flight*> found;
+        const vector<int> &handles = route_index.find(from, to, departure);
+        for (int i = 0; i < handles.size(); i++) {
+            // The free seat counters make the filter a read per flight
+            if (handles[i] < flights.size() && (min_seats <= 0 || flights[handles[i]].hasFreeSeats(min_seats, category)))
+                found.push_back(&flights[handles[i]]);
+        }
+        return found;
+    }
+
+    /// @brief Finds itineraries of one or more connecting flights using the connection timetable
+    /// @param flights Vector of loaded flights passed by reference
+    /// @param from Origin airport
+    /// @param to Destination airport
+    /// @param departure Departure date of the first leg
+    /// @param min_connection Minutes needed between landing and the next departure
+    /// @param max_legs Most legs of an itinerary
+    /// @return Legs of each itinerary, from the fewest legs to the earliest arrival
+    static vector<vector<Flight*>> findItineraries(vector<Flight> &flights, Airport from, Airport to, DateTime departure, int min_connection, int max_legs) {
+        vector<vector<Flight*>> found;
+        vector<ConnectionScan::Itinerary> itineraries = connection_scan.search(from, to, departure, min_connection, max_legs);
+        for (int i = 0; i < itineraries.size(); i++) {
+            vector<Flight*> legs;
+            for (int j = 0; j < itineraries[i].legs.size(); j++) {
+                if (itineraries[i].legs[j] < flights.size())
+                    legs.push_back(&flights[itineraries[i].legs[j]]);
+            }
+            if (legs.size() == itineraries[i].legs.size())
+                found.push_back(legs);
         }
-        return nullptr;
+        return found;
+    }
+
+    /// @brief Flights of a route departing within a few days of a date that still have a free seat, cheapest free seat first
+    /// @param flights Vector of loaded flights passed by reference
+    /// @param day Middle day of the range
+    /// @param window Days either way
+    /// @return Free seat fare and flight of each flight found
+    static vector<pair<double, Flight*>> findBookableFlights(vector<Flight> &flights, Airport from, Airport to, DateTime day, int window) {
+        vector<pair<double, Flight*>> found;
+        for (int32_t offset = -window; offset <= window; offset++) {
+            // Every flight of the day is a candidate: the cheapest one may be full or leave too early for the other leg
+            const vector<int> &handles = route_index.find(from, to, DateTime(day.getMinutes() + offset * 1440));
+            for (int i = 0; i < handles.size(); i++) {
+                double fare = handles[i] < flights.size() ? flights[handles[i]].getLowestAvailableFare() : -1;
+                if (fare >= 0)
+                    found.push_back({fare, &flights[handles[i]]});
+            }
+        }
+        stable_sort(found.begin(), found.end(), [](const pair<double, Flight*> &a, const pair<double, Flight*> &b) { return a.first < b.first; });
+        return found;
+    }
+
+    /// @brief Finds the cheapest round trips when both dates may move by a few days, using the route index.
+    /// Fares are those of the cheapest category with a free seat, and sold out flights are left out
+    /// @param flights Vector of loaded flights passed by reference
+    /// @param from Origin airport of the outbound flight
+    /// @param to Destination airport of the outbound flight
+    /// @param outbound Preferred outbound date
+    /// @param inbound Preferred return date
+    /// @param window Days each date may move either way
+    /// @param max_results Most combinations to give back
+    /// @return Outbound and return flight of each combination, cheapest first
+    static vector<pair<Flight*, Flight*>> findRoundTrips(vector<Flight> &flights, Airport from, Airport to, DateTime outbound, DateTime inbound, int window, int max_results) {
+        vector<pair<double, Flight*>> outbound_flights = findBookableFlights(flights, from, to, outbound, window);
+        vector<pair<double, Flight*>> inbound_flights = findBookableFlights(flights, to, from, inbound, window);
+        // Return flights are in fare order, so each outbound flight only needs its max_results cheapest return flights that leave after it lands
+        vector<pair<double, pair<Flight*, Flight*>>> combinations;
+        for (int i = 0; i < outbound_flights.size(); i++) {
+            int paired = 0;
+            for (int j = 0; j < inbound_flights.size() && paired < max_results; j++) {
+                if (inbound_flights[j].second->t_depart >= outbound_flights[i].second->t_arrive) {
+                    combinations.push_back({outbound_flights[i].first + inbound_flights[j].first, {outbound_flights[i].second, inbound_flights[j].second}});
+                    paired++;
+                }
+            }
+        }
+        // Equal fares keep the earlier dates first
+        int count = min((int) combinations.size(), max(max_results, 0));
+        partial_sort(combinations.begin(), combinations.begin() + count, combinations.end(), [](const pair<double, pair<Flight*, Flight*>> &a, const pair<double, pair<Flight*, Flight*>> &b) {
+            if (a.first != b.first)
+                return a.first < b.first;
+            if (a.second.first->t_depart != b.second.first->t_depart)
+                return a.second.first->t_depart < b.second.first->t_depart;
+            return a.second.second->t_depart < b.second.second->t_depart;
+        });
+        vector<pair<Flight*, Flight*>> found;
+        for (int i = 0; i < count; i++)
+            found.push_back(combinations[i].second);
+        return found;
+    }
+
+    /// @brief Lowest fare of a route on every day of a month, from the fare calendar
+    /// @param from Origin airport
+    /// @param to Destination airport
+    /// @param year Full year
+    /// @param month 1 to 12
+    /// @return Fare per day of the month, negative on days without a flight
+    static vector<double> findMonthFares(Airport from, Airport to, int year, int month) {
+        return fare_calendar.month(from, to, year, month);
+    }
+
+    /// @brief Finds the flights departing in a range of days with enough free seats, using the availability index
+    /// @param flights Vector of loaded flights passed by reference
+    /// @param origin Origin airport, nullptr for any origin
+    /// @param first_day First departure day
+    /// @param days Number of departure days
+    /// @param category Category the seats must be in
+    /// @param min_free Free seats needed in the category, 0 for any
+    /// @param min_together Adjacent free seats needed in one row of the category, 0 for any
+    /// @return Pointers to the matching flights
+    static vector<Flight*> findAvailable(vector<Flight> &flights, const Airport* origin, DateTime first_day, int days, int category, int min_free, int min_together) {
+        bool exact;
+        vector<uint32_t> handles = availability_index.find(origin, first_day, days, category, min_free, min_together, exact);
+        vector<Flight*> found;
+        for (int i = 0; i < handles.size(); i++) {
+            if (handles[i] >= flights.size())
+                continue;
+            Flight* flight = &flights[handles[i]];
+            // Counts between two levels of the index are checked on the flight
+            if (!exact && (flight->getFreeSeats(category) < min_free || flight->seat_map->longestFreeBlock(category) < min_together))
+                continue;
+            found.push_back(flight);
+        }
+        return found;
+    }
+
+    /// @brief Finds a seat from its inventory ID and creates its Seat object
+    /// @param ID Seat ID as generated by the Seat class
+    /// @param flights Registry of all loaded flights
+    /// @return Pointer to the seat or nullptr if there is no such seat
+    static Seat* findSeatfromID(const string &ID, const IdRegistry<Flight> &flights) {
+        string flight_ID;
+        int category, row, col;
+        if (!Seat::parseID(ID, flight_ID, category, row, col))
+            return nullptr;
+        Flight* flight = flights.find(flight_ID);
+        if (flight == nullptr)
+            return nullptr;
+        // IDs written before the category was part of the ID belong to the first category with that position
+        for (int i = 0; category < 0 && i < flight->seat_map->getNumCategories(); i++) {
+            if (flight->seat_map->contains(i, row, col))
+                category = i;
+        }
+        return flight->getSeat(category, row, col);
+    }
+
+    /// @brief Loads the flights stored in the snapshot
+    /// @param flights Vector to add the flights to
+    /// @param plane_registry Registry of the loaded planes
+    /// @return Byte offset of the first line of the storage file that is not in the snapshot
+    static uint64_t loadSnapshot(vector<Flight> &flights, const IdRegistry<Airplane> &plane_registry) {
+        TRACE_SPAN("Flight::loadSnapshot");
+        // Flights already in the snapshot are built straight from its fixed-width entries
+        uint64_t resume_offset;
+        Snapshot &snapshot = Snapshot::get();
+        if (snapshot.covers(FLIGHTS_CSV, save_path, resume_offset)) {
+            uint64_t count, prices_count, words_count;
+            const FlightEntry* entries = snapshot.entries<FlightEntry>(FLIGHTS, count);
+            const double* prices_pool = snapshot.entries<double>(PRICES, prices_count);
+            const uint64_t* seat_words = snapshot.entries<uint64_t>(SEAT_WORDS, words_count);
+            size_t first = flights.size();
+            flights.reserve(first + count);
+            for (uint64_t i = 0; i < count; i++) {
+                Airplane* plane = plane_registry.find(to_string(entries[i].plane_ID));
+                if (plane == nullptr || entries[i].origin >= AirportInfo::size || entries[i].destination >= AirportInfo::size || entries[i].prices_offset + (uint64_t) plane->getNumCategories() > prices_count || entries[i].seats_offset + countSeatWords(plane) > words_count) {
+                    cerr << "Snapshot out of date, reading all flights..." << endl;
+                    while (flights.size() > first)
+                        flights.pop_back();
+                    return 0;
+                }
+                vector<double> category_price(prices_pool + entries[i].prices_offset, prices_pool + entries[i].prices_offset + plane->getNumCategories());
+                flights.push_back(Flight(to_string(entries[i].ID), plane, DateTime(entries[i].t_depart), DateTime(entries[i].t_arrive), (Airport) entries[i].origin, (Airport) entries[i].destination, category_price));
+                flights.back().AssignSeatStatesfromWords(seat_words + entries[i].seats_offset);
+            }
+        }
+        return resume_offset;
+    }
+
+    /// @brief Builds flights from the plain text of the storage file.
+    /// Only reads the plane registry, so separate parts of the text can be parsed on separate threads
+    /// @param plain Records as read by RecordFile::readPlain
+    /// @param flights Vector to add the flights to
+    /// @param plane_registry Registry of the loaded planes
+    /// @return Number of records read, including skipped ones
+    static int parseRecords(string_view plain, vector<Flight> &flights, const IdRegistry<Airplane> &plane_registry) {
+        TRACE_SPAN("Flight::parseRecords");
+        int count = 0;
+        Tokenizer lines(plain, RecordFile::record_separator);
+        string_view line, t_depart, t_arrive, origin, destination;
+        string flightID, planeID;
+        vector<string_view> seat_strings;
+        while (lines.next(line)) {
+            if (line.empty())
+                continue;
+            count++;
+            Tokenizer fields(line, RecordFile::field_separator);
+            if (!fields.nextString(flightID) || !fields.nextString(planeID)) {
+                cerr << "Skipping incomplete flight..." << endl;
+                continue;
+            }
+            Airplane* plane = plane_registry.find(planeID);
+            if (plane == nullptr) {
+                LoadStats::unresolved_planes++;
+                continue;
+            }
+            bool complete = fields.next(t_depart) && fields.next(t_arrive) && fields.next(origin) && fields.next(destination);
+            vector<double> category_price(plane->getNumCategories());
+            for (int i = 0; complete && i < plane->getNumCategories(); i++)
+                complete = fields.nextDouble(category_price[i]);
+            seat_strings.resize(plane->getNumCategories());
+            for (int i = 0; complete && i < plane->getNumCategories(); i++)
+                complete = fields.next(seat_strings[i]);
+            if (!complete || t_depart.length() < 16 || t_arrive.length() < 16) {
+                cerr << "Skipping incomplete flight..." << endl;
+                continue;
+            }
+            Airport origin_airport, destination_airport;
+            if (!string_to_Airport(origin, origin_airport) || !string_to_Airport(destination, destination_airport)) {
+                cerr << "Unknown airport code in flight " << flightID << ", skipping it..." << endl;
+                continue;
+            }
+            DateTime depart_time, arrive_time;
+            if (!date_time_to_DateTime(t_depart.substr(6, 10), t_depart.substr(0, 5), depart_time) || !date_time_to_DateTime(t_arrive.substr(6, 10), t_arrive.substr(0, 5), arrive_time)) {
+                cerr << "Invalid date in flight " << flightID << ", skipping it..." << endl;
+                continue;
+            }
+            flights.push_back(Flight(flightID, plane, depart_time, arrive_time, origin_airport, destination_airport, category_price));
+            for (int i = 0; i < seat_strings.size(); i++)
+                flights.back().seat_map->fromString(i, seat_strings[i]);
+        }
+        return count;
+    }
+
+    /// @brief Final steps once all flights are in place: applies the journal and builds the route index, connection timetable, fare calendar and availability index
+    /// @param flights Vector of loaded flights passed by reference
+    static void finishLoad(vector<Flight> &flights) {
+        if (LoadStats::unresolved_planes > 0)
+            LoadStats::print(cerr);
+        // The seat maps were just read from the checkpoint, so every entry of the journal is applied again
+        BookingJournal::forgetApplied();
+        replayJournal(flights);
+        // Build the indexes in one go now that the positions of all flights are known
+        TRACE_SPAN("Flight index build");
+        route_index.clear();
+        route_index.reserve(flights.size());
+        connection_scan.clear();
+        connection_scan.reserve(flights.size());
+        fare_calendar.clear();
+        fare_calendar.reserve(flights.size());
+        availability_index.clear();
+        for (int i = 0; i < flights.size(); i++) {
+            route_index.insert(flights[i].origin, flights[i].destination, flights[i].t_depart, i);
+            connection_scan.append(flights[i].origin, flights[i].destination, flights[i].t_depart, flights[i].t_arrive, i);
+            fare_calendar.insert(flights[i].origin, flights[i].destination, flights[i].t_depart, flights[i].getLowestFare(), i);
+            availability_index.append(i, flights[i].origin, flights[i].t_depart, flights[i].seat_map.get());
+        }
+        // One sort of the whole timetable and one build of the availability bitmaps instead of an insertion per flight
+        connection_scan.sort();
+        availability_index.build();
     }
 
     /// @brief Loads all the flights 
     /// @param planes Currently loaded plane to link them to the flights
     /// @return vector of loaded flights
     static vector<Flight> loadAll(vector<Airplane> &planes) {
+        STATS_TIMER(LOAD_FLIGHTS);
+        TRACE_SPAN("Flight::loadAll", save_path.c_str());
         vector<Flight> flights;
-        ifstream reader;
-        reader.open(save_path);
-        if (reader.fail()) {
-            cerr << "Error loading planes..." << endl;
-            reader.close();
+        LoadStats::unresolved_planes = 0;
+        IdRegistry<Airplane> plane_registry(planes);
+        uint64_t resume_offset = loadSnapshot(flights, plane_registry);
+        num_flights = flights.size();
+        string plain;
+        if (!RecordFile::readPlain(save_path, resume_offset, plain)) {
+            cerr << "Error loading flights..." << endl;
+            num_flights = 0;
             return vector<Flight>();
         }
-        string temp;
-        num_flights = 0;
-        while (getline(reader, temp)) {
-            num_flights++;
-            string flightID, planeID, t_depart, t_arrive, origin, destination;
-            double price;
-            vector<double> category_price;
-            stringstream s_stream(temp);
-            getline(s_stream, temp, ',');
-            flightID = decrypt(temp);
-            getline(s_stream, temp, ',');
-            planeID = decrypt(temp);
-            Airplane* plane = findPlanefromID(planeID, planes);
-            getline(s_stream, temp, ',');
-            t_depart = decrypt(temp);
-            getline(s_stream, temp, ',');
-            t_arrive = decrypt(temp);
-            getline(s_stream, temp, ',');
-            origin = decrypt(temp);
-            getline(s_stream, temp, ',');
-            destination = decrypt(temp);
-            for (int i = 0; i < plane->getNumCategories(); i++) {
-                getline(s_stream, temp, ',');
-                temp = decrypt(temp);
-                category_price.push_back(stod(temp));
-            }
-            flights.push_back(Flight(flightID, plane, Conversions::tm_conversions::date_time_to_tm(t_depart.substr(6, 10), t_depart.substr(0, 5)), Conversions::tm_conversions::date_time_to_tm(t_arrive.substr(6, 10), t_arrive.substr(0, 5)), string_to_Airport(origin), string_to_Airport(destination), category_price));
-            vector<string> seats_vec;
-            for (int i = 0; i < plane->getNumCategories(); i++) {
-                getline(s_stream, temp, ',');
-                temp = decrypt(temp);
-                seats_vec.push_back(temp);
-            }
-
-            flights[flights.size() - 1].AssignSeatStatesfromStrings(seats_vec);
-
-        }
-        reader.close();
+        num_flights += parseRecords(plain, flights, plane_registry);
+        finishLoad(flights);
         return flights;
     }
 
+    /// @brief Sets the number of flights after they were loaded without loadAll
+    static void setCount(int count) { num_flights = count; }
+
+    /// @brief Gives the path of the storage file
+    static string getSavePath() { return save_path; }
+
 };
 
 // Static variables
 const string Flight::save_path = "SaveData/Flights.csv";
 int Flight::num_flights = 0;
+RouteIndex Flight::route_index;
+ConnectionScan Flight::connection_scan;
+FareCalendar Flight::fare_calendar;
+AvailabilityIndex Flight::availability_index;
 
 #endif
\ No newline at end of file
@@ -0,0 +1,99 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <atomic>
+#include "Trace.h"
+#ifndef IDREGISTRY_H
+#define IDREGISTRY_H
+
+using namespace std;
+
+/// @brief Constant time lookup from string ID to loaded object.
+/// IDs generated from the object counters are numbers, so they go to a table indexed by the number, any other ID goes to a hash map.
+template <class T>
+class IdRegistry {
+    private:
+    /// @brief Objects with numeric IDs, indexed by the ID
+    vector<T*> dense;
+    /// @brief Objects with any other ID
+    unordered_map<string, T*> sparse;
+    /// @brief Largest numeric ID kept in the dense table
+    size_t dense_limit;
+
+    /// @brief Reads a numeric ID
+    /// @param ID ID to read
+    /// @param index Set to the number
+    /// @return False if the ID is not a plain number
+    static bool parseIndex(const string &ID, size_t &index) {
+        if (ID.empty() || ID.length() > 9 || (ID[0] == '0' && ID.length() > 1))
+            return false;
+        index = 0;
+        for (int i = 0; i < ID.length(); i++) {
+            if (ID[i] < '0' || ID[i] > '9')
+                return false;
+            index = index * 10 + (ID[i] - '0');
+        }
+        return true;
+    }
+
+    public:
+    /// @brief Creates an empty registry
+    /// @param expected Expected number of objects, used to size the dense table
+    IdRegistry(size_t expected = 0) {
+        dense_limit = max((size_t) 1024, 4 * expected);
+        dense.reserve(expected);
+    }
+
+    /// @brief Creates a registry of all objects in a vector
+    /// @param items Vector of loaded objects passed by reference
+    IdRegistry(vector<T> &items) : IdRegistry(items.size()) {
+        TRACE_SPAN("IdRegistry build");
+        for (int i = 0; i < items.size(); i++)
+            add(items[i].getID(), &items[i]);
+    }
+
+    /// @brief Adds an object
+    /// @param ID ID of the object
+    /// @param item Pointer to the object
+    void add(const string &ID, T* item) {
+        size_t index;
+        if (parseIndex(ID, index) && index < dense_limit) {
+            if (index >= dense.size())
+                dense.resize(index + 1, nullptr);
+            dense[index] = item;
+        }
+        else
+            sparse[ID] = item;
+    }
+
+    /// @brief Finds an object by ID
+    /// @param ID ID to search for
+    /// @return Pointer to the object or nullptr if there is none
+    T* find(const string &ID) const {
+        size_t index;
+        if (parseIndex(ID, index) && index < dense_limit)
+            return index < dense.size() ? dense[index] : nullptr;
+        auto it = sparse.find(ID);
+        return it == sparse.end() ? nullptr : it->second;
+    }
+};
+
+/// @brief Statistics of the last load of each storage file. Atomic since a file may be parsed on several threads
+namespace LoadStats {
+
+    /// @brief Flights whose plane ID did not match a loaded plane
+    atomic<int> unresolved_planes(0);
+    /// @brief Records whose client ID did not match a loaded client
+    atomic<int> unresolved_clients(0);
+    /// @brief Records whose inventory ID did not match a loaded inventory item
+    atomic<int> unresolved_inventory(0);
+
+    /// @brief Prints the number of references that could not be resolved
+    /// @param out Stream to print to
+    void print(ostream &out) {
+        out << "Unresolved references | Planes: " << unresolved_planes << " | Clients: " << unresolved_clients << " | Inventory: " << unresolved_inventory << endl;
+    }
+}
+
+#endif
@@ -41,7 +41,7 @@ class Inventory {
     /// @param client
     /// @param reservation_date 
     /// @return Record (PNR) of the transaction
-    virtual Record Purchase(Client* client, tm reservation_date) = 0;
+    virtual Record Purchase(Client* client, DateTime reservation_date) = 0;
 
 };
 #endif
\ No newline at end of file
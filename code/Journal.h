@@ -0,0 +1,303 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <unordered_map>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include "Trace.h"
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+using namespace std;
+
+/// @brief Append-only write-ahead journal of seat bookings. Flights.csv is only a checkpoint, the journal holds every seat change made since then.
+/// Every time the journal is emptied it starts a new generation, written as its first entry, so entries of an emptied journal are never mistaken for new ones
+class BookingJournal {
+    public:
+    /// @brief Kind of seat change stored in an entry. A GENERATION entry heads the journal and holds the generation number in flight_ID
+    enum Operation : uint8_t { RESERVE = 'R', CANCEL = 'C', GENERATION = 'G' };
+
+    /// @brief Fixed size (12 byte) journal entry
+    struct Entry {
+        uint32_t flight_ID;
+        uint16_t row;
+        uint8_t category;
+        uint8_t col;
+        uint8_t op;
+        uint8_t reserved_byte;
+        /// @brief Checksum of the first 10 bytes, used to detect entries torn by a crash
+        uint16_t checksum;
+    };
+
+    private:
+    /// @brief Path of the journal file
+    static const string save_path;
+    /// @brief Number of journal entries after which a checkpoint of Flights.csv is due
+    static const int checkpoint_interval;
+    /// @brief Number of entries currently in the journal, atomic as bookings on several threads append to it
+    static atomic<int> num_entries;
+    /// @brief Entries of the journal whose change this process already holds in its seat maps, because it read them
+    /// at load time or wrote them itself. A checkpoint only replays the other entries, which other processes wrote,
+    /// so it never undoes a change this process made after journaling an older one for the same seat
+    static vector<Entry> applied;
+    /// @brief Generation of the journal the applied entries were read from or written to
+    static uint32_t applied_generation;
+    static mutex applied_lock;
+
+    /// @brief Fletcher-16 checksum over the payload bytes of an entry
+    /// @param entry Entry to check
+    /// @return Checksum value
+    static uint16_t computeChecksum(const Entry &entry) {
+        const uint8_t* bytes = (const uint8_t*) &entry;
+        uint16_t sum1 = 0x4D, sum2 = 0x4A;
+        for (int i = 0; i < (int) offsetof(Entry, checksum); i++) {
+            sum1 = (sum1 + bytes[i]) % 255;
+            sum2 = (sum2 + sum1) % 255;
+        }
+        return (sum2 << 8) | sum1;
+    }
+
+    /// @brief Picks the number of a new journal generation. Taken from the clock, so a journal emptied by another process
+    /// or by hand does not come back with a generation seen before
+    static uint32_t newGeneration() {
+        uint32_t generation = (uint32_t) chrono::duration_cast<chrono::microseconds>(chrono::system_clock::now().time_since_epoch()).count();
+        return generation == 0 ? 1 : generation;
+    }
+
+    /// @brief Checks if an entry is complete and of a known kind
+    static bool isValid(const Entry &entry) {
+        return computeChecksum(entry) == entry.checksum && (entry.op == RESERVE || entry.op == CANCEL || entry.op == GENERATION);
+    }
+
+    /// @brief Reads the generation of the locked journal
+    /// @param fd Descriptor of the journal
+    /// @return Generation, 0 for a journal without a generation entry
+    static uint32_t readGeneration(int fd) {
+        Entry header;
+        if (pread(fd, &header, sizeof(header), 0) != sizeof(header) || !isValid(header) || header.op != GENERATION)
+            return 0;
+        return header.flight_ID;
+    }
+
+    /// @brief Counts entries as applied. Entries of an older generation are dropped first, as they are gone from the journal
+    /// @param entries Entries to count
+    /// @param generation Generation of the journal they belong to
+    static void markApplied(const vector<Entry> &entries, uint32_t generation) {
+        lock_guard<mutex> guard(applied_lock);
+        if (generation != applied_generation) {
+            applied.clear();
+            applied_generation = generation;
+        }
+        applied.insert(applied.end(), entries.begin(), entries.end());
+    }
+
+    /// @brief Opens the journal file and takes an exclusive lock on it so that several processes can share it
+    /// @param flags open flags
+    /// @return File descriptor or -1 on failure
+    static int openLocked(int flags) {
+        int fd = open(save_path.c_str(), flags | O_CLOEXEC, 0644);
+        if (fd < 0)
+            return -1;
+        flock(fd, LOCK_EX);
+        return fd;
+    }
+
+    public:
+    /// @brief Creates a complete entry
+    /// @param op RESERVE or CANCEL
+    /// @param flight_ID
+    /// @param category
+    /// @param row
+    /// @param col
+    /// @return Entry with its checksum filled in
+    static Entry makeEntry(Operation op, uint32_t flight_ID, int category, int row, int col) {
+        Entry entry;
+        memset(&entry, 0, sizeof(entry));
+        entry.flight_ID = flight_ID;
+        entry.row = (uint16_t) row;
+        entry.category = (uint8_t) category;
+        entry.col = (uint8_t) col;
+        entry.op = op;
+        entry.checksum = computeChecksum(entry);
+        return entry;
+    }
+
+    /// @brief Appends entries to the journal with a single write so a group of changes is committed together
+    /// @param entries Entries to append
+    /// @return True if the entries reached the disk, false otherwise
+    static bool append(const vector<Entry> &entries) {
+        TRACE_SPAN("BookingJournal::append");
+        if (entries.empty())
+            return true;
+        int fd = openLocked(O_RDWR | O_APPEND | O_CREAT);
+        if (fd < 0) {
+            cerr << "Error writing booking journal..." << endl;
+            return false;
+        }
+        // A torn tail left by an earlier crash would misalign every following entry, so cut it off first
+        struct stat info;
+        if (fstat(fd, &info) != 0 || (info.st_size % sizeof(Entry) != 0 && ftruncate(fd, info.st_size - info.st_size % sizeof(Entry)) != 0)) {
+            close(fd);
+            cerr << "Error writing booking journal..." << endl;
+            return false;
+        }
+        // An empty journal starts a new generation
+        uint32_t generation = readGeneration(fd);
+        vector<Entry> data;
+        if (info.st_size < (off_t) sizeof(Entry)) {
+            generation = newGeneration();
+            data.push_back(makeEntry(GENERATION, generation, 0, 0, 0));
+        }
+        data.insert(data.end(), entries.begin(), entries.end());
+        size_t size = data.size() * sizeof(Entry);
+        bool written = write(fd, data.data(), size) == (ssize_t) size;
+        // Counted as applied while the file is still locked, so a checkpoint never reads the entries without knowing they are ours
+        if (written)
+            markApplied(entries, generation);
+        written = written && fdatasync(fd) == 0;
+        close(fd);
+        if (!written) {
+            cerr << "Error writing booking journal..." << endl;
+            return false;
+        }
+        num_entries += entries.size();
+        return true;
+    }
+
+    /// @brief Appends a single entry to the journal
+    /// @param entry Entry to append
+    /// @return True if the entry reached the disk, false otherwise
+    static bool append(const Entry &entry) {
+        return append(vector<Entry>(1, entry));
+    }
+
+    /// @brief Reads all valid seat changes of the journal. Reading stops at the first torn or corrupted entry
+    /// @param generation Set to the generation of the journal, 0 if it has none
+    /// @return Vector of journal entries in the order they were written
+    static vector<Entry> readAll(uint32_t &generation) {
+        vector<Entry> entries;
+        generation = 0;
+        int fd = open(save_path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            num_entries = 0;
+            return entries; // No journal means no changes since the last checkpoint
+        }
+        Entry entry;
+        while (read(fd, &entry, sizeof(entry)) == sizeof(entry)) {
+            if (!isValid(entry))
+                break;
+            if (entry.op == GENERATION)
+                generation = entry.flight_ID;
+            else
+                entries.push_back(entry);
+        }
+        close(fd);
+        num_entries = entries.size();
+        return entries;
+    }
+
+    /// @brief Reads all valid seat changes of the journal. Reading stops at the first torn or corrupted entry
+    /// @return Vector of journal entries in the order they were written
+    static vector<Entry> readAll() {
+        uint32_t generation;
+        return readAll(generation);
+    }
+
+    /// @brief Reads the entries this process has not applied yet, i.e. the ones other processes wrote since it loaded
+    /// or last replayed the journal, and counts them as applied. Call it with the journal locked
+    /// @return Vector of unapplied journal entries in the order they were written
+    static vector<Entry> readUnapplied() {
+        uint32_t generation;
+        vector<Entry> entries = readAll(generation);
+        // Each applied entry of the same generation accounts for one identical entry of the journal
+        unordered_map<string, int> known;
+        {
+            lock_guard<mutex> guard(applied_lock);
+            for (int i = 0; generation == applied_generation && i < applied.size(); i++)
+                known[string((const char*) &applied[i], sizeof(Entry))]++;
+        }
+        vector<Entry> unapplied;
+        for (int i = 0; i < entries.size(); i++) {
+            auto it = known.find(string((const char*) &entries[i], sizeof(Entry)));
+            if (it != known.end() && it->second > 0)
+                it->second--;
+            else
+                unapplied.push_back(entries[i]);
+        }
+        markApplied(unapplied, generation);
+        return unapplied;
+    }
+
+    /// @brief Forgets which entries were applied, for when the seat maps are loaded again from the checkpoint
+    static void forgetApplied() {
+        lock_guard<mutex> guard(applied_lock);
+        applied.clear();
+    }
+
+    /// @brief Locks the journal for the duration of a checkpoint so no booking is lost while Flights.csv is rewritten
+    /// @return File descriptor holding the lock or -1 on failure
+    static int lock() {
+        return openLocked(O_RDWR | O_CREAT);
+    }
+
+    /// @brief Empties the journal once its entries are part of a checkpoint, starting a new generation, and releases the lock
+    /// @param fd Descriptor returned by lock()
+    /// @param kept Entries the checkpoint could not fold in, written back into the new generation
+    /// @return True if the journal was emptied, false otherwise
+    static bool clearAndUnlock(int fd, const vector<Entry> &kept) {
+        TRACE_SPAN("BookingJournal::clear");
+        uint32_t generation = newGeneration();
+        vector<Entry> data(1, makeEntry(GENERATION, generation, 0, 0, 0));
+        data.insert(data.end(), kept.begin(), kept.end());
+        size_t size = data.size() * sizeof(Entry);
+        bool cleared = ftruncate(fd, 0) == 0 && pwrite(fd, data.data(), size, 0) == (ssize_t) size && fdatasync(fd) == 0;
+        if (cleared) {
+            num_entries = kept.size();
+            // This process already went through the kept entries, they are for flights it does not hold
+            lock_guard<mutex> guard(applied_lock);
+            applied = kept;
+            applied_generation = generation;
+        }
+        close(fd);
+        return cleared;
+    }
+
+    /// @brief Empties the journal once its entries are part of a checkpoint and releases the lock
+    /// @param fd Descriptor returned by lock()
+    /// @return True if the journal was emptied, false otherwise
+    static bool clearAndUnlock(int fd) {
+        return clearAndUnlock(fd, vector<Entry>());
+    }
+
+    /// @brief Releases the lock without changing the journal
+    /// @param fd Descriptor returned by lock()
+    static void unlock(int fd) {
+        close(fd);
+    }
+
+    /// @brief Checks if enough entries piled up to justify rewriting Flights.csv
+    /// @return True if a checkpoint is due
+    static bool checkpointDue() {
+        return num_entries >= checkpoint_interval;
+    }
+
+    static string getSavePath() { return save_path; }
+};
+
+// Static variables
+const string BookingJournal::save_path = "SaveData/Bookings.journal";
+const int BookingJournal::checkpoint_interval = 256;
+atomic<int> BookingJournal::num_entries{0};
+vector<BookingJournal::Entry> BookingJournal::applied;
+uint32_t BookingJournal::applied_generation = 0;
+mutex BookingJournal::applied_lock;
+
+#endif
@@ -0,0 +1,272 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include "Flight.h"
+#ifndef PARALLELLOADER_H
+#define PARALLELLOADER_H
+
+using namespace std;
+
+/// @brief Loads the storage files on a pool of worker threads.
+/// Every file is split into parts of whole records that are decoded and parsed in parallel. The parts are joined in file order
+/// and references between files (flight to plane, record to client and seat) are resolved in a final pass,
+/// so the loaded objects are the same as with the loadAll functions.
+namespace ParallelLoader {
+
+    /// @brief Number of worker threads, 0 for one per core
+    unsigned worker_count = 0;
+
+    /// @brief Parts per worker each file is split into, so workers that finish early can take over the rest
+    const size_t parts_per_worker = 4;
+
+    /// @brief Gives the number of worker threads to use
+    unsigned workers() {
+        if (worker_count > 0)
+            return worker_count;
+        return max(1u, thread::hardware_concurrency());
+    }
+
+    /// @brief Runs tasks on the worker pool and waits until all of them are done
+    /// @param count Number of tasks
+    /// @param task Called with the number of each task
+    void runTasks(size_t count, const function<void(size_t)> &task) {
+        atomic<size_t> next(0);
+        auto work = [&]() {
+            for (size_t i = next++; i < count; i = next++)
+                task(i);
+        };
+        vector<thread> threads;
+        for (size_t i = 1; i < min((size_t) workers(), count); i++)
+            threads.emplace_back(work);
+        work();
+        for (int i = 0; i < threads.size(); i++)
+            threads[i].join();
+    }
+
+    /// @brief A storage file being loaded
+    struct FileLoad {
+        /// @brief False if the file is not loaded
+        bool wanted = false;
+        Source source;
+        string path;
+        /// @brief Byte offset the parts were decoded from
+        uint64_t offset = 0;
+        /// @brief False if the file could not be read
+        bool read = false;
+        RecordFile::Chunks chunks;
+        /// @brief Plain text of each part in file order
+        vector<string> plain;
+    };
+
+    /// @brief Splits a storage file where the snapshot ends
+    void splitFile(FileLoad &file) {
+        if (!file.wanted)
+            return;
+        Snapshot::get().covers(file.source, file.path, file.offset);
+        file.read = RecordFile::split(file.path, file.offset, workers() * parts_per_worker, file.chunks);
+        file.plain.assign(file.read ? file.chunks.size() : 0, "");
+    }
+
+    /// @brief Decodes the parts of several files together on the worker pool
+    void decodeFiles(vector<FileLoad*> files) {
+        TRACE_SPAN("ParallelLoader::decodeFiles");
+        vector<pair<FileLoad*, size_t>> tasks;
+        for (int f = 0; f < files.size(); f++) {
+            for (size_t i = 0; i < files[f]->plain.size(); i++)
+                tasks.push_back({files[f], i});
+        }
+        runTasks(tasks.size(), [&](size_t i) {
+            RecordFile::decodeChunk(tasks[i].first->chunks, tasks[i].second, tasks[i].first->plain[tasks[i].second]);
+        });
+        for (int f = 0; f < files.size(); f++) {
+            files[f]->chunks.contents = string();
+        }
+    }
+
+    /// @brief Makes sure the parts start where the snapshot ends.
+    /// The snapshot can still turn out to be out of date once its entries are checked, then the whole file is decoded again
+    /// @param file File being loaded
+    /// @param offset Offset returned by loading the snapshot
+    void resumeAt(FileLoad &file, uint64_t offset) {
+        if (!file.read || file.offset == offset)
+            return;
+        file.offset = offset;
+        file.plain.assign(1, "");
+        file.read = RecordFile::readPlain(file.path, offset, file.plain[0]);
+    }
+
+    /// @brief Parses the parts of a file on the worker pool and joins the objects in file order
+    /// @param file File being loaded
+    /// @param items Vector to add the objects to
+    /// @param parse Parses one part into a vector and returns the number of records read
+    /// @return Number of records read over all parts
+    template <class T>
+    int parseParts(FileLoad &file, vector<T> &items, const function<int(string_view, vector<T>&)> &parse) {
+        vector<vector<T>> parts(file.plain.size());
+        vector<int> counts(file.plain.size(), 0);
+        runTasks(parts.size(), [&](size_t i) {
+            counts[i] = parse(file.plain[i], parts[i]);
+        });
+        size_t total = items.size();
+        for (int i = 0; i < parts.size(); i++)
+            total += parts[i].size();
+        items.reserve(total);
+        int count = 0;
+        for (int i = 0; i < parts.size(); i++) {
+            for (int j = 0; j < parts[i].size(); j++)
+                items.push_back(move(parts[i][j]));
+            count += counts[i];
+        }
+        return count;
+    }
+
+    /// @brief Loads the requested storage files. Files whose vector is nullptr are not loaded
+    /// @param planes Filled with the planes
+    /// @param flights Filled with the flights (needs planes)
+    /// @param clients Filled with the clients
+    /// @param records Filled with the records (needs flights and clients_for_records)
+    /// @param clients_for_records Clients to link the records to, if the clients are not loaded here
+    void loadFiles(vector<Airplane>* planes, vector<Flight>* flights, vector<Client>* clients, vector<Record>* records, vector<Client>* clients_for_records = nullptr) {
+        STATS_TIMER(LOAD_FILES);
+        TRACE_SPAN("ParallelLoader::loadFiles");
+        // With a single worker there is nothing to split, the sequential loaders avoid holding whole files in memory
+        if (workers() == 1) {
+            if (planes != nullptr)
+                *planes = Airplane::loadAll();
+            if (flights != nullptr)
+                *flights = Flight::loadAll(*planes);
+            if (clients != nullptr)
+                *clients = Client::loadAll();
+            if (records != nullptr) {
+                IdRegistry<Flight> flight_registry(*flights);
+                *records = Record::loadAll(clients != nullptr ? *clients : *clients_for_records, [&](const string &ID) -> Inventory* { return Flight::findSeatfromID(ID, flight_registry); });
+            }
+            return;
+        }
+        FileLoad plane_file, flight_file, client_file, record_file;
+        plane_file = {planes != nullptr, AIRPLANES_CSV, Airplane::getSavePath()};
+        flight_file = {flights != nullptr, FLIGHTS_CSV, Flight::getSavePath()};
+        client_file = {clients != nullptr, CLIENTS_CSV, Client::getSavePath()};
+        record_file = {records != nullptr, RECORDS_CSV, Record::getSavePath()};
+        vector<FileLoad*> files = {&plane_file, &flight_file, &client_file, &record_file};
+
+        // Read and decode all files at once, decryption is most of the work
+        for (int i = 0; i < files.size(); i++)
+            splitFile(*files[i]);
+        decodeFiles(files);
+
+        if (planes != nullptr) {
+            planes->clear();
+            resumeAt(plane_file, Airplane::loadSnapshot(*planes));
+            int count = planes->size();
+            if (!plane_file.read) {
+                cerr << "Error loading planes..." << endl;
+                planes->clear();
+            }
+            else
+                count += parseParts<Airplane>(plane_file, *planes, [](string_view plain, vector<Airplane> &part) { return Airplane::parseRecords(plain, part); });
+            Airplane::setCount(count);
+        }
+
+        // Flights and clients do not depend on each other, so their parts are parsed together
+        vector<Airplane> no_planes;
+        IdRegistry<Airplane> plane_registry(planes != nullptr ? *planes : no_planes);
+        vector<pair<FileLoad*, size_t>> tasks;
+        vector<vector<Flight>> flight_parts;
+        vector<vector<Client>> client_parts;
+        vector<int> flight_counts, client_counts;
+        int flight_count = 0, client_count = 0;
+        if (flights != nullptr) {
+            flights->clear();
+            LoadStats::unresolved_planes = 0;
+            resumeAt(flight_file, Flight::loadSnapshot(*flights, plane_registry));
+            flight_count = flights->size();
+            flight_parts.resize(flight_file.read ? flight_file.plain.size() : 0);
+            flight_counts.assign(flight_parts.size(), 0);
+            for (size_t i = 0; i < flight_parts.size(); i++)
+                tasks.push_back({&flight_file, i});
+        }
+        if (clients != nullptr) {
+            clients->clear();
+            resumeAt(client_file, Client::loadSnapshot(*clients));
+            client_count = clients->size();
+            client_parts.resize(client_file.read ? client_file.plain.size() : 0);
+            client_counts.assign(client_parts.size(), 0);
+            for (size_t i = 0; i < client_parts.size(); i++)
+                tasks.push_back({&client_file, i});
+        }
+        runTasks(tasks.size(), [&](size_t i) {
+            size_t part = tasks[i].second;
+            if (tasks[i].first == &flight_file)
+                flight_counts[part] = Flight::parseRecords(flight_file.plain[part], flight_parts[part], plane_registry);
+            else
+                client_counts[part] = Client::parseRecords(client_file.plain[part], client_parts[part]);
+        });
+        if (flights != nullptr) {
+            if (!flight_file.read) {
+                cerr << "Error loading flights..." << endl;
+                flights->clear();
+            }
+            for (int i = 0; i < flight_parts.size(); i++) {
+                for (int j = 0; j < flight_parts[i].size(); j++)
+                    flights->push_back(move(flight_parts[i][j]));
+                flight_count += flight_counts[i];
+            }
+            Flight::setCount(flight_count);
+            if (flight_file.read)
+                Flight::finishLoad(*flights);
+        }
+        if (clients != nullptr) {
+            if (!client_file.read) {
+                cerr << "Error loading clients..." << endl;
+                clients->clear();
+            }
+            for (int i = 0; i < client_parts.size(); i++) {
+                for (int j = 0; j < client_parts[i].size(); j++)
+                    clients->push_back(move(client_parts[i][j]));
+                client_count += client_counts[i];
+            }
+            Client::setCount(client_count);
+        }
+
+        // Records are linked to clients and seats in a final pass in file order. Seats are created on first use, so this stays on one thread
+        if (records != nullptr) {
+            TRACE_SPAN("ParallelLoader::linkRecords");
+            records->clear();
+            LoadStats::unresolved_clients = 0;
+            LoadStats::unresolved_inventory = 0;
+            IdRegistry<Client> client_registry(clients != nullptr ? *clients : *clients_for_records);
+            IdRegistry<Flight> flight_registry(*flights);
+            function<Inventory*(const string&)> findInventory = [&](const string &ID) -> Inventory* { return Flight::findSeatfromID(ID, flight_registry); };
+            int count;
+            resumeAt(record_file, Record::loadSnapshot(*records, client_registry, findInventory, count));
+            if (!record_file.read)
+                cerr << "Error loading records..." << endl;
+            for (int i = 0; record_file.read && i < record_file.plain.size(); i++)
+                count += Record::parseRecords(record_file.plain[i], *records, client_registry, findInventory);
+            Record::setCount(count);
+            if (LoadStats::unresolved_clients + LoadStats::unresolved_inventory > 0)
+                LoadStats::print(cerr);
+        }
+    }
+
+    /// @brief Loads the planes and flights
+    void loadFlights(vector<Airplane> &planes, vector<Flight> &flights) {
+        loadFiles(&planes, &flights, nullptr, nullptr);
+    }
+
+    /// @brief Loads the planes, flights and the records linked to already loaded clients
+    void loadFlightsAndRecords(vector<Airplane> &planes, vector<Flight> &flights, vector<Client> &clients, vector<Record> &records) {
+        loadFiles(&planes, &flights, nullptr, &records, &clients);
+    }
+
+    /// @brief Loads the clients
+    void loadClients(vector<Client> &clients) {
+        loadFiles(nullptr, nullptr, &clients, nullptr);
+    }
+}
+
+#endif
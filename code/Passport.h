@@ -13,30 +13,31 @@ class Passport {
     char type;
     const string name;
     const CountryEnum country;
-    const tm DoB;
-    const tm DoI;
-    const tm DoE;
+    const DateTime DoB;
+    const DateTime DoI;
+    const DateTime DoE;
     const char sex;
     public:
-    Passport(string ID, char type, string name, CountryEnum country, tm DoB, tm DoI, tm DoE, char sex) : ID(ID), type(type), name(name), country(country), DoB(DoB), DoI(DoI), DoE(DoE), sex(sex){}
+    Passport(string ID, char type, string name, CountryEnum country, DateTime DoB, DateTime DoI, DateTime DoE, char sex) : ID(ID), type(type), name(name), country(country), DoB(DoB), DoI(DoI), DoE(DoE), sex(sex){}
 
     // Getter functions
     string getID() const { return ID; }
     char getType() const { return type; }
     string getName() const { return name; }
     CountryEnum getCountry() const { return country; }
-    tm getDoB() const { return DoB; }
-    tm getDoI() const { return DoI; }
-    tm getDoE() const { return DoE; }
+    DateTime getDoB() const { return DoB; }
+    DateTime getDoI() const { return DoI; }
+    DateTime getDoE() const { return DoE; }
     char getSex() const { return sex; } 
 
     /// @brief Prints passport details
-    void print_details() const {
-        cout << "Passport Holder: " << name << " | Sex: " << sex << endl;
-        cout << "Country: " << CountryEnum_to_string(country) << endl;
-        cout << "Passport Number: " << ID << " | Type: " << type << endl;
-        cout << "DoB: " << tm_to_date(DoB) << endl;
-        cout << "DoI: " << tm_to_date(DoI) << " | DoE: " << tm_to_date(DoE) << endl;
+    /// @param out Stream to print to
+    void print_details(ostream &out = cout) const {
+        out << "Passport Holder: " << name << " | Sex: " << sex << endl;
+        out << "Country: " << CountryEnum_to_string(country) << endl;
+        out << "Passport Number: " << ID << " | Type: " << type << endl;
+        out << "DoB: " << DateTime_to_date(DoB) << endl;
+        out << "DoI: " << DateTime_to_date(DoI) << " | DoE: " << DateTime_to_date(DoE) << endl;
     }
 
 };
@@ -0,0 +1,441 @@
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include "Flight.h"
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+using namespace std;
+
+/// @brief Binary protocol between the booking server and the interfaces.
+/// Every message is a frame: a 4 byte payload length, a 1 byte type (the request, or the status of a response) and the payload.
+/// Numbers are written in host byte order since both ends run on the same machine, strings are a 2 byte length followed by their bytes.
+namespace Protocol {
+
+    /// @brief Unix domain socket the booking server listens on, next to the files it serves
+    const string socket_path = "SaveData/Booking.sock";
+
+    /// @brief Largest payload accepted, a frame announcing more is treated as a broken connection
+    const uint32_t max_payload = 64 << 20;
+
+    /// @brief Type of a request frame
+    enum Request : uint8_t {
+        LOGIN = 1,
+        SIGN_UP,
+        SEARCH,
+        SEAT_MAP,
+        BOOK,
+        CANCEL,
+        LIST_PLANES,
+        CREATE_PLANE,
+        LIST_FLIGHTS,
+        CREATE_FLIGHT,
+        RESET,
+        STATS,
+        SEARCH_CONNECTIONS,
+        ROUND_TRIPS,
+        FARE_CALENDAR,
+        FIND_AVAILABLE,
+        BOOK_GROUP,
+        BOOK_TRIP
+    };
+
+    /// @brief Type of a response frame
+    enum Status : uint8_t {
+        OK,
+        /// @brief The request was understood but could not be done, e.g. wrong password or taken username
+        FAILED,
+        NO_SUCH_SEAT,
+        ALREADY_RESERVED,
+        NOT_RESERVED,
+        /// @brief The payload did not match the request or referred to something that does not exist
+        BAD_REQUEST,
+        /// @brief The booking could not be written to storage and was undone
+        NOT_SAVED,
+        /// @brief Bookings and cancellations are made as the client logged in on the connection, and none is
+        NOT_LOGGED_IN
+    };
+
+    /// @brief Builds the payload of a frame
+    class Writer {
+        private:
+        string data;
+
+        template <class T>
+        void addRaw(T value) {
+            data.append((const char*) &value, sizeof(value));
+        }
+
+        public:
+        void addU8(uint8_t value) { addRaw(value); }
+        void addU16(uint16_t value) { addRaw(value); }
+        void addU32(uint32_t value) { addRaw(value); }
+        void addInt(int32_t value) { addRaw(value); }
+        void addLong(int64_t value) { addRaw(value); }
+        void addU64(uint64_t value) { addRaw(value); }
+        void addDouble(double value) { addRaw(value); }
+        void addDateTime(DateTime value) { addRaw(value.getMinutes()); }
+
+        /// @brief Adds a string of up to 65535 bytes, longer strings are cut
+        void addString(string_view value) {
+            uint16_t length = min(value.length(), (size_t) UINT16_MAX);
+            addRaw(length);
+            data.append(value.data(), length);
+        }
+
+        const string& bytes() const { return data; }
+    };
+
+    /// @brief Reads the payload of a frame. Every read fails once the payload is exhausted, so a request can be read completely and checked once
+    class Reader {
+        private:
+        string_view rest;
+        bool good = true;
+
+        template <class T>
+        bool nextRaw(T &value) {
+            if (!good || rest.length() < sizeof(value))
+                return good = false;
+            memcpy(&value, rest.data(), sizeof(value));
+            rest.remove_prefix(sizeof(value));
+            return true;
+        }
+
+        public:
+        /// @param payload Payload to read, must outlive the reader
+        explicit Reader(string_view payload) : rest(payload) {}
+
+        bool nextU8(uint8_t &value) { return nextRaw(value); }
+        bool nextU16(uint16_t &value) { return nextRaw(value); }
+        bool nextU32(uint32_t &value) { return nextRaw(value); }
+        bool nextInt(int32_t &value) { return nextRaw(value); }
+        bool nextLong(int64_t &value) { return nextRaw(value); }
+        bool nextU64(uint64_t &value) { return nextRaw(value); }
+        bool nextDouble(double &value) { return nextRaw(value); }
+
+        bool nextDateTime(DateTime &value) {
+            int32_t minutes;
+            if (!nextRaw(minutes))
+                return false;
+            value = DateTime(minutes);
+            return true;
+        }
+
+        bool nextString(string &value) {
+            uint16_t length;
+            if (!nextRaw(length) || rest.length() < length)
+                return good = false;
+            value.assign(rest.data(), length);
+            rest.remove_prefix(length);
+            return true;
+        }
+
+        /// @brief Checks that every read so far succeeded
+        bool ok() const { return good; }
+    };
+
+    /// @brief Writes a whole buffer, retrying on short writes
+    /// @return False if the connection is broken
+    inline bool writeAll(int fd, const char* data, size_t size) {
+        while (size > 0) {
+            ssize_t written = write(fd, data, size);
+            if (written < 0 && errno == EINTR)
+                continue;
+            if (written <= 0)
+                return false;
+            data += written;
+            size -= written;
+        }
+        return true;
+    }
+
+    /// @brief Reads a whole buffer, retrying on short reads
+    /// @return False if the connection is closed or broken
+    inline bool readAll(int fd, char* data, size_t size) {
+        while (size > 0) {
+            ssize_t got = read(fd, data, size);
+            if (got < 0 && errno == EINTR)
+                continue;
+            if (got <= 0)
+                return false;
+            data += got;
+            size -= got;
+        }
+        return true;
+    }
+
+    /// @brief Appends one frame to a buffer
+    /// @param buffer Buffer to append to
+    /// @param type Request or status of the frame
+    /// @param payload Payload of the frame
+    inline void appendFrame(string &buffer, uint8_t type, const string &payload) {
+        uint32_t length = payload.length();
+        buffer.append((const char*) &length, 4);
+        buffer += (char) type;
+        buffer += payload;
+    }
+
+    /// @brief Looks for a complete frame at the start of a buffer, for readers that receive frames in pieces
+    /// @param buffer Received bytes
+    /// @param limit Largest payload accepted
+    /// @param size Set to the size of the whole frame once it is complete
+    /// @return False if the frame announces a payload over the limit
+    inline bool peekFrame(string_view buffer, uint32_t limit, size_t &size) {
+        size = 0;
+        if (buffer.length() < 5)
+            return true;
+        uint32_t length;
+        memcpy(&length, buffer.data(), 4);
+        if (length > limit)
+            return false;
+        if (buffer.length() >= 5 + (size_t) length)
+            size = 5 + (size_t) length;
+        return true;
+    }
+
+    /// @brief Sends one frame
+    /// @param fd Connected socket
+    /// @param type Request or status of the frame
+    /// @param payload Payload of the frame
+    /// @return False if the connection is broken
+    inline bool sendFrame(int fd, uint8_t type, const string &payload) {
+        // Header and payload go out in one write, so small frames are a single packet
+        string frame;
+        frame.reserve(5 + payload.length());
+        appendFrame(frame, type, payload);
+        return writeAll(fd, frame.data(), frame.length());
+    }
+
+    /// @brief Receives one frame
+    /// @param fd Connected socket
+    /// @param type Set to the request or status of the frame
+    /// @param payload Set to the payload of the frame
+    /// @return False if the connection is closed, broken or sent an oversized frame
+    inline bool receiveFrame(int fd, uint8_t &type, string &payload) {
+        char header[5];
+        if (!readAll(fd, header, 5))
+            return false;
+        uint32_t length;
+        memcpy(&length, header, 4);
+        if (length > max_payload)
+            return false;
+        type = header[4];
+        payload.resize(length);
+        return readAll(fd, &payload[0], length);
+    }
+
+    /// @brief Flight as listed to the interfaces, enough to print its information line
+    struct FlightSummary {
+        string ID;
+        Airport origin;
+        Airport destination;
+        DateTime t_depart;
+        DateTime t_arrive;
+        /// @brief Free seats and number of seats of each category, read from the flight's counters
+        vector<int> free_seats;
+        vector<int> capacity;
+
+        void write(Writer &out) const {
+            out.addString(ID);
+            out.addU16(origin);
+            out.addU16(destination);
+            out.addDateTime(t_depart);
+            out.addDateTime(t_arrive);
+            out.addU8(capacity.size());
+            for (int i = 0; i < capacity.size(); i++) {
+                out.addU32(free_seats[i]);
+                out.addU32(capacity[i]);
+            }
+        }
+
+        bool read(Reader &in) {
+            uint16_t from, to;
+            uint8_t categories;
+            if (!in.nextString(ID) || !in.nextU16(from) || !in.nextU16(to) || !in.nextDateTime(t_depart) || !in.nextDateTime(t_arrive) || !in.nextU8(categories))
+                return false;
+            if (from >= AirportInfo::size || to >= AirportInfo::size)
+                return false;
+            origin = (Airport) from;
+            destination = (Airport) to;
+            free_seats.assign(categories, 0);
+            capacity.assign(categories, 0);
+            for (int i = 0; i < categories; i++) {
+                uint32_t free, seats;
+                if (!in.nextU32(free) || !in.nextU32(seats))
+                    return false;
+                free_seats[i] = free;
+                capacity[i] = seats;
+            }
+            return true;
+        }
+
+        static FlightSummary of(const Flight &flight) {
+            FlightSummary summary = {flight.getID(), flight.getOrigin(), flight.getDestination(), flight.getT_Depart(), flight.getT_Arrive()};
+            const SeatMap* seat_map = flight.getSeatMap();
+            for (int i = 0; i < seat_map->getNumCategories(); i++) {
+                summary.free_seats.push_back(seat_map->getFree(i));
+                summary.capacity.push_back(seat_map->getCapacity(i));
+            }
+            return summary;
+        }
+
+        void print_info(ostream &out = cout) const {
+            Flight::printInfo(ID, origin, t_depart, destination, t_arrive, out);
+        }
+
+        void print_availability(ostream &out = cout) const {
+            Flight::printAvailability(free_seats, capacity, out);
+        }
+    };
+
+    /// @brief Seats wanted on one flight of a trip booked with BOOK_TRIP: given seats, or a group the server seats together
+    struct TripLeg {
+        string flight_ID;
+        int category = 0;
+        bool group = false;
+        /// @brief Travellers of a group
+        int group_size = 0;
+        Airplane::SeatPreference preference = Airplane::ANY_SEAT;
+        /// @brief Row and column of each seat, filled in from the response for a group
+        vector<pair<int, int>> seats;
+
+        void write(Writer &out) const {
+            out.addString(flight_ID);
+            out.addInt(category);
+            out.addU8(group);
+            out.addU16(group_size);
+            out.addU8(preference);
+            writeSeats(out);
+        }
+
+        bool read(Reader &in) {
+            uint8_t grouped, seat_preference;
+            uint16_t size;
+            if (!in.nextString(flight_ID) || !in.nextInt(category) || !in.nextU8(grouped) || !in.nextU16(size) || !in.nextU8(seat_preference)
+                || seat_preference > Airplane::AISLE_SEAT)
+                return false;
+            group = grouped;
+            group_size = size;
+            preference = (Airplane::SeatPreference) seat_preference;
+            return readSeats(in);
+        }
+
+        void writeSeats(Writer &out) const {
+            out.addU16(seats.size());
+            for (int i = 0; i < seats.size(); i++) {
+                out.addInt(seats[i].first);
+                out.addInt(seats[i].second);
+            }
+        }
+
+        bool readSeats(Reader &in) {
+            uint16_t count;
+            seats.clear();
+            if (!in.nextU16(count))
+                return false;
+            for (int i = 0; i < count; i++) {
+                int32_t row, col;
+                if (!in.nextInt(row) || !in.nextInt(col))
+                    return false;
+                seats.push_back(make_pair(row, col));
+            }
+            return true;
+        }
+    };
+
+    /// @brief Writes the [rows, columns] of each seat category
+    inline void writeDimensions(Writer &out, const vector<vector<int>> &dimensions) {
+        out.addU8(dimensions.size());
+        for (int i = 0; i < dimensions.size(); i++) {
+            out.addInt(dimensions[i][0]);
+            out.addInt(dimensions[i][1]);
+        }
+    }
+
+    /// @brief Reads the [rows, columns] of each seat category. Layouts that the seat map or the column letters cannot hold are rejected
+    inline bool readDimensions(Reader &in, vector<vector<int>> &dimensions) {
+        uint8_t count;
+        if (!in.nextU8(count))
+            return false;
+        dimensions.assign(count, vector<int>(2));
+        for (int i = 0; i < count; i++) {
+            if (!in.nextInt(dimensions[i][0]) || !in.nextInt(dimensions[i][1]))
+                return false;
+            if (dimensions[i][0] < 0 || dimensions[i][0] > UINT16_MAX || dimensions[i][1] < 0 || dimensions[i][1] > ColumnInfo::size)
+                return false;
+        }
+        return true;
+    }
+
+    inline void writePlane(Writer &out, const Airplane &plane) {
+        out.addString(plane.getID());
+        out.addString(plane.getModel());
+        writeDimensions(out, plane.getDimensions());
+    }
+
+    /// @brief Reads a plane and adds it to planes
+    inline bool readPlane(Reader &in, vector<Airplane> &planes) {
+        string ID, model;
+        vector<vector<int>> dimensions;
+        if (!in.nextString(ID) || !in.nextString(model) || !readDimensions(in, dimensions))
+            return false;
+        planes.push_back(Airplane(ID, model, dimensions.size(), dimensions));
+        return true;
+    }
+
+    inline void writePassport(Writer &out, const Passport &passport) {
+        out.addString(passport.getID());
+        out.addU8(passport.getType());
+        out.addString(passport.getName());
+        out.addU16((uint16_t) passport.getCountry());
+        out.addDateTime(passport.getDoB());
+        out.addDateTime(passport.getDoI());
+        out.addDateTime(passport.getDoE());
+        out.addU8(passport.getSex());
+    }
+
+    /// @brief Reads the fields of a passport
+    /// @return False if the payload is incomplete or the country is unknown
+    inline bool readPassport(Reader &in, string &ID, char &type, string &name, CountryEnum &country, DateTime &DoB, DateTime &DoI, DateTime &DoE, char &sex) {
+        uint8_t type_byte, sex_byte;
+        uint16_t country_index;
+        if (!in.nextString(ID) || !in.nextU8(type_byte) || !in.nextString(name) || !in.nextU16(country_index)
+            || !in.nextDateTime(DoB) || !in.nextDateTime(DoI) || !in.nextDateTime(DoE) || !in.nextU8(sex_byte) || country_index >= Country::size)
+            return false;
+        type = type_byte;
+        sex = sex_byte;
+        country = (CountryEnum) country_index;
+        return true;
+    }
+
+    /// @brief Writes a client without its password
+    inline void writeClient(Writer &out, const Client &client) {
+        out.addString(client.getID());
+        out.addString(client.getName());
+        writePassport(out, client.getPassport());
+        out.addString(client.getEmail());
+        out.addLong(client.getPhone());
+        out.addString(client.getUsername());
+    }
+
+    /// @brief Reads a client written by writeClient
+    /// @param client Set to the client, whose password is left empty
+    inline bool readClient(Reader &in, unique_ptr<Client> &client) {
+        string ID, name, passport_ID, passport_name, email, username;
+        char type, sex;
+        CountryEnum country;
+        DateTime DoB, DoI, DoE;
+        int64_t phone;
+        if (!in.nextString(ID) || !in.nextString(name) || !readPassport(in, passport_ID, type, passport_name, country, DoB, DoI, DoE, sex)
+            || !in.nextString(email) || !in.nextLong(phone) || !in.nextString(username))
+            return false;
+        client = make_unique<Client>(ID, name, Passport(passport_ID, type, passport_name, country, DoB, DoI, DoE, sex), email, phone, username, "");
+        return true;
+    }
+}
+
+#endif
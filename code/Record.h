@@ -1,6 +1,10 @@
 #include <iostream>
 #include "Client.h"
 #include "Inventory.h"
+#include "IdRegistry.h"
+#include "RecordFile.h"
+#include <functional>
+#include <atomic>
 #ifndef RECORD_H
 #define RECORD_H
 
@@ -11,8 +15,8 @@ class Inventory;
 /// @brief Record class to create PNRs of transactions
 class Record : public SaveItem {
     private:
-    /// @brief Number of created records
-    static int num_records;
+    /// @brief Number of created records, atomic so concurrent bookings never get the same ID
+    static atomic<int> num_records;
     /// @brief Path of storage file
     static const string save_path;
     /// @brief Unique string identifier
@@ -22,12 +26,12 @@ class Record : public SaveItem {
     /// @brief Pointer to the linked client
     Client* linked_client;
     /// @brief Date the reservation corresponds to
-    tm reservation_date;
+    DateTime reservation_date;
 
     /// @brief Creating a new ID from the number of created records
     /// @return Unique string identifier
     string generateID() {
-        return to_string(num_records++);
+        return allocateID();
     }
 
     public:
@@ -35,7 +39,7 @@ class Record : public SaveItem {
     Record() : ID(""){
         linked_client = nullptr;
         linked_inventory = nullptr;
-        reservation_date = tm();
+        reservation_date = DateTime();
     }
 
     /// @brief Non-default constructor for creating records from the storage file (ID is given)
@@ -43,7 +47,7 @@ class Record : public SaveItem {
     /// @param linked_inventory 
     /// @param linked_client 
     /// @param reservation_date 
-    Record(string ID, Inventory* linked_inventory, Client* linked_client, tm reservation_date) : ID(ID) {
+    Record(string ID, Inventory* linked_inventory, Client* linked_client, DateTime reservation_date) : ID(ID) {
         this->linked_inventory = linked_inventory;
         this->linked_client = linked_client;
         this->reservation_date = reservation_date;
@@ -53,7 +57,7 @@ class Record : public SaveItem {
     /// @param linked_inventory 
     /// @param linked_client 
     /// @param reservation_date 
-    Record(Inventory* linked_inventory, Client* linked_client, tm reservation_date) : ID(generateID()) {
+    Record(Inventory* linked_inventory, Client* linked_client, DateTime reservation_date) : ID(generateID()) {
         this->linked_inventory = linked_inventory;
         this->linked_client = linked_client;
         this->reservation_date = reservation_date;
@@ -64,55 +68,138 @@ class Record : public SaveItem {
     string getID() const { return ID; }
     Client* getClient() const { return linked_client; }
     Inventory* getInventory() const { return linked_inventory; }
-    tm getReserevationDate() const { return reservation_date; }
-
-    /// @brief Finds the client with the corresponding ID from given vector
-    /// @param ID ID to search for
-    /// @param clients Vector of clients to search through
-    /// @return Pointer to the corresponding client
-    static Client* findClientfromID(string ID, vector<Client> &clients) {
-        for (int i = 0; i < clients.size(); i++) {
-            if (clients[i].getID() == ID)
-                return &(clients[i]);
+    DateTime getReserevationDate() const { return reservation_date; }
+
+    // Setter functions
+    /// @brief Links the record to its client again after the client moved in memory
+    void setClient(Client* client) { linked_client = client; }
+
+    /// @brief Fills in the fixed-width snapshot entry of the record
+    /// @param entry Entry to fill
+    /// @return False if the record does not fit in a snapshot entry
+    bool toSnapshot(RecordEntry &entry) const {
+        entry = RecordEntry();
+        if (linked_client == nullptr || linked_inventory == nullptr || ID.empty() || ID.find_first_not_of("0123456789") != string::npos)
+            return false;
+        string clientID = linked_client->getID();
+        if (clientID.empty() || clientID.find_first_not_of("0123456789") != string::npos || !copyField(entry.inventory_ID, sizeof(entry.inventory_ID), linked_inventory->getID()))
+            return false;
+        entry.ID = stoul(ID);
+        entry.client_ID = stoul(clientID);
+        entry.reservation_date = reservation_date.getDate().getMinutes();
+        return true;
+    }
+
+    /// @brief Links a loaded record to its client and inventory item. Records with a reference that cannot be resolved are skipped and counted in LoadStats
+    /// @param records Vector the record is added to
+    /// @param recordID
+    /// @param inventoryID
+    /// @param clientID
+    /// @param reservation_date
+    /// @param clients Registry of all loaded clients
+    /// @param findInventory Resolves an inventory ID to the loaded inventory item
+    static void link(vector<Record> &records, const string &recordID, const string &inventoryID, const string &clientID, DateTime reservation_date, const IdRegistry<Client> &clients, const function<Inventory*(const string&)> &findInventory) {
+        Inventory* linked_inventory = findInventory(inventoryID);
+        Client* linked_client = clients.find(clientID);
+        if (linked_inventory == nullptr)
+            LoadStats::unresolved_inventory++;
+        if (linked_client == nullptr)
+            LoadStats::unresolved_clients++;
+        if (linked_inventory != nullptr && linked_client != nullptr)
+            records.push_back(Record(recordID, linked_inventory, linked_client, reservation_date));
+    }
+
+    /// @brief Loads the records stored in the snapshot
+    /// @param records Vector to add the records to
+    /// @param client_registry Registry of the loaded clients
+    /// @param findInventory Resolves an inventory ID to the loaded inventory item in constant time
+    /// @param count Set to the number of records in the snapshot, including unresolved ones
+    /// @return Byte offset of the first line of the storage file that is not in the snapshot
+    static uint64_t loadSnapshot(vector<Record> &records, const IdRegistry<Client> &client_registry, const function<Inventory*(const string&)> &findInventory, int &count) {
+        TRACE_SPAN("Record::loadSnapshot");
+        // Records already in the snapshot are built straight from its fixed-width entries
+        uint64_t resume_offset, entry_count = 0;
+        Snapshot &snapshot = Snapshot::get();
+        if (snapshot.covers(RECORDS_CSV, save_path, resume_offset)) {
+            const RecordEntry* entries = snapshot.entries<RecordEntry>(RECORDS, entry_count);
+            records.reserve(records.size() + entry_count);
+            for (uint64_t i = 0; i < entry_count; i++) {
+                link(records, to_string(entries[i].ID), readField(entries[i].inventory_ID, sizeof(entries[i].inventory_ID)), to_string(entries[i].client_ID), DateTime(entries[i].reservation_date), client_registry, findInventory);
+            }
+        }
+        count = entry_count;
+        return resume_offset;
+    }
+
+    /// @brief Builds records from the plain text of the storage file and links them to their clients and inventory items
+    /// @param plain Records as read by RecordFile::readPlain
+    /// @param records Vector to add the records to
+    /// @param client_registry Registry of the loaded clients
+    /// @param findInventory Resolves an inventory ID to the loaded inventory item in constant time
+    /// @return Number of records read, including skipped ones
+    static int parseRecords(string_view plain, vector<Record> &records, const IdRegistry<Client> &client_registry, const function<Inventory*(const string&)> &findInventory) {
+        TRACE_SPAN("Record::parseRecords");
+        int count = 0;
+        Tokenizer lines(plain, RecordFile::record_separator);
+        string_view line, reservation_date;
+        string recordID, inventoryID, clientID;
+        while (lines.next(line)) {
+            if (line.empty())
+                continue;
+            count++;
+            Tokenizer fields(line, RecordFile::field_separator);
+            if (!fields.nextString(recordID) || !fields.nextString(inventoryID) || !fields.nextString(clientID) || !fields.next(reservation_date)) {
+                cerr << "Skipping incomplete record..." << endl;
+                continue;
+            }
+            DateTime reserved;
+            if (!date_to_DateTime(reservation_date, reserved)) {
+                cerr << "Invalid reservation date in record " << recordID << ", skipping it..." << endl;
+                continue;
+            }
+            link(records, recordID, inventoryID, clientID, reserved, client_registry, findInventory);
         }
-        return nullptr;
+        return count;
     }
 
     /// @brief Loads all the records from storage file given all loaded clients and inventory items
     /// @param clients Vector of all loaded clients
-    /// @param inventoryItems Vector of all loaded inventory items
+    /// @param findInventory Resolves an inventory ID to the loaded inventory item in constant time
     /// @return Vector of all records from the storage file
-    vector<Record> loadAll(vector<Client> &clients, vector<Inventory> &inventoryItems) {
+    static vector<Record> loadAll(vector<Client> &clients, const function<Inventory*(const string&)> &findInventory) {
+        STATS_TIMER(LOAD_RECORDS);
+        TRACE_SPAN("Record::loadAll", save_path.c_str());
         vector<Record> records;
-        ifstream reader;
-        reader.open(save_path);
-        if (reader.fail()) {
-            cerr << "Error loading planes..." << endl;
-            reader.close();
+        LoadStats::unresolved_clients = 0;
+        LoadStats::unresolved_inventory = 0;
+        IdRegistry<Client> client_registry(clients);
+        int count;
+        uint64_t resume_offset = loadSnapshot(records, client_registry, findInventory, count);
+        num_records = count;
+        string plain;
+        if (!RecordFile::readPlain(save_path, resume_offset, plain)) {
+            cerr << "Error loading records..." << endl;
+            num_records = 0;
             return vector<Record>();
         }
-        string temp;
-        num_records = 0;
-        while (getline(reader, temp)) {
-            num_records++;
-            string recordID, inventoryID, clientID, reservation_date;
-            stringstream s_stream(temp);
-            getline(s_stream, temp, ',');
-            recordID = decrypt(temp);
-            getline(s_stream, temp, ',');
-            inventoryID = decrypt(temp);
-            Inventory* linked_inventory = findInventoryfromID(inventoryID, inventoryItems);
-            getline(s_stream, temp, ',');
-            clientID = decrypt(temp);
-            Client* linked_client = findClientfromID(clientID, clients);
-            getline(s_stream, temp, ',');
-            reservation_date = decrypt(temp);
-            records.push_back(Record(recordID, linked_inventory, linked_client, date_to_tm(reservation_date)));
-        }
-        reader.close();
+        num_records += parseRecords(plain, records, client_registry, findInventory);
+        if (LoadStats::unresolved_clients + LoadStats::unresolved_inventory > 0)
+            LoadStats::print(cerr);
         return records;
     }
 
+    /// @brief Takes the next free record ID. Safe to call from several threads
+    /// @return Unique string identifier
+    static string allocateID() {
+        return to_string(num_records.fetch_add(1, memory_order_relaxed));
+    }
+
+    /// @brief Sets the number of records after they were loaded without loadAll
+    static void setCount(int count) { num_records = count; }
+
+    /// @brief Gives the path of the storage file
+    static string getSavePath() { return save_path; }
+
     /// @brief Prints details of a record
     void print_details() {
             cout << "Record " << ID << endl;
@@ -123,37 +210,30 @@ class Record : public SaveItem {
     /// @brief Saves the record into the storage file
     /// @return True if writing was a success, false otherwise
     bool save() {
-        ofstream writer;
-        writer.open(save_path, std::ios_base::app);
-        if (writer.fail()) {
-            cerr << "Error saving plane..." << endl;
-            writer.close();
+        if (!RecordFile::append(save_path, {ID, linked_inventory->getID(), linked_client->getID(), DateTime_to_date(reservation_date)})) {
+            cerr << "Error saving record..." << endl;
             return false;
         }
-        writer << encrypt(ID) << ',';
-        writer << encrypt(linked_inventory->getID()) << ',';
-        writer << encrypt(linked_client->getID()) << ',';
-        writer << encrypt(tm_to_date(reservation_date)) << ',';
-        writer << endl;
-        writer.close();
         return true;
     }
 
-    /// @brief Searches for the inventory item with the corresponding ID from the given inventory vector
-    /// @param ID ID to search for
-    /// @param inventoryItems Vector of inventory items to search through
-    /// @return Pointer to inventory items with given ID
-    Inventory* findInventoryfromID(string ID, vector<Inventory> &inventoryItems) {
-        for (int i = 0; i < inventoryItems.size(); i++) {
-            if (inventoryItems[i].getID() == ID)
-                return &(inventoryItems[i]);
+    /// @brief Saves records made with a given ID, e.g. the records of a group booking, with a single write
+    /// @param group Records to save
+    /// @return True if the writing process was a success, false otherwise
+    static bool saveAll(const vector<Record> &group) {
+        vector<vector<string>> lines;
+        for (int i = 0; i < group.size(); i++)
+            lines.push_back({group[i].ID, group[i].linked_inventory->getID(), group[i].linked_client->getID(), DateTime_to_date(group[i].reservation_date)});
+        if (!RecordFile::append(save_path, lines)) {
+            cerr << "Error saving records..." << endl;
+            return false;
         }
-        return nullptr;
+        return true;
     }
 };
 
 // Static variables
 const string Record::save_path = "SaveData/Records.csv";
-int Record::num_records = 0;
+atomic<int> Record::num_records{0};
 
 #endif
\ No newline at end of file
@@ -0,0 +1,732 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <ctime>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <sys/random.h>
+#include "SaveItem.h"
+#include "Trace.h"
+#include "Tokenizer.h"
+#include "Stats.h"
+#ifndef RECORDFILE_H
+#define RECORDFILE_H
+
+using namespace std;
+
+/// @brief ChaCha20 stream cipher (RFC 8439) used by the block storage format
+namespace ChaCha20 {
+
+    inline uint32_t rotate(uint32_t x, int n) {
+        return (x << n) | (x >> (32 - n));
+    }
+
+    inline void quarterRound(uint32_t &a, uint32_t &b, uint32_t &c, uint32_t &d) {
+        a += b; d ^= a; d = rotate(d, 16);
+        c += d; b ^= c; b = rotate(b, 12);
+        a += b; d ^= a; d = rotate(d, 8);
+        c += d; b ^= c; b = rotate(b, 7);
+    }
+
+    inline uint32_t load32(const uint8_t* bytes) {
+        return (uint32_t) bytes[0] | ((uint32_t) bytes[1] << 8) | ((uint32_t) bytes[2] << 16) | ((uint32_t) bytes[3] << 24);
+    }
+
+    /// @brief Generates one 64 byte block of key stream
+    /// @param key 32 byte key
+    /// @param counter Block counter
+    /// @param nonce 12 byte nonce
+    /// @param out 64 bytes of key stream
+    void block(const uint8_t key[32], uint32_t counter, const uint8_t nonce[12], uint8_t out[64]) {
+        uint32_t state[16] = { 0x61707865, 0x3320646e, 0x79622d32, 0x6b206574 };
+        for (int i = 0; i < 8; i++)
+            state[4 + i] = load32(key + 4 * i);
+        state[12] = counter;
+        for (int i = 0; i < 3; i++)
+            state[13 + i] = load32(nonce + 4 * i);
+        uint32_t working[16];
+        memcpy(working, state, sizeof(state));
+        for (int i = 0; i < 10; i++) {
+            quarterRound(working[0], working[4], working[8], working[12]);
+            quarterRound(working[1], working[5], working[9], working[13]);
+            quarterRound(working[2], working[6], working[10], working[14]);
+            quarterRound(working[3], working[7], working[11], working[15]);
+            quarterRound(working[0], working[5], working[10], working[15]);
+            quarterRound(working[1], working[6], working[11], working[12]);
+            quarterRound(working[2], working[7], working[8], working[13]);
+            quarterRound(working[3], working[4], working[9], working[14]);
+        }
+        for (int i = 0; i < 16; i++) {
+            uint32_t word = working[i] + state[i];
+            out[4 * i] = word;
+            out[4 * i + 1] = word >> 8;
+            out[4 * i + 2] = word >> 16;
+            out[4 * i + 3] = word >> 24;
+        }
+    }
+
+    /// @brief Encrypts or decrypts data in place
+    /// @param key 32 byte key
+    /// @param nonce 12 byte nonce
+    /// @param data Data to transform
+    /// @param length Length of the data
+    void apply(const uint8_t key[32], const uint8_t nonce[12], uint8_t* data, size_t length) {
+        uint8_t stream[64];
+        for (size_t offset = 0, counter = 1; offset < length; offset += 64, counter++) {
+            block(key, counter, nonce, stream);
+            size_t count = min((size_t) 64, length - offset);
+            for (size_t i = 0; i < count; i++)
+                data[offset + i] ^= stream[i];
+        }
+    }
+}
+
+/// @brief Reads and writes the storage files, one record (line) of fields at a time.
+/// A file is either in the original CSV format (every character RSA encrypted on its own) or in the block format,
+/// where each record is encrypted as a single binary block. The format is detected from the start of the file.
+class RecordFile {
+    public:
+    /// @brief Storage formats
+    enum Format { CSV, BLOCK };
+
+    private:
+    /// @brief Header at the start of a block format file
+    struct FileHeader {
+        char magic[5];
+        uint8_t version;
+        /// @brief Which compiled in key the records are encrypted with
+        uint8_t key_id;
+        uint8_t reserved;
+    };
+
+    /// @brief Header in front of every record of a block format file
+    struct BlockHeader {
+        uint32_t length;
+        /// @brief FNV-1a hash of the plain record, detects corrupted and torn records
+        uint32_t checksum;
+        uint8_t nonce[8];
+    };
+
+    static const char magic[5];
+    static const uint8_t key_id;
+    /// @brief Key of the block format, compiled in like the RSA parameters of the CSV format
+    static const uint8_t key[32];
+
+    static uint32_t checksum(string_view plain) {
+        uint32_t hash = 2166136261u;
+        for (int i = 0; i < plain.length(); i++) {
+            hash ^= (unsigned char) plain[i];
+            hash *= 16777619u;
+        }
+        return hash;
+    }
+
+    /// @brief Builds the 12 byte nonce from the 8 random bytes stored with a record
+    static void expandNonce(const uint8_t stored[8], uint8_t nonce[12]) {
+        memset(nonce, 0, 12);
+        memcpy(nonce + 4, stored, 8);
+    }
+
+    /// @brief Random nonce bytes, unique per record.
+    /// Taken from the kernel rather than <random>, whose <cmath> defines a NAN macro that clashes with the airport codes
+    static void randomNonce(uint8_t nonce[8]) {
+        static uint64_t fallback = (uint64_t) time(nullptr) << 20 ^ (uint64_t) getpid();
+        if (getrandom(nonce, 8, 0) != 8) {
+            fallback = fallback * 6364136223846793005ULL + 1442695040888963407ULL;
+            memcpy(nonce, &fallback, 8);
+        }
+    }
+
+    /// @brief Encodes a record in the CSV format
+    static string encodeCSV(const vector<string> &fields) {
+        string line;
+        for (int i = 0; i < fields.size(); i++) {
+            size_t start = line.length();
+            line.resize(start + SaveItem::maxEncryptedLength(fields[i].length()));
+            line.resize(start + SaveItem::encryptInto(fields[i].data(), fields[i].length(), &line[start]));
+            line += ',';
+        }
+        line += '\n';
+        return line;
+    }
+
+    /// @brief Encodes a record in the block format
+    static string encodeBlock(const vector<string> &fields) {
+        string plain;
+        for (int i = 0; i < fields.size(); i++) {
+            if (i > 0)
+                plain += field_separator;
+            plain += fields[i];
+        }
+        BlockHeader header;
+        header.length = plain.length();
+        header.checksum = checksum(plain);
+        randomNonce(header.nonce);
+        uint8_t nonce[12];
+        expandNonce(header.nonce, nonce);
+        ChaCha20::apply(key, nonce, (uint8_t*) &plain[0], plain.length());
+        return string((const char*) &header, sizeof(header)) + plain;
+    }
+
+    /// @brief Encodes a record in the given format
+    static string encode(const vector<string> &fields, Format format) {
+        return format == BLOCK ? encodeBlock(fields) : encodeCSV(fields);
+    }
+
+    /// @brief Header written at the start of a new block format file
+    static string fileHeader() {
+        FileHeader header;
+        memcpy(header.magic, magic, sizeof(magic));
+        header.version = 1;
+        header.key_id = key_id;
+        header.reserved = 0;
+        return string((const char*) &header, sizeof(header));
+    }
+
+    /// @brief Reads a whole file
+    static bool readFile(const string &path, string &contents) {
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            return false;
+        struct stat info;
+        contents.clear();
+        if (fstat(fd, &info) == 0)
+            contents.resize(info.st_size);
+        size_t length = 0;
+        ssize_t count;
+        // The file may still grow while being read, so read until the end rather than trusting the size
+        while (true) {
+            if (length == contents.length())
+                contents.resize(max((size_t) 4096, 2 * contents.length()));
+            count = read(fd, &contents[length], contents.length() - length);
+            if (count <= 0)
+                break;
+            length += count;
+        }
+        close(fd);
+        contents.resize(length);
+        return count == 0;
+    }
+
+    /// @brief Checks the header of a block format file read into memory
+    static bool validHeader(const string &contents, const string &path) {
+        const FileHeader* file_header = (const FileHeader*) contents.data();
+        if (contents.length() < sizeof(FileHeader) || file_header->version != 1 || file_header->key_id != key_id) {
+            cerr << "Unsupported storage format in " << path << "..." << endl;
+            return false;
+        }
+        return true;
+    }
+
+    /// @brief Decrypts the records of a block format file in a byte range and appends them to plain text
+    /// @param contents Whole file
+    /// @param begin Start of the first record
+    /// @param end End of the range
+    /// @param plain Plain text to append to
+    /// @param path Storage file, for messages
+    static void decodeBlocks(const string &contents, size_t begin, size_t end, string &plain, const string &path) {
+        STATS_TIMER(DECRYPT);
+        STATS_ADD(BYTES_DECRYPTED, end - begin);
+        plain.reserve(plain.length() + end - begin);
+        size_t position = begin;
+        while (position + sizeof(BlockHeader) <= end) {
+            BlockHeader header;
+            memcpy(&header, contents.data() + position, sizeof(header));
+            position += sizeof(header);
+            if (header.length > end - position) {
+                cerr << "Ignoring incomplete record at the end of " << path << "..." << endl;
+                break;
+            }
+            // Decrypt in place at the end of the buffer, dropping the record again if it is corrupted
+            size_t start = plain.length();
+            plain.append(contents, position, header.length);
+            position += header.length;
+            uint8_t nonce[12];
+            expandNonce(header.nonce, nonce);
+            ChaCha20::apply(key, nonce, (uint8_t*) &plain[start], header.length);
+            if (checksum(string_view(plain).substr(start)) != header.checksum) {
+                cerr << "Ignoring corrupted record in " << path << "..." << endl;
+                plain.resize(start);
+                continue;
+            }
+            plain += record_separator;
+        }
+    }
+
+    /// @brief Decrypts the records of a block format file into plain text
+    static bool readBlocks(const string &path, uint64_t offset, string &plain) {
+        string contents;
+        if (!readFile(path, contents) || !validHeader(contents, path))
+            return false;
+        decodeBlocks(contents, max((uint64_t) sizeof(FileHeader), offset), contents.length(), plain, path);
+        return true;
+    }
+
+    /// @brief Decrypts the complete lines of CSV text and appends them to plain text.
+    /// Every field is encrypted on its own and followed by a comma
+    /// @param data CSV text
+    /// @param length Length of the text
+    /// @param final True if the text ends at the end of the file, so a last line without a line break is complete
+    /// @param plain Plain text to append to
+    /// @return Number of bytes decoded
+    static size_t decodeLines(const char* data, size_t length, bool final, string &plain) {
+        STATS_TIMER(DECRYPT);
+        STATS_ADD(BYTES_DECRYPTED, length);
+        // A decrypted field is never longer than its encrypted text and each separator replaces a comma or line break
+        size_t written = plain.length();
+        plain.resize(written + length + 1);
+        char* out = &plain[written];
+        size_t position = 0;
+        while (position < length) {
+            const char* found = (const char*) memchr(data + position, '\n', length - position);
+            if (found == nullptr && !final)
+                break;
+            size_t line_end = found == nullptr ? length : found - data;
+            size_t start = position;
+            while (start < line_end) {
+                const char* comma = (const char*) memchr(data + start, ',', line_end - start);
+                size_t end = comma == nullptr ? line_end : comma - data;
+                if (start != position)
+                    *out++ = field_separator;
+                out += SaveItem::decryptInto(data + start, end - start, out);
+                start = end + 1;
+            }
+            if (line_end > position)
+                *out++ = record_separator;
+            position = min(length, line_end + 1);
+        }
+        plain.resize(out - plain.data());
+        return position;
+    }
+
+    public:
+    /// @brief Separates the fields of a record, inside an encrypted block and in the plain text returned by readPlain
+    static const char field_separator = '\x1F';
+    /// @brief Separates the records in the plain text returned by readPlain
+    static const char record_separator = '\x1E';
+
+    /// @brief Format given to storage files that are created empty
+    static Format default_format;
+
+    /// @brief Detects the format of an open storage file from its first bytes
+    /// @param fd Descriptor opened for reading
+    /// @return BLOCK if the file starts with the block header, CSV otherwise. Empty files get default_format
+    static Format detect(int fd) {
+        FileHeader header;
+        ssize_t count = pread(fd, &header, sizeof(header), 0);
+        if (count == 0)
+            return default_format;
+        if (count == sizeof(header) && memcmp(header.magic, magic, sizeof(magic)) == 0)
+            return BLOCK;
+        return CSV;
+    }
+
+    /// @brief Detects the format of a storage file
+    /// @param path Storage file
+    /// @return BLOCK if the file starts with the block header, CSV otherwise. Empty or missing files get default_format
+    static Format detect(const string &path) {
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            return default_format;
+        Format format = detect(fd);
+        close(fd);
+        return format;
+    }
+
+    /// @brief Name of a format for printing
+    static string formatName(Format format) {
+        return format == BLOCK ? "Block" : "CSV";
+    }
+
+    /// @brief Opens a storage file and locks it against appends and rewrites of other processes.
+    /// A rewrite replaces the file with a rename, so if that happened while waiting for the lock the new file is opened and locked instead
+    /// @param path Storage file, created if missing
+    /// @param flags Open flags
+    /// @return File descriptor holding the lock, -1 if the file cannot be opened
+    static int openLocked(const string &path, int flags) {
+        while (true) {
+            int fd = open(path.c_str(), flags | O_CREAT | O_CLOEXEC, 0644);
+            if (fd < 0)
+                return -1;
+            flock(fd, LOCK_EX);
+            struct stat opened, current;
+            if (fstat(fd, &opened) != 0) {
+                close(fd);
+                return -1;
+            }
+            if (stat(path.c_str(), &current) == 0 && current.st_dev == opened.st_dev && current.st_ino == opened.st_ino)
+                return fd;
+            close(fd);
+        }
+    }
+
+    /// @brief Locks a storage file, so it can be read and rewritten without losing records appended meanwhile
+    /// @param path Storage file
+    /// @return Lock to pass to unlock(), -1 if the file cannot be opened
+    static int lock(const string &path) {
+        return openLocked(path, O_RDONLY);
+    }
+
+    /// @brief Releases a lock taken with lock()
+    static void unlock(int lock) {
+        close(lock);
+    }
+
+    /// @brief Appends a record to a storage file in the file's format
+    /// @param path Storage file
+    /// @param fields Plain fields of the record
+    /// @return True if the record was written, false otherwise
+    static bool append(const string &path, const vector<string> &fields) {
+        return append(path, vector<vector<string>>(1, fields));
+    }
+
+    /// @brief Appends several records to a storage file in the file's format with a single write
+    /// @param path Storage file
+    /// @param records Plain fields of each record
+    /// @return True if the records were written, false otherwise
+    static bool append(const string &path, const vector<vector<string>> &records) {
+        TRACE_SPAN("RecordFile::append", path.c_str());
+        // The format check and the header of a new file are done under the same lock as the write,
+        // so two processes appending to an empty file cannot both write a header
+        int fd = openLocked(path, O_RDWR | O_APPEND);
+        if (fd < 0)
+            return false;
+        Format format = detect(fd);
+        string data;
+        struct stat info;
+        if (format == BLOCK && fstat(fd, &info) == 0 && info.st_size == 0)
+            data = fileHeader();
+        {
+            STATS_TIMER(ENCRYPT);
+            for (int i = 0; i < records.size(); i++)
+                data += encode(records[i], format);
+            STATS_ADD(BYTES_ENCRYPTED, data.length());
+        }
+        bool written = write(fd, data.data(), data.length()) == (ssize_t) data.length();
+        close(fd);
+        return written;
+    }
+
+    /// @brief Reads and decrypts the records of a storage file into one plain text buffer.
+    /// Records are separated by record_separator and their fields by field_separator, whatever the format of the file,
+    /// so the buffer can be split with a Tokenizer without copying.
+    /// @param path Storage file
+    /// @param offset Byte offset of the first record to read (0 for the whole file)
+    /// @param plain Filled with the plain text of the records
+    /// @return False if the file cannot be opened
+    static bool readPlain(const string &path, uint64_t offset, string &plain) {
+        TRACE_SPAN("RecordFile::readPlain", path.c_str());
+        plain.clear();
+        if (detect(path) == BLOCK)
+            return readBlocks(path, offset, plain);
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            return false;
+        struct stat info;
+        size_t remaining = fstat(fd, &info) == 0 && (uint64_t) info.st_size > offset ? info.st_size - offset : 0;
+        plain.reserve(remaining / 3);
+        // The file is decoded in chunks of whole lines, so only a small part of the encrypted text is in memory at a time
+        string chunk(min((size_t) 1 << 20, max((size_t) 4096, remaining + 1)), '\0');
+        size_t filled = 0;
+        ssize_t count = lseek(fd, offset, SEEK_SET) < 0 ? -1 : 0;
+        while (count >= 0) {
+            count = read(fd, &chunk[filled], chunk.length() - filled);
+            if (count < 0)
+                break;
+            filled += count;
+            size_t consumed = decodeLines(chunk.data(), filled, count == 0, plain);
+            memmove(&chunk[0], chunk.data() + consumed, filled - consumed);
+            filled -= consumed;
+            if (count == 0)
+                break;
+            // A line longer than the chunk needs a bigger chunk
+            if (filled == chunk.length())
+                chunk.resize(2 * chunk.length());
+        }
+        close(fd);
+        return count == 0;
+    }
+
+    /// @brief A storage file read into memory and split into parts of whole records, so the parts can be decoded on separate threads
+    struct Chunks {
+        string path;
+        string contents;
+        Format format;
+        /// @brief Part i is the byte range from bounds[i] to bounds[i + 1]
+        vector<size_t> bounds;
+
+        /// @brief Number of parts
+        size_t size() const { return bounds.empty() ? 0 : bounds.size() - 1; }
+    };
+
+    /// @brief Reads a storage file and splits its records into parts of about the same size
+    /// @param path Storage file
+    /// @param offset Byte offset of the first record to read (0 for the whole file)
+    /// @param parts Wanted number of parts
+    /// @param chunks Filled with the file and the part boundaries
+    /// @return False if the file cannot be opened
+    static bool split(const string &path, uint64_t offset, size_t parts, Chunks &chunks) {
+        TRACE_SPAN("RecordFile::split", path.c_str());
+        chunks.path = path;
+        chunks.bounds.clear();
+        if (!readFile(path, chunks.contents))
+            return false;
+        const string &contents = chunks.contents;
+        chunks.format = contents.length() >= sizeof(FileHeader) && memcmp(contents.data(), magic, sizeof(magic)) == 0 ? BLOCK : CSV;
+        if (chunks.format == BLOCK && !validHeader(contents, path))
+            return false;
+        size_t begin = chunks.format == BLOCK ? max((uint64_t) sizeof(FileHeader), offset) : offset;
+        begin = min(begin, contents.length());
+        size_t target = max((size_t) 1, (contents.length() - begin) / max((size_t) 1, parts));
+        chunks.bounds.push_back(begin);
+        if (chunks.format == CSV) {
+            // Each part ends after the first line break past its target size
+            for (size_t position = begin + target; position < contents.length(); position += target) {
+                const char* found = (const char*) memchr(contents.data() + position, '\n', contents.length() - position);
+                if (found == nullptr)
+                    break;
+                position = found - contents.data() + 1;
+                chunks.bounds.push_back(position);
+            }
+        }
+        else {
+            // Block records can only be found from the start, by jumping over each record's length
+            size_t position = begin, next_bound = begin + target;
+            BlockHeader header;
+            while (position + sizeof(BlockHeader) <= contents.length()) {
+                memcpy(&header, contents.data() + position, sizeof(header));
+                if (header.length > contents.length() - position - sizeof(header))
+                    break;
+                position += sizeof(header) + header.length;
+                if (position >= next_bound && position < contents.length()) {
+                    chunks.bounds.push_back(position);
+                    next_bound = position + target;
+                }
+            }
+        }
+        if (chunks.bounds.back() != contents.length())
+            chunks.bounds.push_back(contents.length());
+        else if (chunks.bounds.size() == 1)
+            chunks.bounds.push_back(contents.length());
+        return true;
+    }
+
+    /// @brief Decodes one part of a split storage file into plain text in the same layout as readPlain
+    /// @param chunks Split storage file
+    /// @param part Part to decode
+    /// @param plain Filled with the plain text of the records in the part
+    static void decodeChunk(const Chunks &chunks, size_t part, string &plain) {
+        TRACE_SPAN("RecordFile::decodeChunk", chunks.path.c_str());
+        plain.clear();
+        size_t begin = chunks.bounds[part], end = chunks.bounds[part + 1];
+        if (chunks.format == BLOCK)
+            decodeBlocks(chunks.contents, begin, end, plain, chunks.path);
+        else
+            decodeLines(chunks.contents.data() + begin, end - begin, true, plain);
+    }
+
+    /// @brief Reads the records of a storage file as separate fields
+    /// @param path Storage file
+    /// @param offset Byte offset of the first record to read (0 for the whole file)
+    /// @param records Filled with the plain fields of every record
+    /// @return False if the file cannot be opened
+    static bool readAll(const string &path, uint64_t offset, vector<vector<string>> &records) {
+        string plain;
+        if (!readPlain(path, offset, plain))
+            return false;
+        Tokenizer lines(plain, record_separator);
+        string_view line, field;
+        while (lines.next(line)) {
+            if (line.empty())
+                continue;
+            vector<string> fields;
+            Tokenizer tokens(line, field_separator);
+            while (tokens.next(field))
+                fields.push_back(string(field));
+            records.push_back(fields);
+        }
+        return true;
+    }
+
+    /// @brief Writes a whole storage file one record at a time, so files larger than memory can be written.
+    /// Records go to a temporary file next to the storage file, which replaces it only once finish() succeeds
+    class Writer {
+        private:
+        string path;
+        string temp_path;
+        Format format;
+        int fd;
+        /// @brief Encoded records not written yet
+        string buffer;
+        /// @brief False once a write failed
+        bool good;
+
+        /// @brief Size the buffer is written out at
+        static const size_t flush_size = 1 << 20;
+
+        /// @brief Writes out the buffered records
+        void flush() {
+            size_t done = 0;
+            while (good && done < buffer.length()) {
+                ssize_t count = write(fd, buffer.data() + done, buffer.length() - done);
+                if (count <= 0)
+                    good = false;
+                else
+                    done += count;
+            }
+            buffer.clear();
+        }
+
+        public:
+        /// @brief Starts writing a storage file
+        /// @param path Storage file to replace
+        /// @param format Format to write
+        Writer(const string &path, Format format) : path(path), temp_path(path + ".tmp"), format(format) {
+            fd = open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            good = fd >= 0;
+            if (format == BLOCK)
+                buffer = fileHeader();
+        }
+
+        Writer(const Writer&) = delete;
+        Writer& operator=(const Writer&) = delete;
+
+        /// @brief Discards the temporary file if finish() was not called
+        ~Writer() {
+            if (fd >= 0) {
+                close(fd);
+                remove(temp_path.c_str());
+            }
+        }
+
+        /// @brief Adds a record at the end of the file
+        /// @param fields Plain fields of the record
+        /// @return False if writing failed
+        bool add(const vector<string> &fields) {
+            buffer += encode(fields, format);
+            if (buffer.length() >= flush_size)
+                flush();
+            return good;
+        }
+
+        /// @brief Writes the remaining records and moves the file into place
+        /// @return True if the storage file was replaced, false otherwise
+        bool finish() {
+            TRACE_SPAN("RecordFile::Writer::finish", path.c_str());
+            if (fd < 0)
+                return false;
+            flush();
+            bool written = good && fsync(fd) == 0;
+            close(fd);
+            fd = -1;
+            if (!written || rename(temp_path.c_str(), path.c_str()) != 0) {
+                remove(temp_path.c_str());
+                return false;
+            }
+            return true;
+        }
+    };
+
+    /// @brief Replaces all records of a storage file, keeping its format
+    /// @param path Storage file
+    /// @param records Plain fields of every record
+    /// @return True if the file was written, false otherwise
+    static bool rewrite(const string &path, const vector<vector<string>> &records) {
+        int fd = lock(path);
+        if (fd < 0)
+            return false;
+        bool written = rewriteLocked(path, records, detect(fd));
+        unlock(fd);
+        return written;
+    }
+
+    /// @brief Replaces all records of a storage file in the given format
+    /// @param path Storage file
+    /// @param records Plain fields of every record
+    /// @param format Format to write
+    /// @return True if the file was written, false otherwise
+    static bool rewrite(const string &path, const vector<vector<string>> &records, Format format) {
+        int fd = lock(path);
+        if (fd < 0)
+            return false;
+        bool written = rewriteLocked(path, records, format);
+        unlock(fd);
+        return written;
+    }
+
+    /// @brief Replaces all records of a storage file the caller has locked with lock(), so records read under the same lock
+    /// can be written back without losing an append that came in between
+    /// @param path Storage file
+    /// @param records Plain fields of every record
+    /// @param format Format to write
+    /// @return True if the file was written, false otherwise
+    static bool rewriteLocked(const string &path, const vector<vector<string>> &records, Format format) {
+        Writer writer(path, format);
+        {
+            // Timed as one batch, including the buffered writes of every megabyte
+            STATS_TIMER(ENCRYPT);
+            for (int i = 0; i < records.size(); i++)
+                writer.add(records[i]);
+        }
+        return writer.finish();
+    }
+
+    /// @brief Converts a storage file to another format. This is the migration path between the formats
+    /// @param path Storage file
+    /// @param format New format
+    /// @return True if the file is now in the new format, false otherwise
+    static bool migrate(const string &path, Format format) {
+        TRACE_SPAN("RecordFile::migrate", path.c_str());
+        int fd = lock(path);
+        vector<vector<string>> records;
+        if (fd < 0 || !readAll(path, 0, records)) {
+            cerr << "Error reading " << path << "..." << endl;
+            if (fd >= 0)
+                unlock(fd);
+            return false;
+        }
+        if (!rewriteLocked(path, records, format)) {
+            cerr << "Error migrating " << path << "..." << endl;
+            unlock(fd);
+            return false;
+        }
+        unlock(fd);
+        return true;
+    }
+
+    /// @brief Removes all records of a storage file, keeping its format
+    /// @param path Storage file
+    /// @return True if the file was cleared, false otherwise
+    static bool clear(const string &path) {
+        TRACE_SPAN("RecordFile::clear", path.c_str());
+        // Locked like append, so a record appended meanwhile cannot land before the header
+        int fd = openLocked(path, O_RDWR);
+        if (fd < 0)
+            return false;
+        Format format = detect(fd);
+        bool cleared = ftruncate(fd, 0) == 0;
+        if (cleared && format == BLOCK) {
+            string header = fileHeader();
+            cleared = pwrite(fd, header.data(), header.length(), 0) == (ssize_t) header.length();
+        }
+        close(fd);
+        return cleared;
+    }
+};
+
+// Static variables
+const char RecordFile::magic[5] = {'M', 'K', 'B', 'L', 'K'};
+const uint8_t RecordFile::key_id = 1;
+const uint8_t RecordFile::key[32] = {
+    0x4d, 0x69, 0x73, 0x74, 0x69, 0x6b, 0x61, 0x20, 0x41, 0x69, 0x72, 0x77, 0x61, 0x79, 0x73, 0x20,
+    0x9b, 0x2e, 0x61, 0xf0, 0x3c, 0xd7, 0x48, 0x15, 0xa6, 0x0f, 0x72, 0xe9, 0x5b, 0xc4, 0x1d, 0x83
+};
+RecordFile::Format RecordFile::default_format = RecordFile::CSV;
+
+#endif
@@ -0,0 +1,377 @@
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#ifndef ROARINGBITMAP_H
+#define ROARINGBITMAP_H
+
+using namespace std;
+
+/// @brief Compressed set of 32 bit values, laid out like a Roaring bitmap.
+/// Values are grouped by their high 16 bits into containers. A container holding few values is a sorted array of their low 16 bits,
+/// one holding more than array_limit values is a plain 65536 bit bitmap. Intersections and unions of two bitmap containers work on
+/// whole vectors of words, which GCC turns into SIMD instructions.
+class RoaringBitmap {
+    private:
+    /// @brief Containers with more values than this are stored as bitmaps, which are then the smaller of the two
+    static const int array_limit = 4096;
+    /// @brief Words of a bitmap container
+    static const int bitmap_words = 1024;
+
+    /// @brief Four words processed as one vector. Only 8 byte alignment is assumed since the words live in a vector
+    typedef uint64_t Block __attribute__((vector_size(32), aligned(8), __may_alias__));
+
+    /// @brief Values sharing the same high 16 bits
+    struct Container {
+        uint16_t key;
+        int cardinality = 0;
+        /// @brief Sorted low 16 bits while the container is an array
+        vector<uint16_t> array;
+        /// @brief Bitmap of the low 16 bits once the container has too many values for an array
+        vector<uint64_t> bits;
+
+        bool isBitmap() const { return !bits.empty(); }
+
+        bool contains(uint16_t low) const {
+            if (isBitmap())
+                return (bits[low / 64] >> (low % 64)) & 1;
+            return binary_search(array.begin(), array.end(), low);
+        }
+
+        void toBitmap() {
+            bits.assign(bitmap_words, 0);
+            for (uint16_t low : array)
+                bits[low / 64] |= 1ULL << (low % 64);
+            array.clear();
+            array.shrink_to_fit();
+        }
+
+        void toArray() {
+            array.clear();
+            array.reserve(cardinality);
+            forEach([&](uint16_t low) { array.push_back(low); });
+            bits.clear();
+            bits.shrink_to_fit();
+        }
+
+        /// @return False if the value was already there
+        bool add(uint16_t low) {
+            if (isBitmap()) {
+                uint64_t mask = 1ULL << (low % 64);
+                if (bits[low / 64] & mask)
+                    return false;
+                bits[low / 64] |= mask;
+            }
+            else {
+                auto it = lower_bound(array.begin(), array.end(), low);
+                if (it != array.end() && *it == low)
+                    return false;
+                array.insert(it, low);
+                if (array.size() > array_limit)
+                    toBitmap();
+            }
+            cardinality++;
+            return true;
+        }
+
+        /// @return False if the value was not there
+        bool remove(uint16_t low) {
+            if (isBitmap()) {
+                uint64_t mask = 1ULL << (low % 64);
+                if (!(bits[low / 64] & mask))
+                    return false;
+                bits[low / 64] &= ~mask;
+                if (cardinality - 1 <= array_limit) {
+                    cardinality--;
+                    toArray();
+                    return true;
+                }
+            }
+            else {
+                auto it = lower_bound(array.begin(), array.end(), low);
+                if (it == array.end() || *it != low)
+                    return false;
+                array.erase(it);
+            }
+            cardinality--;
+            return true;
+        }
+
+        /// @brief Calls a function with every low 16 bits in increasing order
+        template <typename F>
+        void forEach(F visit) const {
+            if (!isBitmap()) {
+                for (uint16_t low : array)
+                    visit(low);
+                return;
+            }
+            for (int w = 0; w < bitmap_words; w++) {
+                for (uint64_t word = bits[w]; word != 0; word &= word - 1)
+                    visit((uint16_t) (w * 64 + __builtin_ctzll(word)));
+            }
+        }
+
+        /// @brief Recounts the values of a bitmap container and turns it into an array if it got small
+        void settle() {
+            if (!isBitmap())
+                return;
+            cardinality = 0;
+            for (int w = 0; w < bitmap_words; w++)
+                cardinality += __builtin_popcountll(bits[w]);
+            if (cardinality <= array_limit)
+                toArray();
+        }
+    };
+
+    /// @brief Containers sorted by key
+    vector<Container> containers;
+
+    /// @brief Position of the container of a key, or where it would go
+    size_t findContainer(uint16_t key) const {
+        return lower_bound(containers.begin(), containers.end(), key, [](const Container &c, uint16_t k) { return c.key < k; }) - containers.begin();
+    }
+
+    /// @brief Intersection of two containers with the same key
+    static Container intersect(const Container &a, const Container &b) {
+        Container result;
+        result.key = a.key;
+        if (a.isBitmap() && b.isBitmap()) {
+            result.bits.resize(bitmap_words);
+            const Block* x = (const Block*) a.bits.data();
+            const Block* y = (const Block*) b.bits.data();
+            Block* out = (Block*) result.bits.data();
+            for (int i = 0; i < bitmap_words / 4; i++)
+                out[i] = x[i] & y[i];
+            result.settle();
+        }
+        else if (a.isBitmap() || b.isBitmap()) {
+            const Container &bitmap = a.isBitmap() ? a : b;
+            const Container &array = a.isBitmap() ? b : a;
+            for (uint16_t low : array.array) {
+                if (bitmap.contains(low))
+                    result.array.push_back(low);
+            }
+            result.cardinality = result.array.size();
+        }
+        else {
+            set_intersection(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(), back_inserter(result.array));
+            result.cardinality = result.array.size();
+        }
+        return result;
+    }
+
+    /// @brief Union of two containers with the same key
+    static Container unite(const Container &a, const Container &b) {
+        Container result;
+        result.key = a.key;
+        if (!a.isBitmap() && !b.isBitmap() && a.cardinality + b.cardinality <= array_limit) {
+            set_union(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(), back_inserter(result.array));
+            result.cardinality = result.array.size();
+            return result;
+        }
+        result.bits.assign(bitmap_words, 0);
+        Block* out = (Block*) result.bits.data();
+        for (const Container* c : {&a, &b}) {
+            if (c->isBitmap()) {
+                const Block* x = (const Block*) c->bits.data();
+                for (int i = 0; i < bitmap_words / 4; i++)
+                    out[i] |= x[i];
+            }
+            else {
+                for (uint16_t low : c->array)
+                    result.bits[low / 64] |= 1ULL << (low % 64);
+            }
+        }
+        result.settle();
+        return result;
+    }
+
+    public:
+    /// @brief Adds a value
+    void add(uint32_t value) {
+        uint16_t key = value >> 16;
+        uint16_t low = value & 0xFFFF;
+        // Bulk builds add values in increasing order, which only ever touches the last container
+        if (!containers.empty() && containers.back().key == key) {
+            Container &last = containers.back();
+            if (!last.isBitmap() && last.array.back() < low && last.cardinality < array_limit) {
+                last.array.push_back(low);
+                last.cardinality++;
+            }
+            else
+                last.add(low);
+            return;
+        }
+        size_t i = findContainer(key);
+        if (i == containers.size() || containers[i].key != key) {
+            containers.insert(containers.begin() + i, Container());
+            containers[i].key = key;
+        }
+        containers[i].add(low);
+    }
+
+    /// @brief Removes a value
+    void remove(uint32_t value) {
+        uint16_t key = value >> 16;
+        size_t i = findContainer(key);
+        if (i == containers.size() || containers[i].key != key)
+            return;
+        containers[i].remove(value & 0xFFFF);
+        if (containers[i].cardinality == 0)
+            containers.erase(containers.begin() + i);
+    }
+
+    bool contains(uint32_t value) const {
+        uint16_t key = value >> 16;
+        size_t i = findContainer(key);
+        return i < containers.size() && containers[i].key == key && containers[i].contains(value & 0xFFFF);
+    }
+
+    /// @brief Number of values
+    uint64_t cardinality() const {
+        uint64_t count = 0;
+        for (const Container &c : containers)
+            count += c.cardinality;
+        return count;
+    }
+
+    bool empty() const { return containers.empty(); }
+
+    void clear() { containers.clear(); }
+
+    /// @brief Builds a bitmap from a plain bit vector, which is much faster than adding its values one by one
+    /// @param words Bit i of word i / 64 is set for every value i
+    static RoaringBitmap fromWords(const vector<uint64_t> &words) {
+        RoaringBitmap result;
+        for (size_t first = 0; first < words.size(); first += bitmap_words) {
+            size_t last = min(words.size(), first + bitmap_words);
+            Container c;
+            c.key = first / bitmap_words;
+            for (size_t w = first; w < last; w++)
+                c.cardinality += __builtin_popcountll(words[w]);
+            if (c.cardinality == 0)
+                continue;
+            if (c.cardinality > array_limit) {
+                c.bits.assign(bitmap_words, 0);
+                copy(words.begin() + first, words.begin() + last, c.bits.begin());
+            }
+            else {
+                c.array.reserve(c.cardinality);
+                for (size_t w = first; w < last; w++) {
+                    for (uint64_t word = words[w]; word != 0; word &= word - 1)
+                        c.array.push_back((w - first) * 64 + __builtin_ctzll(word));
+                }
+            }
+            result.containers.push_back(move(c));
+        }
+        return result;
+    }
+
+    /// @brief Values in both bitmaps
+    static RoaringBitmap intersect(const RoaringBitmap &a, const RoaringBitmap &b) {
+        RoaringBitmap result;
+        size_t i = 0, j = 0;
+        while (i < a.containers.size() && j < b.containers.size()) {
+            if (a.containers[i].key < b.containers[j].key)
+                i++;
+            else if (a.containers[i].key > b.containers[j].key)
+                j++;
+            else {
+                Container c = intersect(a.containers[i++], b.containers[j++]);
+                if (c.cardinality > 0)
+                    result.containers.push_back(move(c));
+            }
+        }
+        return result;
+    }
+
+    /// @brief Values in either bitmap
+    static RoaringBitmap unite(const RoaringBitmap &a, const RoaringBitmap &b) {
+        RoaringBitmap result;
+        size_t i = 0, j = 0;
+        while (i < a.containers.size() || j < b.containers.size()) {
+            if (j == b.containers.size() || (i < a.containers.size() && a.containers[i].key < b.containers[j].key))
+                result.containers.push_back(a.containers[i++]);
+            else if (i == a.containers.size() || a.containers[i].key > b.containers[j].key)
+                result.containers.push_back(b.containers[j++]);
+            else
+                result.containers.push_back(unite(a.containers[i++], b.containers[j++]));
+        }
+        return result;
+    }
+
+    /// @brief Values in any of several bitmaps. Each key is united in one go, so many bitmaps cost one pass instead of one per pair
+    static RoaringBitmap unite(const vector<const RoaringBitmap*> &bitmaps) {
+        RoaringBitmap result;
+        vector<size_t> next(bitmaps.size(), 0);
+        vector<const Container*> same_key;
+        while (true) {
+            // Smallest key not united yet and the containers holding it
+            int key = -1;
+            for (int b = 0; b < bitmaps.size(); b++) {
+                if (next[b] < bitmaps[b]->containers.size() && (key < 0 || bitmaps[b]->containers[next[b]].key < key))
+                    key = bitmaps[b]->containers[next[b]].key;
+            }
+            if (key < 0)
+                break;
+            same_key.clear();
+            int total = 0;
+            bool any_bitmap = false;
+            for (int b = 0; b < bitmaps.size(); b++) {
+                if (next[b] < bitmaps[b]->containers.size() && bitmaps[b]->containers[next[b]].key == key) {
+                    const Container &c = bitmaps[b]->containers[next[b]++];
+                    same_key.push_back(&c);
+                    total += c.cardinality;
+                    any_bitmap = any_bitmap || c.isBitmap();
+                }
+            }
+            if (same_key.size() == 1) {
+                result.containers.push_back(*same_key[0]);
+                continue;
+            }
+            Container united;
+            united.key = key;
+            if (!any_bitmap && total <= array_limit) {
+                // Merging in turn keeps the arrays sorted
+                vector<uint16_t> merged;
+                for (const Container* c : same_key) {
+                    merged.clear();
+                    set_union(united.array.begin(), united.array.end(), c->array.begin(), c->array.end(), back_inserter(merged));
+                    united.array.swap(merged);
+                }
+                united.cardinality = united.array.size();
+            }
+            else {
+                united.bits.assign(bitmap_words, 0);
+                Block* out = (Block*) united.bits.data();
+                for (const Container* c : same_key) {
+                    if (c->isBitmap()) {
+                        const Block* x = (const Block*) c->bits.data();
+                        for (int i = 0; i < bitmap_words / 4; i++)
+                            out[i] |= x[i];
+                    }
+                    else {
+                        for (uint16_t low : c->array)
+                            united.bits[low / 64] |= 1ULL << (low % 64);
+                    }
+                }
+                united.settle();
+            }
+            result.containers.push_back(move(united));
+        }
+        return result;
+    }
+
+    /// @brief All values in increasing order
+    vector<uint32_t> toVector() const {
+        vector<uint32_t> values;
+        values.reserve(cardinality());
+        for (const Container &c : containers) {
+            uint32_t high = (uint32_t) c.key << 16;
+            c.forEach([&](uint16_t low) { values.push_back(high | low); });
+        }
+        return values;
+    }
+};
+
+#endif
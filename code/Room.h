@@ -19,7 +19,7 @@ class Room : public Inventory {
         this->type = type;
     }
 
-    Record Purchase(Client* client, tm reservation_date) {
+    Record Purchase(Client* client, DateTime reservation_date) {
         return Record(this, client, reservation_date);
     }  
 };
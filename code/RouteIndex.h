@@ -0,0 +1,63 @@
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include "Airport.h"
+#include "Snapshot.h"
+#ifndef ROUTEINDEX_H
+#define ROUTEINDEX_H
+
+using namespace std;
+using namespace AirportInfo;
+
+/// @brief Hash index from (origin, destination, departure day) to the flights serving that route on that day
+class RouteIndex {
+    private:
+    /// @brief Flight handles (positions in the loaded flights vector) of each route and day
+    unordered_map<uint64_t, vector<int>> buckets;
+    /// @brief Returned when nothing matches
+    const vector<int> empty;
+
+    /// @brief Packs a route and day into a single hash key
+    /// @param origin
+    /// @param destination
+    /// @param day Day number since 01/01/1970
+    /// @return Key of the bucket
+    static inline uint64_t makeKey(Airport origin, Airport destination, int32_t day) {
+        return ((uint64_t) origin << 48) | ((uint64_t) destination << 32) | (uint32_t) day;
+    }
+
+    public:
+    /// @brief Removes all flights from the index
+    void clear() {
+        buckets.clear();
+    }
+
+    /// @brief Prepares the index for a bulk build
+    /// @param count Expected number of flights
+    void reserve(size_t count) {
+        buckets.reserve(count);
+    }
+
+    /// @brief Adds a flight to the index
+    /// @param origin
+    /// @param destination
+    /// @param departure Departure date of the flight
+    /// @param handle Position of the flight in the loaded flights vector
+    void insert(Airport origin, Airport destination, DateTime departure, int handle) {
+        buckets[makeKey(origin, destination, departure.getDayNumber())].push_back(handle);
+    }
+
+    /// @brief Finds all flights on a route departing on a day
+    /// @param origin
+    /// @param destination
+    /// @param departure Departure date to search for
+    /// @return Handles of the matching flights in the order they were added
+    const vector<int>& find(Airport origin, Airport destination, DateTime departure) const {
+        auto it = buckets.find(makeKey(origin, destination, departure.getDayNumber()));
+        if (it == buckets.end())
+            return empty;
+        return it->second;
+    }
+};
+
+#endif
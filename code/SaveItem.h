@@ -1,6 +1,8 @@
 #include <string>
+#include <cstring>
 #include <fstream>
 #include <filesystem>
+#include "Snapshot.h"
 #ifndef SAVEITEM_H
 #define SAVEITEM_H
 
@@ -9,41 +11,153 @@ using namespace std;
 /// @brief Abstract class for defining behavior of saveable item with RSA encryption decryption implemented
 class SaveItem {
     private:
-    static int n;
-    static int p;
-    static int q;
-    static int e;
-    static int d;
+    // RSA parameters
+    static constexpr int p = 23;
+    static constexpr int q = 29;
+    static constexpr int n = p * q;
+    static constexpr int e = 3;
+    static constexpr int d = 411;
+
+    /// @brief Encrypted text of one character, e.g. "537 "
+    struct EncodedChar {
+        char text[6];
+        int length;
+    };
+
+    /// @brief Lookup tables for the whole RSA mapping. Since n = 667 every character and every code fits in a small table
+    struct CodecTables {
+        /// @brief Encrypted text of each byte (indexed by unsigned value)
+        EncodedChar encoded[256];
+        /// @brief Decrypted character of each code from -(n - 1) to n - 1 (indexed by code + n - 1)
+        char decoded[2 * n - 1];
+    };
+
+    /// @brief Builds the codec tables at compile time with the same arithmetic as fastExponentiation, so the output stays byte-compatible
+    /// @return Filled tables
+    static constexpr CodecTables buildTables() {
+        CodecTables tables = {};
+        for (int i = 0; i < 256; i++) {
+            int code = fastExponentiation((int) (signed char) i, e, n);
+            EncodedChar &encoded = tables.encoded[i];
+            char digits[4] = {};
+            int count = 0;
+            int value = code < 0 ? -code : code;
+            do {
+                digits[count++] = '0' + value % 10;
+                value /= 10;
+            } while (value > 0);
+            if (code < 0)
+                encoded.text[encoded.length++] = '-';
+            while (count > 0)
+                encoded.text[encoded.length++] = digits[--count];
+            encoded.text[encoded.length++] = ' ';
+        }
+        for (int code = -(n - 1); code <= n - 1; code++)
+            tables.decoded[code + n - 1] = (char) fastExponentiation(code, d, n);
+        return tables;
+    }
+
+    static const CodecTables tables;
 
     public:
     virtual bool save() = 0;
 
+    /// @brief Largest encrypted size of a message, for sizing buffers passed to encryptInto
+    /// @param length Length of the plain message
+    /// @return Number of bytes encryptInto may write
+    static constexpr size_t maxEncryptedLength(size_t length) {
+        return length * 5;
+    }
+
+    /// @brief Largest decrypted size of a message, for sizing buffers passed to decryptInto.
+    /// Every character but the last needs at least one digit and one separator
+    /// @param length Length of the encrypted message
+    /// @return Number of bytes decryptInto may write
+    static constexpr size_t maxDecryptedLength(size_t length) {
+        return (length + 1) / 2;
+    }
+
+    /// @brief Encrypts a whole field into a caller provided buffer without allocating
+    /// @param message message to encrypt
+    /// @param length length of the message
+    /// @param out buffer of at least maxEncryptedLength(length) bytes
+    /// @return Number of bytes written
+    static size_t encryptInto(const char* message, size_t length, char* out) {
+        char* start = out;
+        for (size_t i = 0; i < length; i++) {
+            const EncodedChar &encoded = tables.encoded[(unsigned char) message[i]];
+            memcpy(out, encoded.text, 4); // Codes are at most 4 characters with the space, a longer one copies the rest below
+            if (encoded.length > 4)
+                memcpy(out + 4, encoded.text + 4, encoded.length - 4);
+            out += encoded.length;
+        }
+        return out - start;
+    }
+
+    /// @brief Decrypts a whole field into a caller provided buffer without allocating
+    /// @param message message to decrypt (codes separated by whitespace)
+    /// @param length length of the message
+    /// @param out buffer of at least maxDecryptedLength(length) bytes
+    /// @return Number of bytes written
+    static size_t decryptInto(const char* message, size_t length, char* out) {
+        char* start = out;
+        const char* end = message + length;
+        while (message < end) {
+            while (message < end && (*message == ' ' || *message == '\n' || *message == '\t' || *message == '\r'))
+                message++;
+            if (message == end)
+                break;
+            bool negative = *message == '-';
+            if (negative || *message == '+')
+                message++;
+            long code = 0;
+            while (message < end && *message >= '0' && *message <= '9' && code < n)
+                code = code * 10 + (*message++ - '0');
+            // Skip what is left of the code (digits past the range or stray characters)
+            while (message < end && *message != ' ' && *message != '\n' && *message != '\t' && *message != '\r')
+                message++;
+            if (negative)
+                code = -code;
+            *out++ = (code > -n && code < n) ? tables.decoded[code + n - 1] : (char) fastExponentiation(code % n, d, n);
+        }
+        return out - start;
+    }
+
     protected:
     /// @brief Implements RSA encryption
     /// @param message message to encrypt
     /// @return encrypted message
-    static string encrypt(string message) {
-        string encrypted = "";
-        for (int i = 0; i < message.length(); i++) {
-            encrypted += to_string(fastExponentiation((int) message[i], e, n)) + " ";
-        }
+    static string encrypt(const string &message) {
+        string encrypted(maxEncryptedLength(message.length()), '\0');
+        encrypted.resize(encryptInto(message.data(), message.length(), &encrypted[0]));
         return encrypted;
     }
 
     /// @brief Implements RSA decryption
     /// @param message message to decrypt
     /// @return decrypted message
-    static string decrypt(string message) {
-        stringstream stream(message);
-        string current;
-        string decrypted = "";
-        while (stream >> current) {
-            decrypted += (char)(fastExponentiation(stoi(current), d, n));
-        }
+    static string decrypt(const string &message) {
+        string decrypted(maxDecryptedLength(message.length()), '\0');
+        decrypted.resize(decryptInto(message.data(), message.length(), &decrypted[0]));
         return decrypted;
     }
 
-    static int fastExponentiation(int b, int e, int p) {
+    /// @brief Encrypts a single character
+    /// @param c character to encrypt
+    /// @return RSA code of the character
+    static int encryptChar(char c) {
+        return fastExponentiation((int) c, e, n);
+    }
+
+    /// @brief Decrypts a single RSA code
+    /// @param code code to decrypt
+    /// @return decrypted character
+    static char decryptChar(int code) {
+        return (code > -n && code < n) ? tables.decoded[code + n - 1] : (char) fastExponentiation(code % n, d, n);
+    }
+
+    /// @brief Modular exponentiation by repeated multiplication, only used to build the codec tables
+    static constexpr int fastExponentiation(int b, int e, int p) {
         int res = 1;
         for (int i = 0; i < e; i++) {
             res *= b;
@@ -54,11 +168,7 @@ class SaveItem {
 
 };
 
-// Static variables (RSA parameters)
-int SaveItem::n = 23*29;
-int SaveItem::p = 23;
-int SaveItem::q = 29;
-int SaveItem::e = 3;
-int SaveItem::d = 411;
+// Static variables (codec tables generated by the compiler)
+constexpr SaveItem::CodecTables SaveItem::tables = SaveItem::buildTables();
 
-#endif
\ No newline at end of file
+#endif
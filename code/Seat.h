@@ -1,5 +1,7 @@
 #include "Column.h"
 #include "Record.h"
+#include "SeatMap.h"
+#include <cctype>
 #define stringify( name ) #name
 #ifndef SEAT_H
 #define SEAT_H
@@ -13,52 +15,93 @@ class Seat : public Inventory {
     private:
     /// @brief Linked flight ID
     const string flight_ID;
+    /// @brief Seating category of the seat
+    int category;
     /// @brief Column enum
     Column col;
     int row;
-    bool reserved = false;
+    /// @brief Seat map of the linked flight, which holds the reservation state of the seat
+    SeatMap* seat_map;
 
     /// @brief Generates a seat ID based on the flight ID and seat position
     /// @param flight_ID 
+    /// @param category 
     /// @param row 
     /// @param col 
     /// @return unique string identifier
-    string generateID(string flight_ID, int row, Column col) {
-        return flight_ID + Col_to_String(col) + to_string(row);
+    string generateID(string flight_ID, int category, int row, Column col) {
+        return flight_ID + '-' + to_string(category) + Col_to_String(col) + to_string(row);
     }
 
     public:
-    Seat(string flight_ID, int row, Column col, double price) : flight_ID(flight_ID), Inventory(generateID(flight_ID, row, col), price) {
+    Seat(string flight_ID, int category, int row, Column col, double price, SeatMap* seat_map) : flight_ID(flight_ID), Inventory(generateID(flight_ID, category, row, col), price) {
+        this->category = category;
         this->row = row;
         this->col = col;
+        this->seat_map = seat_map;
     }
 
     // Getter functions
     string getFlightID() const { return flight_ID; }
+    int getCategory() const { return category; }
     int getRow() const { return row; }
     Column getCol() const { return col; }
     int getColAsInt() const { return (int) col; }
-    bool getReserved() const { return reserved; }
+    bool getReserved() const { return seat_map->test(category, row, col); }
+
+    /// @brief Splits a seat ID into the flight ID and seat position
+    /// @param ID Seat ID in the form <flight ID>-<category><column><row>, or <flight ID><column><row> for IDs written before the category was added
+    /// @param flight_ID Set to the flight ID
+    /// @param category Set to the category, -1 if the ID has none
+    /// @param row Set to the row
+    /// @param col Set to the column
+    /// @return False if the ID is malformed
+    static bool parseID(const string &ID, string &flight_ID, int &category, int &row, int &col) {
+        int i = 0;
+        while (i < ID.length() && isdigit(ID[i]))
+            i++;
+        if (i == 0 || i == ID.length())
+            return false;
+        flight_ID = ID.substr(0, i);
+        category = -1;
+        if (ID[i] == '-') {
+            category = 0;
+            if (++i == ID.length() || !isdigit(ID[i]))
+                return false;
+            while (i < ID.length() && isdigit(ID[i]))
+                category = category * 10 + (ID[i++] - '0');
+        }
+        if (i == ID.length() || ID[i] < 'A' || ID[i] > 'Z')
+            return false;
+        col = ID[i++] - 'A';
+        if (i == ID.length())
+            return false;
+        row = 0;
+        for (; i < ID.length(); i++) {
+            if (!isdigit(ID[i]))
+                return false;
+            row = row * 10 + (ID[i] - '0');
+        }
+        return true;
+    }
 
     /// @brief Reserves the seat
     /// @return true if successful, false otherwise
     bool Reserve() {
-        if (reserved)
-            return false;
-        reserved = true;
-        return true;
+        return seat_map->reserve(category, row, col);
     }
 
     /// @brief For canceling reservations
-    void Cancel() {
-        reserved = false;
+    /// @return true if the seat was reserved, false otherwise
+    bool Cancel() {
+        return seat_map->cancel(category, row, col);
     }
 
     /// @brief Implementation of abstract function in Inventory class
     /// @param client Client purchasing the seat
     /// @param reservation_time Date of the flight
     /// @return Record (PNR) of the transaction
-    Record Purchase(Client* client, tm reservation_time) {
+    Record Purchase(Client* client, DateTime reservation_time) {
         if (Reserve())
             return Record(this, client, reservation_time);
         return Record();
@@ -0,0 +1,350 @@
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#ifndef SEATMAP_H
+#define SEATMAP_H
+
+using namespace std;
+
+class SeatMap;
+
+/// @brief Told about every seat that changes state, e.g. to keep an index over many flights up to date
+class SeatObserver {
+    public:
+    /// @brief Called by the thread whose reserve or cancel flipped the seat, after the free seat counter was updated
+    /// @param seat_map Seat map of the seat
+    /// @param handle Handle the seat map was watched with
+    /// @param category Category of the seat
+    /// @param row Row of the seat
+    virtual void seatChanged(const SeatMap &seat_map, int handle, int category, int row) = 0;
+};
+
+/// @brief Bit-packed reservation state of all seats of a flight. Each category is stored row major with one bit per seat and starts on a new 64 bit word.
+/// Reserving and cancelling are single atomic operations on a word, so any number of threads can book seats of the same flight without a lock
+/// and exactly one of several threads racing for a seat wins it. Loading (fromString, fromWords) must not run concurrently with bookings.
+/// The number of reserved seats of each category is kept next to the bits, so availability is known without looking at any seat.
+class SeatMap {
+    private:
+    /// @brief Layout of one category inside the word array
+    struct Category {
+        int rows;
+        int cols;
+        /// @brief Index of the first word of the category
+        int word_offset;
+        int word_count;
+    };
+
+    vector<Category> categories;
+    vector<uint64_t> words;
+    /// @brief Reserved seats per category, changed by whichever reserve or cancel flipped a bit
+    vector<int32_t> reserved;
+    /// @brief Told about every change of a seat, if set
+    SeatObserver* observer = nullptr;
+    int observer_handle = -1;
+
+    /// @brief Position of a seat bit
+    /// @param category
+    /// @param row
+    /// @param col
+    /// @return Index of the bit over the whole word array
+    inline size_t bitIndex(int category, int row, int col) const {
+        return (size_t) categories[category].word_offset * 64 + (size_t) row * categories[category].cols + col;
+    }
+
+    /// @brief Expands the 8 low bits of a byte into 8 '0'/'1' characters at once
+    /// @param bits byte to expand
+    /// @return The 8 characters packed in a word (first character in the lowest byte)
+    static inline uint64_t expandByte(uint64_t bits) {
+        uint64_t spread = (bits * 0x0101010101010101ULL) & 0x8040201008040201ULL;
+        spread = ((spread + 0x7F7F7F7F7F7F7F7FULL) & 0x8080808080808080ULL) >> 7;
+        return spread + 0x3030303030303030ULL;
+    }
+
+    /// @brief Packs 8 '0'/'1' characters into the 8 low bits of a byte at once
+    /// @param chars The 8 characters packed in a word (first character in the lowest byte)
+    /// @return byte with bit i set if character i is '1'
+    static inline uint64_t packByte(uint64_t chars) {
+        return (((chars & 0x0101010101010101ULL) * 0x0102040810204080ULL) >> 56) & 0xFF;
+    }
+
+    /// @brief Counts the reserved seats of a category from its words after they were loaded
+    void recount(int category) {
+        const Category &layout = categories[category];
+        int count = layout.rows * layout.cols, total = 0;
+        for (int w = 0; w < layout.word_count; w++) {
+            uint64_t word = words[layout.word_offset + w];
+            // Bits past the last seat are not seats
+            if (count - w * 64 < 64)
+                word &= (1ULL << (count - w * 64)) - 1;
+            total += __builtin_popcountll(word);
+        }
+        reserved[category] = total;
+    }
+
+    public:
+    SeatMap() {}
+
+    /// @brief Creates an empty seat map
+    /// @param dimensions [rows, columns] of each category
+    SeatMap(const vector<vector<int>> &dimensions) {
+        int offset = 0;
+        for (int i = 0; i < dimensions.size(); i++) {
+            Category category;
+            category.rows = dimensions[i][0];
+            category.cols = dimensions[i][1];
+            category.word_offset = offset;
+            category.word_count = (category.rows * category.cols + 63) / 64;
+            offset += category.word_count;
+            categories.push_back(category);
+        }
+        words.assign(offset, 0);
+        reserved.assign(categories.size(), 0);
+    }
+
+    // Getter functions
+    int getNumCategories() const { return categories.size(); }
+    int getRows(int category) const { return categories[category].rows; }
+    int getCols(int category) const { return categories[category].cols; }
+    const uint64_t* getWords() const { return words.data(); }
+    int getWordCount() const { return words.size(); }
+
+    /// @brief Number of seats of a category
+    int getCapacity(int category) const { return categories[category].rows * categories[category].cols; }
+    /// @brief Number of reserved seats of a category
+    int getReserved(int category) const { return __atomic_load_n(&reserved[category], __ATOMIC_RELAXED); }
+    /// @brief Number of free seats of a category
+    int getFree(int category) const { return getCapacity(category) - getReserved(category); }
+
+    /// @brief Number of seats over all categories
+    int getTotalCapacity() const {
+        int total = 0;
+        for (int i = 0; i < categories.size(); i++)
+            total += getCapacity(i);
+        return total;
+    }
+
+    /// @brief Position of the n-th seat, counting row major over the categories in order
+    /// @param n Seat index from 0 to getTotalCapacity() - 1
+    /// @param category Set to the category of the seat
+    /// @param row Set to the row of the seat
+    /// @param col Set to the column of the seat
+    void seatAt(int n, int &category, int &row, int &col) const {
+        for (category = 0; n >= getCapacity(category); category++)
+            n -= getCapacity(category);
+        row = n / getCols(category);
+        col = n % getCols(category);
+    }
+
+    /// @brief Number of free seats over all categories
+    int getTotalFree() const {
+        int total = 0;
+        for (int i = 0; i < categories.size(); i++)
+            total += getFree(i);
+        return total;
+    }
+
+    /// @brief Checks that a seat position exists
+    /// @return True if category, row and column are in range
+    bool contains(int category, int row, int col) const {
+        return category >= 0 && category < categories.size() && row >= 0 && row < categories[category].rows && col >= 0 && col < categories[category].cols;
+    }
+
+    /// @brief Tests if a seat is reserved
+    /// @return True if reserved
+    inline bool test(int category, int row, int col) const {
+        size_t bit = bitIndex(category, row, col);
+        return (loadWord(bit / 64) >> (bit % 64)) & 1;
+    }
+
+    /// @brief Reads a word while other threads may be reserving seats in it
+    /// @param index Index of the word
+    /// @return The word as last published by reserve or cancel
+    inline uint64_t loadWord(size_t index) const {
+        return __atomic_load_n(&words[index], __ATOMIC_ACQUIRE);
+    }
+
+    /// @brief Reserves a seat. The bit is set with one atomic read-modify-write, so the check and the set cannot be split by another thread
+    /// @return True if the seat was free, false if it was already reserved
+    inline bool reserve(int category, int row, int col) {
+        size_t bit = bitIndex(category, row, col);
+        uint64_t mask = 1ULL << (bit % 64);
+        if (__atomic_fetch_or(&words[bit / 64], mask, __ATOMIC_ACQ_REL) & mask)
+            return false;
+        __atomic_fetch_add(&reserved[category], 1, __ATOMIC_RELAXED);
+        if (observer != nullptr)
+            observer->seatChanged(*this, observer_handle, category, row);
+        return true;
+    }
+
+    /// @brief Cancels the reservation of a seat
+    /// @return True if the seat was reserved, false if it was already free
+    inline bool cancel(int category, int row, int col) {
+        size_t bit = bitIndex(category, row, col);
+        uint64_t mask = 1ULL << (bit % 64);
+        if (!(__atomic_fetch_and(&words[bit / 64], ~mask, __ATOMIC_ACQ_REL) & mask))
+            return false;
+        __atomic_fetch_sub(&reserved[category], 1, __ATOMIC_RELAXED);
+        if (observer != nullptr)
+            observer->seatChanged(*this, observer_handle, category, row);
+        return true;
+    }
+
+    /// @brief Reserves several seats of a category as one group: either all of them become reserved or none does.
+    /// The seats of each word are set with one atomic read-modify-write, so a group within one row of one word is won in a single step.
+    /// If a seat of a later word was taken, the words already set are given back, and another booker may briefly see them reserved
+    /// @param category
+    /// @param seats Row and column of each seat
+    /// @return True if every seat was free, false if a seat was reserved, missing or given twice
+    bool reserveGroup(int category, const vector<pair<int, int>> &seats) {
+        // Bits to set in each word, in word order
+        vector<pair<size_t, uint64_t>> masks;
+        for (int i = 0; i < seats.size(); i++) {
+            if (!contains(category, seats[i].first, seats[i].second))
+                return false;
+            size_t bit = bitIndex(category, seats[i].first, seats[i].second);
+            masks.push_back(make_pair(bit / 64, 1ULL << (bit % 64)));
+        }
+        sort(masks.begin(), masks.end());
+        int merged = 0;
+        for (int i = 0; i < masks.size(); i++) {
+            if (merged > 0 && masks[merged - 1].first == masks[i].first) {
+                if (masks[merged - 1].second & masks[i].second)
+                    return false;
+                masks[merged - 1].second |= masks[i].second;
+            }
+            else
+                masks[merged++] = masks[i];
+        }
+        masks.resize(merged);
+        for (int i = 0; i < masks.size(); i++) {
+            uint64_t before = __atomic_fetch_or(&words[masks[i].first], masks[i].second, __ATOMIC_ACQ_REL);
+            if (before & masks[i].second) {
+                // Only the bits this call set are cleared again
+                __atomic_fetch_and(&words[masks[i].first], ~(masks[i].second & ~before), __ATOMIC_ACQ_REL);
+                for (int j = 0; j < i; j++)
+                    __atomic_fetch_and(&words[masks[j].first], ~masks[j].second, __ATOMIC_ACQ_REL);
+                return false;
+            }
+        }
+        __atomic_fetch_add(&reserved[category], (int32_t) seats.size(), __ATOMIC_RELAXED);
+        if (observer != nullptr) {
+            for (int i = 0; i < seats.size(); i++)
+                observer->seatChanged(*this, observer_handle, category, seats[i].first);
+        }
+        return true;
+    }
+
+    /// @brief Reservation bits of one row, bit c set if the seat in column c is reserved. Rows are at most 64 seats wide
+    /// @param category
+    /// @param row
+    /// @return Mask of the reserved seats of the row
+    uint64_t rowMask(int category, int row) const {
+        int cols = min(categories[category].cols, 64);
+        size_t bit = bitIndex(category, row, 0);
+        uint64_t mask = loadWord(bit / 64) >> (bit % 64);
+        // A row may continue in the next word
+        if (bit % 64 + cols > 64)
+            mask |= loadWord(bit / 64 + 1) << (64 - bit % 64);
+        return cols == 64 ? mask : mask & ((1ULL << cols) - 1);
+    }
+
+    /// @brief Free seats of one row, bit c set if the seat in column c is free
+    uint64_t freeMask(int category, int row) const {
+        int cols = min(categories[category].cols, 64);
+        return ~rowMask(category, row) & (cols == 64 ? ~0ULL : (1ULL << cols) - 1);
+    }
+
+    /// @brief Positions where a run of set bits of a given length starts. Each step doubles the length checked, so a run of n takes log2(n) steps
+    /// @param bits e.g. a free seat mask
+    /// @param length Length of the runs, at least 1
+    /// @return Bit c set if bits c to c + length - 1 are all set
+    static uint64_t runStarts(uint64_t bits, int length) {
+        for (int covered = 1; covered < length && bits != 0;) {
+            int shift = min(covered, length - covered);
+            bits &= bits >> shift;
+            covered += shift;
+        }
+        return bits;
+    }
+
+    /// @brief Length of the longest run of set bits, each step removes the last bit of every run
+    static int longestRun(uint64_t bits) {
+        int length = 0;
+        for (; bits != 0; length++)
+            bits &= bits >> 1;
+        return length;
+    }
+
+    /// @brief Largest number of adjacent free seats in one row of a category
+    int longestFreeBlock(int category) const {
+        int cols = min(categories[category].cols, 64);
+        int longest = 0;
+        for (int row = 0; row < categories[category].rows && longest < cols; row++)
+            longest = max(longest, longestRun(freeMask(category, row)));
+        return longest;
+    }
+
+    /// @brief Sets the observer told about every seat change from now on, replacing the previous one
+    /// @param seat_observer Observer, nullptr to stop
+    /// @param handle Passed back to the observer, e.g. the position of the flight
+    void watch(SeatObserver* seat_observer, int handle) {
+        observer = seat_observer;
+        observer_handle = handle;
+    }
+
+    /// @brief Generates the '0'/'1' reservation string of a category, 8 seats at a time
+    /// @param category
+    /// @return String with one character per seat in row major order
+    string toString(int category) const {
+        const Category &layout = categories[category];
+        int count = layout.rows * layout.cols;
+        string str(layout.word_count * 64, '0');
+        char* out = &str[0];
+        for (int w = 0; w < layout.word_count; w++, out += 64) {
+            uint64_t word = loadWord(layout.word_offset + w);
+            if (word == 0)
+                continue; // Already all '0'
+            for (int b = 0; b < 8; b++) {
+                uint64_t chars = expandByte((word >> (8 * b)) & 0xFF);
+                memcpy(out + 8 * b, &chars, 8);
+            }
+        }
+        str.resize(count);
+        return str;
+    }
+
+    /// @brief Sets the reservation state of a category from its '0'/'1' string, 8 seats at a time
+    /// @param category
+    /// @param str String with one character per seat in row major order
+    void fromString(int category, string_view str) {
+        const Category &layout = categories[category];
+        int count = min((int) str.length(), layout.rows * layout.cols);
+        for (int w = 0; w < layout.word_count; w++) {
+            uint64_t word = 0;
+            int begin = w * 64;
+            int b = 0;
+            for (; b < 8 && begin + 8 * (b + 1) <= count; b++) {
+                uint64_t chars;
+                memcpy(&chars, str.data() + begin + 8 * b, 8);
+                word |= packByte(chars) << (8 * b);
+            }
+            for (int i = begin + 8 * b; i < begin + 64 && i < count; i++)
+                word |= (uint64_t) (str[i] == '1') << (i - begin);
+            words[layout.word_offset + w] = word;
+        }
+        recount(category);
+    }
+
+    /// @brief Sets the reservation state of all seats from packed words in the same layout
+    /// @param source Words to copy
+    void fromWords(const uint64_t* source) {
+        memcpy(words.data(), source, words.size() * sizeof(uint64_t));
+        for (int i = 0; i < categories.size(); i++)
+            recount(i);
+    }
+};
+
+#endif
@@ -0,0 +1,335 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "DateTime.h"
+#include "Trace.h"
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+using namespace std;
+
+/// @brief Namespace describing the versioned binary snapshot of all storage files.
+/// The snapshot is a header with an offset table followed by arrays of fixed-width entries, so it can be memory mapped and read without any parsing.
+namespace SnapshotFormat {
+
+    /// @brief Current version of the format. Snapshots of any other version are ignored
+    const uint32_t version = 1;
+
+    /// @brief Sections listed in the offset table
+    enum Section { PLANES, FLIGHTS, CLIENTS, RECORDS, DIMENSIONS, PRICES, SEAT_WORDS, NUM_SECTIONS };
+
+    /// @brief Storage files the snapshot was built from
+    enum Source { AIRPLANES_CSV, FLIGHTS_CSV, CLIENTS_CSV, RECORDS_CSV, NUM_SOURCES };
+
+    /// @brief Position of a section in the file
+    struct SectionEntry {
+        uint64_t offset;
+        uint64_t count;
+    };
+
+    /// @brief Identity of the storage file prefix a section was built from
+    struct SourceEntry {
+        uint64_t inode;
+        /// @brief Size of the storage file when the snapshot was built
+        uint64_t size;
+        /// @brief Hash of the last bytes before size, to detect a file that was cleared and written again
+        uint64_t tail_hash;
+        uint64_t valid;
+    };
+
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t header_size;
+        SectionEntry sections[NUM_SECTIONS];
+        SourceEntry sources[NUM_SOURCES];
+    };
+
+    /// @brief Airplane entry, dimensions are stored as [rows, columns] pairs in the DIMENSIONS section
+    struct PlaneEntry {
+        uint32_t ID;
+        uint32_t num_categories;
+        uint32_t dimensions_offset;
+        char model[52];
+    };
+
+    /// @brief Flight entry, prices are in the PRICES section and the bit-packed seat map of each category in the SEAT_WORDS section
+    struct FlightEntry {
+        uint32_t ID;
+        uint32_t plane_ID;
+        /// @brief Minutes since 01/01/1970
+        int32_t t_depart;
+        int32_t t_arrive;
+        /// @brief Airport enum ordinals
+        uint16_t origin;
+        uint16_t destination;
+        uint32_t prices_offset;
+        uint32_t seats_offset;
+        uint32_t padding;
+    };
+
+    /// @brief Client entry including the passport. The password is kept as RSA codes so it is never stored in plain text
+    struct ClientEntry {
+        uint32_t ID;
+        /// @brief Minutes since 01/01/1970
+        int32_t DoB;
+        int32_t DoI;
+        int32_t DoE;
+        int64_t phone;
+        /// @brief CountryEnum ordinal
+        uint8_t country;
+        char type;
+        char sex;
+        uint8_t password_length;
+        char name[64];
+        char passport_ID[20];
+        char email[64];
+        char username[32];
+        uint16_t password[32];
+    };
+
+    /// @brief Record (PNR) entry
+    struct RecordEntry {
+        uint32_t ID;
+        uint32_t client_ID;
+        /// @brief Minutes since 01/01/1970
+        int32_t reservation_date;
+        char inventory_ID[20];
+    };
+
+    /// @brief Copies a string into a fixed-width field
+    /// @return False if the string does not fit (it needs a terminating zero)
+    inline bool copyField(char* field, size_t width, const string &str) {
+        if (str.length() >= width)
+            return false;
+        memset(field, 0, width);
+        memcpy(field, str.data(), str.length());
+        return true;
+    }
+
+    /// @brief Reads a fixed-width field back into a string
+    inline string readField(const char* field, size_t width) {
+        return string(field, strnlen(field, width));
+    }
+}
+
+using namespace SnapshotFormat;
+
+/// @brief Memory mapped view of the binary snapshot. Each storage file only has its snapshot section used
+/// if the file still starts with the exact bytes the snapshot was built from, the remaining lines are read from the file.
+class Snapshot {
+    private:
+    /// @brief Path of the snapshot file
+    static const string save_path;
+    /// @brief Magic bytes at the start of every snapshot
+    static const char magic[8];
+    /// @brief Start of the mapping, nullptr if there is no usable snapshot
+    const char* data = nullptr;
+    /// @brief Size of the mapping
+    size_t size = 0;
+
+    Snapshot() {
+        int fd = open(save_path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            return;
+        struct stat info;
+        if (fstat(fd, &info) == 0 && info.st_size >= (off_t) sizeof(Header)) {
+            void* mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping != MAP_FAILED) {
+                data = (const char*) mapping;
+                size = info.st_size;
+            }
+        }
+        close(fd);
+        if (data != nullptr && !validate()) {
+            cerr << "Ignoring invalid snapshot..." << endl;
+            munmap((void*) data, size);
+            data = nullptr;
+            size = 0;
+        }
+    }
+
+    ~Snapshot() {
+        if (data != nullptr)
+            munmap((void*) data, size);
+    }
+
+    /// @brief Checks the magic bytes, version and that every section lies inside the file
+    /// @return True if the snapshot can be used
+    bool validate() const {
+        const Header* header = getHeader();
+        if (memcmp(header->magic, magic, sizeof(magic)) != 0 || header->version != version || header->header_size != sizeof(Header))
+            return false;
+        const size_t entry_sizes[NUM_SECTIONS] = { sizeof(PlaneEntry), sizeof(FlightEntry), sizeof(ClientEntry), sizeof(RecordEntry), 2 * sizeof(uint16_t), sizeof(double), sizeof(uint64_t) };
+        for (int i = 0; i < NUM_SECTIONS; i++) {
+            const SectionEntry &section = header->sections[i];
+            if (section.offset > size || section.count > (size - section.offset) / entry_sizes[i])
+                return false;
+        }
+        return true;
+    }
+
+    const Header* getHeader() const { return (const Header*) data; }
+
+    public:
+    Snapshot(const Snapshot&) = delete;
+    Snapshot& operator=(const Snapshot&) = delete;
+
+    /// @brief Maps the snapshot the first time it is needed
+    /// @return The process wide snapshot
+    static Snapshot& get() {
+        static Snapshot snapshot;
+        return snapshot;
+    }
+
+    static string getSavePath() { return save_path; }
+
+    /// @brief Hashes the bytes right before end in the given file (FNV-1a)
+    /// @param path File to hash
+    /// @param end End of the hashed range
+    /// @return Hash value
+    static uint64_t tailHash(const string &path, uint64_t end) {
+        const uint64_t length = 256;
+        uint64_t begin = end > length ? end - length : 0;
+        char buffer[length];
+        uint64_t hash = 1469598103934665603ULL;
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            return 0;
+        ssize_t count = pread(fd, buffer, end - begin, begin);
+        close(fd);
+        if (count != (ssize_t) (end - begin))
+            return 0;
+        for (ssize_t i = 0; i < count; i++) {
+            hash ^= (unsigned char) buffer[i];
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    /// @brief Describes the current state of a storage file
+    /// @param path Storage file
+    /// @return Source entry to store in a new snapshot
+    static SourceEntry describe(const string &path) {
+        SourceEntry source = SourceEntry();
+        struct stat info;
+        if (stat(path.c_str(), &info) != 0)
+            return source;
+        source.inode = info.st_ino;
+        source.size = info.st_size;
+        source.tail_hash = tailHash(path, info.st_size);
+        source.valid = 1;
+        return source;
+    }
+
+    /// @brief Checks if the snapshot section of a storage file can be used
+    /// @param source Which storage file
+    /// @param path Path of the storage file
+    /// @param resume_offset Set to the offset where lines added after the snapshot start
+    /// @return True if the snapshot entries can be used, false if the whole file has to be read
+    bool covers(Source source, const string &path, uint64_t &resume_offset) const {
+        resume_offset = 0;
+        if (data == nullptr)
+            return false;
+        const SourceEntry &entry = getHeader()->sources[source];
+        struct stat info;
+        if (!entry.valid || stat(path.c_str(), &info) != 0)
+            return false;
+        if ((uint64_t) info.st_ino != entry.inode || (uint64_t) info.st_size < entry.size || tailHash(path, entry.size) != entry.tail_hash)
+            return false;
+        resume_offset = entry.size;
+        return true;
+    }
+
+    /// @brief Gives direct access to the entries of a section
+    /// @param section Section to read
+    /// @param count Set to the number of entries
+    /// @return Pointer to the first entry inside the mapping
+    template <class T>
+    const T* entries(Section section, uint64_t &count) const {
+        count = 0;
+        if (data == nullptr)
+            return nullptr;
+        const SectionEntry &entry = getHeader()->sections[section];
+        count = entry.count;
+        return (const T*) (data + entry.offset);
+    }
+
+    /// @brief Tests a seat bit directly in the mapped seat words
+    /// @param word_offset Offset of the category's first word
+    /// @param bit Seat index in row major order
+    /// @return True if the seat is reserved
+    bool seatReserved(uint64_t word_offset, uint64_t bit) const {
+        uint64_t count;
+        const uint64_t* words = entries<uint64_t>(SEAT_WORDS, count);
+        return (words[word_offset + bit / 64] >> (bit % 64)) & 1;
+    }
+
+    /// @brief Writes a new snapshot next to the old one and renames it into place
+    /// @param planes
+    /// @param flights
+    /// @param clients
+    /// @param records
+    /// @param dimensions
+    /// @param prices
+    /// @param seat_words
+    /// @param sources Description of the storage files the entries came from
+    /// @return True if the snapshot was written, false otherwise
+    static bool write(const vector<PlaneEntry> &planes, const vector<FlightEntry> &flights, const vector<ClientEntry> &clients, const vector<RecordEntry> &records,
+                      const vector<uint16_t> &dimensions, const vector<double> &prices, const vector<uint64_t> &seat_words, const SourceEntry sources[NUM_SOURCES]) {
+        TRACE_SPAN("Snapshot::write");
+        Header header = Header();
+        memcpy(header.magic, magic, sizeof(magic));
+        header.version = version;
+        header.header_size = sizeof(Header);
+        const void* sections[NUM_SECTIONS] = { planes.data(), flights.data(), clients.data(), records.data(), dimensions.data(), prices.data(), seat_words.data() };
+        const uint64_t counts[NUM_SECTIONS] = { planes.size(), flights.size(), clients.size(), records.size(), dimensions.size() / 2, prices.size(), seat_words.size() };
+        const uint64_t entry_sizes[NUM_SECTIONS] = { sizeof(PlaneEntry), sizeof(FlightEntry), sizeof(ClientEntry), sizeof(RecordEntry), 2 * sizeof(uint16_t), sizeof(double), sizeof(uint64_t) };
+        uint64_t offset = sizeof(Header);
+        for (int i = 0; i < NUM_SECTIONS; i++) {
+            offset = (offset + 7) & ~7ULL; // Keep every section 8 byte aligned
+            header.sections[i].offset = offset;
+            header.sections[i].count = counts[i];
+            offset += counts[i] * entry_sizes[i];
+        }
+        for (int i = 0; i < NUM_SOURCES; i++)
+            header.sources[i] = sources[i];
+
+        string temp_path = save_path + ".tmp";
+        FILE* writer = fopen(temp_path.c_str(), "wb");
+        if (writer == nullptr) {
+            cerr << "Error saving snapshot..." << endl;
+            return false;
+        }
+        bool written = fwrite(&header, sizeof(Header), 1, writer) == 1;
+        const char padding[8] = {0};
+        uint64_t position = sizeof(Header);
+        for (int i = 0; i < NUM_SECTIONS && written; i++) {
+            written = fwrite(padding, 1, header.sections[i].offset - position, writer) == header.sections[i].offset - position;
+            uint64_t bytes = counts[i] * entry_sizes[i];
+            written = written && (bytes == 0 || fwrite(sections[i], 1, bytes, writer) == bytes);
+            position = header.sections[i].offset + bytes;
+        }
+        written = fflush(writer) == 0 && fsync(fileno(writer)) == 0 && written;
+        fclose(writer);
+        if (!written || rename(temp_path.c_str(), save_path.c_str()) != 0) {
+            cerr << "Error saving snapshot..." << endl;
+            remove(temp_path.c_str());
+            return false;
+        }
+        return true;
+    }
+};
+
+// Static variables
+const string Snapshot::save_path = "SaveData/Snapshot.bin";
+const char Snapshot::magic[8] = {'M', 'K', 'S', 'N', 'A', 'P', 0, 0};
+
+#endif
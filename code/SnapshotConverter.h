@@ -0,0 +1,70 @@
+#include <iostream>
+#include <vector>
+#include "Flight.h"
+#ifndef SNAPSHOTCONVERTER_H
+#define SNAPSHOTCONVERTER_H
+
+using namespace std;
+
+/// @brief Namespace for converting the CSV storage files into the binary snapshot
+namespace SnapshotConverter {
+
+    /// @brief Storage file of each snapshot source, in the order of the Source enum
+    const string source_paths[NUM_SOURCES] = {"SaveData/Airplanes.csv", "SaveData/Flights.csv", "SaveData/Clients.csv", "SaveData/Records.csv"};
+
+    /// @brief Loads every storage file and writes all of it into a new snapshot.
+    /// A storage file with an item that does not fit the fixed-width entries is left out and keeps being read as text.
+    /// @return True if the snapshot was written, false otherwise
+    bool convert() {
+        TRACE_SPAN("SnapshotConverter::convert");
+        SourceEntry sources[NUM_SOURCES];
+        for (int i = 0; i < NUM_SOURCES; i++)
+            sources[i] = Snapshot::describe(source_paths[i]);
+
+        vector<Airplane> planes = Airplane::loadAll();
+        vector<Flight> flights = Flight::loadAll(planes);
+        vector<Client> clients = Client::loadAll();
+        IdRegistry<Flight> flight_registry(flights);
+        vector<Record> records = Record::loadAll(clients, [&](const string &ID) -> Inventory* { return Flight::findSeatfromID(ID, flight_registry); });
+
+        vector<PlaneEntry> plane_entries(planes.size());
+        vector<FlightEntry> flight_entries(flights.size());
+        vector<ClientEntry> client_entries(clients.size());
+        vector<RecordEntry> record_entries(records.size());
+        vector<uint16_t> dimensions;
+        vector<double> prices;
+        vector<uint64_t> seat_words;
+        for (int i = 0; i < planes.size() && sources[AIRPLANES_CSV].valid; i++)
+            sources[AIRPLANES_CSV].valid = planes[i].toSnapshot(plane_entries[i], dimensions);
+        for (int i = 0; i < flights.size() && sources[FLIGHTS_CSV].valid; i++)
+            sources[FLIGHTS_CSV].valid = flights[i].toSnapshot(flight_entries[i], prices, seat_words);
+        for (int i = 0; i < clients.size() && sources[CLIENTS_CSV].valid; i++)
+            sources[CLIENTS_CSV].valid = clients[i].toSnapshot(client_entries[i]);
+        for (int i = 0; i < records.size() && sources[RECORDS_CSV].valid; i++)
+            sources[RECORDS_CSV].valid = records[i].toSnapshot(record_entries[i]);
+        // Skipped flights and records would get lost, so such files keep being read as text
+        if (LoadStats::unresolved_planes > 0)
+            sources[FLIGHTS_CSV].valid = 0;
+        if (LoadStats::unresolved_clients + LoadStats::unresolved_inventory > 0)
+            sources[RECORDS_CSV].valid = 0;
+
+        // Flights are linked to planes by ID, so they can only come from the snapshot if the planes do too
+        if (!sources[AIRPLANES_CSV].valid)
+            sources[FLIGHTS_CSV].valid = 0;
+        if (!sources[AIRPLANES_CSV].valid)
+            plane_entries.clear();
+        if (!sources[FLIGHTS_CSV].valid)
+            flight_entries.clear();
+        if (!sources[CLIENTS_CSV].valid)
+            client_entries.clear();
+        if (!sources[RECORDS_CSV].valid)
+            record_entries.clear();
+        for (int i = 0; i < NUM_SOURCES; i++) {
+            if (!sources[i].valid)
+                cerr << source_paths[i] << " does not fit the snapshot and will still be read as text..." << endl;
+        }
+        return Snapshot::write(plane_entries, flight_entries, client_entries, record_entries, dimensions, prices, seat_words, sources);
+    }
+}
+
+#endif
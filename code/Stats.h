@@ -0,0 +1,162 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <cstdint>
+#include <cstdlib>
+#include <atomic>
+#include <chrono>
+#ifndef STATS_H
+#define STATS_H
+
+using namespace std;
+
+/// @brief Counts and times of the hot operations of a session.
+/// Timers are scoped (STATS_TIMER measures until the end of the block) and every aggregate is atomic, so the
+/// loader threads can record into them too. Building with -DNO_STATS compiles all timers and counters out.
+namespace Stats {
+
+    /// @brief Timed operations. ENCRYPT and DECRYPT time whole batches of records, never a single field
+    enum Operation {
+        LOAD_PLANES,
+        LOAD_FLIGHTS,
+        LOAD_CLIENTS,
+        LOAD_RECORDS,
+        LOAD_FILES,
+        ENCRYPT,
+        DECRYPT,
+        CHECKPOINT,
+        JOURNAL_SEAT,
+        DISPLAY_FLIGHTS,
+        BOOK_FLIGHT_SEAT,
+        SEARCH_CONNECTIONS,
+        NUM_OPERATIONS
+    };
+
+    /// @brief Names of the timed operations
+    const char* operation_names[NUM_OPERATIONS] = {
+        "Airplane::loadAll", "Flight::loadAll", "Client::loadAll", "Record::loadAll", "ParallelLoader::loadFiles",
+        "RecordFile::encode", "RecordFile::decode", "Flight::checkpoint", "Flight::saveSeat", "DisplayFlights", "BookFlightSeat",
+        "ConnectionScan::search"
+    };
+
+    /// @brief Plain counters, the byte counters count encrypted text
+    enum Counter {
+        BYTES_ENCRYPTED,
+        BYTES_DECRYPTED,
+        SEATS_BOOKED,
+        BOOKINGS_REJECTED,
+        NUM_COUNTERS
+    };
+
+    /// @brief Names of the plain counters
+    const char* counter_names[NUM_COUNTERS] = {"bytes encrypted", "bytes decrypted", "seats booked", "bookings rejected"};
+
+    /// @brief Aggregate of one timed operation
+    struct Aggregate {
+        atomic<uint64_t> count{0};
+        atomic<uint64_t> total_ns{0};
+        atomic<uint64_t> max_ns{0};
+    };
+
+    Aggregate operations[NUM_OPERATIONS];
+    atomic<uint64_t> counters[NUM_COUNTERS];
+
+    /// @brief Adds one run of an operation
+    /// @param operation Operation that ran
+    /// @param ns Time it took in nanoseconds
+    inline void record(Operation operation, uint64_t ns) {
+        Aggregate &aggregate = operations[operation];
+        aggregate.count.fetch_add(1, memory_order_relaxed);
+        aggregate.total_ns.fetch_add(ns, memory_order_relaxed);
+        uint64_t max = aggregate.max_ns.load(memory_order_relaxed);
+        while (ns > max && !aggregate.max_ns.compare_exchange_weak(max, ns, memory_order_relaxed));
+    }
+
+    /// @brief Adds to a plain counter
+    inline void add(Counter counter, uint64_t amount) {
+        counters[counter].fetch_add(amount, memory_order_relaxed);
+    }
+
+    /// @brief Times the enclosing scope
+    class ScopedTimer {
+        private:
+        Operation operation;
+        chrono::steady_clock::time_point start;
+
+        public:
+        explicit ScopedTimer(Operation operation) : operation(operation), start(chrono::steady_clock::now()) {}
+
+        ScopedTimer(const ScopedTimer&) = delete;
+        ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+        ~ScopedTimer() {
+            record(operation, chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count());
+        }
+    };
+
+    /// @brief Checks if the statistics are compiled in
+    constexpr bool enabled() {
+#ifdef NO_STATS
+        return false;
+#else
+        return true;
+#endif
+    }
+
+    /// @brief Prints the statistics as a table
+    /// @param out Stream to print to
+    void print(ostream &out) {
+        if (!enabled()) {
+            out << "Statistics are compiled out (built with NO_STATS)" << endl;
+            return;
+        }
+        out << left << setw(28) << "Operation" << right << setw(12) << "Count" << setw(14) << "Total (ms)" << setw(12) << "Mean (us)" << setw(12) << "Max (us)" << endl;
+        out << fixed << setprecision(3);
+        for (int i = 0; i < NUM_OPERATIONS; i++) {
+            uint64_t count = operations[i].count, total = operations[i].total_ns;
+            out << left << setw(28) << operation_names[i] << right << setw(12) << count << setw(14) << total / 1e6
+                << setw(12) << (count > 0 ? total / 1e3 / count : 0) << setw(12) << operations[i].max_ns / 1e3 << endl;
+        }
+        for (int i = 0; i < NUM_COUNTERS; i++)
+            out << left << setw(28) << counter_names[i] << right << setw(12) << counters[i] << endl;
+        out << defaultfloat << setprecision(6);
+    }
+
+    /// @brief Prints the statistics as JSON
+    /// @param out Stream to print to
+    void printJSON(ostream &out) {
+        out << "{\"enabled\": " << (enabled() ? "true" : "false") << ", \"operations\": {";
+        for (int i = 0; i < NUM_OPERATIONS; i++) {
+            out << (i > 0 ? ", " : "") << "\"" << operation_names[i] << "\": {\"count\": " << operations[i].count
+                << ", \"total_ns\": " << operations[i].total_ns << ", \"max_ns\": " << operations[i].max_ns << "}";
+        }
+        out << "}, \"counters\": {";
+        for (int i = 0; i < NUM_COUNTERS; i++)
+            out << (i > 0 ? ", " : "") << "\"" << counter_names[i] << "\": " << counters[i];
+        out << "}}" << endl;
+    }
+
+    /// @brief Prints the statistics to stderr at exit if the STATS_DUMP environment variable is "text" or "json"
+    void dumpAtExit() {
+        const char* format = getenv("STATS_DUMP");
+        if (format == nullptr)
+            return;
+        if (string(format) == "json")
+            printJSON(cerr);
+        else if (string(format) == "text")
+            print(cerr);
+    }
+}
+
+// Instrumentation points, empty when built with NO_STATS
+#define STATS_CONCAT_(a, b) a##b
+#define STATS_CONCAT(a, b) STATS_CONCAT_(a, b)
+#ifdef NO_STATS
+#define STATS_TIMER(operation)
+#define STATS_ADD(counter, amount)
+#else
+#define STATS_TIMER(operation) Stats::ScopedTimer STATS_CONCAT(stats_timer_, __LINE__)(Stats::operation)
+#define STATS_ADD(counter, amount) Stats::add(Stats::counter, amount)
+#endif
+
+#endif
@@ -0,0 +1,110 @@
+#include <string>
+#include <string_view>
+#include <charconv>
+#include <cstdint>
+#ifndef TOKENIZER_H
+#define TOKENIZER_H
+
+using namespace std;
+
+/// @brief Splits a buffer into tokens without copying. Tokens are string_view slices of the buffer, so the buffer must outlive them.
+/// Used both to split the plain text of a storage file into records and a record into its fields.
+class Tokenizer {
+    private:
+    /// @brief Part of the buffer that has not been read yet
+    string_view rest;
+    /// @brief Character between two tokens
+    char separator;
+    /// @brief False once the last token has been read
+    bool remaining;
+
+    /// @brief Parses a whole token as a number
+    template <class T>
+    static bool parseNumber(string_view token, T &value) {
+        const char* first = token.data();
+        const char* last = token.data() + token.length();
+        if (first != last && *first == '+')
+            first++;
+        from_chars_result result = from_chars(first, last, value);
+        return result.ec == errc() && result.ptr == last && first != last;
+    }
+
+    public:
+    /// @brief Creates a tokenizer over a buffer
+    /// @param buffer Text to split
+    /// @param separator Character between two tokens
+    Tokenizer(string_view buffer, char separator) : rest(buffer), separator(separator), remaining(!buffer.empty()) {}
+
+    /// @brief Reads the next token
+    /// @param token Set to the token
+    /// @return False if there are no tokens left
+    bool next(string_view &token) {
+        if (!remaining)
+            return false;
+        size_t end = rest.find(separator);
+        if (end == string_view::npos) {
+            token = rest;
+            rest = string_view();
+            remaining = false;
+        }
+        else {
+            token = rest.substr(0, end);
+            rest.remove_prefix(end + 1);
+        }
+        return true;
+    }
+
+    /// @brief Reads the next token as an integer
+    /// @param value Set to the number
+    /// @return False if there are no tokens left or the token is not an integer
+    bool nextInt(int &value) {
+        string_view token;
+        return next(token) && parseNumber(token, value);
+    }
+
+    /// @brief Reads the next token as a long integer
+    /// @param value Set to the number
+    /// @return False if there are no tokens left or the token is not an integer
+    bool nextLong(long &value) {
+        string_view token;
+        return next(token) && parseNumber(token, value);
+    }
+
+    /// @brief Reads the next token as a floating point number
+    /// @param value Set to the number
+    /// @return False if there are no tokens left or the token is not a number
+    bool nextDouble(double &value) {
+        string_view token;
+        return next(token) && parseNumber(token, value);
+    }
+
+    /// @brief Reads the next token as a string
+    /// @param value Set to a copy of the token
+    /// @return False if there are no tokens left
+    bool nextString(string &value) {
+        string_view token;
+        if (!next(token))
+            return false;
+        value.assign(token.data(), token.length());
+        return true;
+    }
+
+    /// @brief Reads a number from a fixed part of a token, e.g. the month of a date
+    /// @param token Token to read from
+    /// @param position Position of the first digit
+    /// @param length Number of digits
+    /// @param value Set to the number
+    /// @return False if that part of the token is not a number
+    static bool parseInt(string_view token, size_t position, size_t length, int &value) {
+        if (position + length > token.length())
+            return false;
+        return parseNumber(token.substr(position, length), value);
+    }
+
+    /// @brief Checks if all tokens have been read
+    bool empty() const {
+        return !remaining;
+    }
+};
+
+#endif
@@ -0,0 +1,167 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <cstdlib>
+#include <unistd.h>
+#ifndef TRACE_H
+#define TRACE_H
+
+using namespace std;
+
+/// @brief Timeline of nested spans in the Chrome trace event format, for chrome://tracing or Perfetto.
+/// Tracing is off unless the TRACE_FILE environment variable names the file to write at exit.
+/// Every thread records into its own buffer, so recording takes no lock; only a thread's first span registers its buffer.
+namespace Trace {
+
+    /// @brief One finished span
+    struct Event {
+        const char* name;
+        /// @brief Extra text shown with the span, e.g. the file being loaded
+        string detail;
+        /// @brief Start in microseconds since tracing started
+        double start;
+        /// @brief Length in microseconds
+        double duration;
+    };
+
+    /// @brief Spans of one thread
+    struct Buffer {
+        int thread_ID;
+        /// @brief True for the thread that started tracing
+        bool main;
+        vector<Event> events;
+    };
+
+    /// @brief Buffers of all threads that recorded spans. They outlive their threads so spans of finished loader threads are kept
+    struct Registry {
+        mutex lock;
+        vector<unique_ptr<Buffer>> buffers;
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        thread::id main_thread = this_thread::get_id();
+        string path;
+    };
+
+    /// @brief Writes the trace file, registered with atexit when tracing is on
+    void writeAtExit();
+
+    /// @brief Gives the registry, or nullptr if tracing is off
+    inline Registry* registry() {
+        static Registry* active = []() -> Registry* {
+            const char* path = getenv("TRACE_FILE");
+            if (path == nullptr || *path == '\0')
+                return nullptr;
+            static Registry instance;
+            instance.path = path;
+            atexit(writeAtExit);
+            return &instance;
+        }();
+        return active;
+    }
+
+    /// @brief Checks if spans are recorded
+    inline bool enabled() {
+        return registry() != nullptr;
+    }
+
+    /// @brief Gives the buffer of the calling thread, registering it on first use
+    inline Buffer* threadBuffer() {
+        thread_local Buffer* buffer = nullptr;
+        if (buffer == nullptr) {
+            Registry* active = registry();
+            lock_guard<mutex> guard(active->lock);
+            active->buffers.push_back(make_unique<Buffer>());
+            buffer = active->buffers.back().get();
+            buffer->thread_ID = active->buffers.size();
+            buffer->main = this_thread::get_id() == active->main_thread;
+        }
+        return buffer;
+    }
+
+    /// @brief Microseconds since tracing started
+    inline double now() {
+        return chrono::duration<double, micro>(chrono::steady_clock::now() - registry()->start).count();
+    }
+
+    /// @brief Records the enclosing scope as a span
+    class Span {
+        private:
+        const char* name;
+        const char* detail;
+        double start;
+
+        public:
+        /// @param name Name of the span, must be a string literal
+        /// @param detail Extra text shown with the span, copied only when tracing is on
+        explicit Span(const char* name, const char* detail = nullptr) : name(name), detail(detail), start(-1) {
+            if (enabled())
+                start = now();
+        }
+
+        Span(const Span&) = delete;
+        Span& operator=(const Span&) = delete;
+
+        ~Span() {
+            if (start < 0)
+                return;
+            double end = now();
+            threadBuffer()->events.push_back({name, detail != nullptr ? detail : "", start, end - start});
+        }
+    };
+
+    /// @brief Escapes a string for JSON
+    inline string quote(const string &str) {
+        string quoted = "\"";
+        for (char c : str) {
+            if (c == '"' || c == '\\')
+                quoted += '\\';
+            if ((unsigned char) c >= 0x20)
+                quoted += c;
+        }
+        return quoted + '"';
+    }
+
+    /// @brief Writes all recorded spans as Chrome trace JSON
+    /// @param out Stream to write to
+    void writeJSON(ostream &out) {
+        Registry* active = registry();
+        out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [" << endl;
+        bool first = true;
+        int pid = getpid();
+        lock_guard<mutex> guard(active->lock);
+        for (const unique_ptr<Buffer> &buffer : active->buffers) {
+            out << (first ? "" : ",\n") << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": " << pid << ", \"tid\": " << buffer->thread_ID
+                << ", \"args\": {\"name\": \"" << (buffer->main ? "main" : "worker " + to_string(buffer->thread_ID)) << "\"}}";
+            first = false;
+            for (const Event &event : buffer->events) {
+                out << ",\n{\"name\": " << quote(event.name) << ", \"ph\": \"X\", \"pid\": " << pid << ", \"tid\": " << buffer->thread_ID
+                    << ", \"ts\": " << fixed << event.start << ", \"dur\": " << event.duration;
+                if (!event.detail.empty())
+                    out << ", \"args\": {\"detail\": " << quote(event.detail) << "}";
+                out << "}";
+            }
+        }
+        out << endl << "]}" << endl;
+    }
+
+    void writeAtExit() {
+        Registry* active = registry();
+        ofstream writer(active->path);
+        if (writer.fail()) {
+            cerr << "Error writing trace to " << active->path << "..." << endl;
+            return;
+        }
+        writeJSON(writer);
+    }
+}
+
+// Instrumentation points
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SPAN(...) Trace::Span TRACE_CONCAT(trace_span_, __LINE__)(__VA_ARGS__)
+
+#endif
@@ -1,35 +1,25 @@
 #include <iostream>
 #include <fstream>
-#include "Flight.h"
+#include "SnapshotConverter.h"
+#include "BookingClient.h"
 
 /// @brief Interface for handling all Administrator interactions
 namespace AdminInterface {
 
-    // Vectors storing all loaded objects
-    vector<Airplane> planes;
-    vector<Client> clients;
-    vector<Flight> flights;
-    vector<Record> records;
+    /// @brief Connection to the booking server, or the in-process service when no server is running
+    unique_ptr<BookingClient> connection;
 
-    /// @brief Loading of data from files is only done when loaded is false
-    bool loaded = false;
+    /// @brief Planes as last listed, in the order their index is used to create flights
+    vector<Airplane> planes;
 
     /// @brief All save paths to the files.
-    vector<string> paths = {"SaveData/Airplanes.csv", "SaveData/Clients.csv", "SaveData/Flights.csv", "SaveData/Records.csv"};
+    vector<string> paths = {"SaveData/Airplanes.csv", "SaveData/Clients.csv", "SaveData/Flights.csv", "SaveData/Records.csv", "SaveData/Bookings.journal"};
 
 
     /// @brief Clear all data in the program and in the files
     void clearAll() {
-        for (int i = 0; i < paths.size(); i++) {
-            ofstream clearer;
-            clearer.open(paths[i], std::ofstream::out | std::ofstream::trunc);
-            clearer.close();
-        }
+        connection->reset();
         planes.clear();
-        clients.clear();
-        flights.clear();
-        records.clear();
-        loaded = false;
     }
     
     // Forward declaration \
@@ -99,11 +89,7 @@ namespace AdminInterface {
 
         /// @brief Perform necessary start up processes before entering FLights interface
         void StartUp() {
-            if (!loaded) {
-                planes = Airplane::loadAll();
-                flights = Flight::loadAll(planes);
-                loaded = true;
-            }
+
         }
 
         /// @brief Create a plane object using given parameters
@@ -111,19 +97,22 @@ namespace AdminInterface {
         /// @param num_categories 
         /// @param dimensions 
         void CreatePlane(string model, int num_categories, vector<vector<int>> dimensions) {
-            planes.push_back(Airplane(model, num_categories, dimensions));
+            dimensions.resize(num_categories, vector<int>(2, 0));
+            if (!connection->createPlane(model, dimensions))
+                cerr << "Error creating plane..." << endl;
         }
 
 
         /// @brief Create flight object using given information
-        /// @param plane 
+        /// @param plane_index Position of the plane in planes
         /// @param t_depart 
         /// @param t_arrive 
         /// @param origin 
         /// @param destination 
         /// @param category_price 
-        void CreateFlight(Airplane* plane, tm t_depart, tm t_arrive, Airport origin, Airport destination, vector<double> category_price) {
-            flights.push_back(Flight(plane, t_depart, t_arrive, origin, destination, category_price));
+        void CreateFlight(int plane_index, DateTime t_depart, DateTime t_arrive, Airport origin, Airport destination, vector<double> category_price) {
+            if (!connection->createFlight(plane_index, t_depart, t_arrive, origin, destination, category_price))
+                cerr << "Error creating flight..." << endl;
         }
 
         /// @brief Recursive menu display and user input reader for Flight Booking interface
@@ -140,6 +129,7 @@ namespace AdminInterface {
                 cout << "1 - Create Flights" << endl;
                 cout << "2 - View Flights" << endl;
                 cout << "3 - Return" << endl;
+                cout << "4 - Find Available Flights" << endl;
                 cin >> selection;
                 return Menu(selection + 1);
             }
@@ -169,6 +159,7 @@ namespace AdminInterface {
                 cout << "~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~" << endl;
                 cout << "Plane selection: " << endl;
                 cout << "Enter the associated number for your choice and -1 to create plane..." << endl;
+                planes = connection->listPlanes();
                 for (int i = 0; i < planes.size(); i++) {
                     cout << i << " - ";
                     planes[i].print_details();
@@ -178,33 +169,57 @@ namespace AdminInterface {
                 if (plane_index == -1) {
                     return Menu(1);
                 }
+                if (plane_index < 0 || plane_index >= planes.size()) {
+                    cout << "No such plane..." << endl;
+                    cout << "Enter any number to return..." << endl;
+                    cin >> selection;
+                    return Menu(0);
+                }
                 system("clear");
                 cout << "------------------------------------------------------------------------" << endl;
                 cout << "Create Flight" << endl;
                 cout << "~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~" << endl;
                 vector<double> category_price;
                 string t_depart, date_depart, t_arrive, date_arrive, date, origin, destination;
+                DateTime depart_time, arrive_time;
                 cout << "Departure date and time GMT (hh:mm DD/MM/YYYY): ";
                 cin >> t_depart >> date_depart;
+                while (cin && !date_time_to_DateTime(date_depart, t_depart, depart_time)) {
+                    cout << "Invalid date..." << endl << "Departure date and time GMT (hh:mm DD/MM/YYYY): ";
+                    cin >> t_depart >> date_depart;
+                }
                 cout << "Arrival date and time GMT (hh:mm DD/MM/YYYY): ";
                 cin >> t_arrive >> date_arrive;
+                while (cin && !date_time_to_DateTime(date_arrive, t_arrive, arrive_time)) {
+                    cout << "Invalid date..." << endl << "Arrival date and time GMT (hh:mm DD/MM/YYYY): ";
+                    cin >> t_arrive >> date_arrive;
+                }
                 cout << "From (Airport Code): ";
                 cin >> origin;
                 cout << "To (Airport Code): ";
                 cin >> destination;
+                Airport from, to;
+                if (!string_to_Airport(origin, from) || !string_to_Airport(destination, to)) {
+                    cout << "Unknown airport code..." << endl;
+                    cout << "Enter any number to return..." << endl;
+                    cin >> selection;
+                    return Menu(0);
+                }
                 for (int i = 0; i < planes[plane_index].getNumCategories(); i++) {
                     double price;
                     cout << "Price (in $) for category " << i << ": ";
                     cin >> price;
                     category_price.push_back(price);
                 }
-                CreateFlight(&planes[plane_index], date_time_to_tm(date_depart, t_depart), date_time_to_tm(date_arrive, t_arrive), string_to_Airport(origin), string_to_Airport(destination), category_price);
+                CreateFlight(plane_index, depart_time, arrive_time, from, to, category_price);
                 return Menu(0);
             }
             else if (menu_num == 3) {
                 cout << "Created Flights" << endl;
+                vector<Protocol::FlightSummary> flights = connection->listFlights();
                 for (int i = 0; i < flights.size(); i++) {
                     flights[i].print_info();
+                    flights[i].print_availability();
                 }
                 cout << "Enter any number to return..." << endl;
                 cin >> selection;
@@ -213,6 +228,42 @@ namespace AdminInterface {
             else if (menu_num == 4) {
                 Home::Menu(0);
             }
+            else if (menu_num == 5) {
+                cout << "Find Available Flights" << endl;
+                cout << "~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~" << endl;
+                string date, origin;
+                int days, category, min_free, min_together;
+                cout << "First departure date (DD/MM/YYYY): ";
+                cin >> date;
+                cout << "Number of days: ";
+                cin >> days;
+                cout << "From (Airport Code, - for any): ";
+                cin >> origin;
+                cout << "Category: ";
+                cin >> category;
+                cout << "Free seats needed (0 for any): ";
+                cin >> min_free;
+                cout << "Seats needed together in one row (0 for any): ";
+                cin >> min_together;
+                DateTime first_day;
+                Airport from;
+                bool any_origin = origin == "-";
+                if (!DateTime::parseDate(date, first_day) || (!any_origin && !string_to_Airport(origin, from)) || days < 1 || category < 0) {
+                    cout << "Invalid search..." << endl;
+                    cout << "Enter any number to return..." << endl;
+                    cin >> selection;
+                    return Menu(0);
+                }
+                vector<Protocol::FlightSummary> flights = connection->findAvailable(any_origin ? nullptr : &from, first_day, days, category, max(min_free, 0), max(min_together, 0));
+                cout << flights.size() << " flights found" << endl;
+                for (int i = 0; i < flights.size(); i++) {
+                    flights[i].print_info();
+                    flights[i].print_availability();
+                }
+                cout << "Enter any number to return..." << endl;
+                cin >> selection;
+                return Menu(0);
+            }
             return -1;
         }
 
@@ -220,7 +271,8 @@ namespace AdminInterface {
 
     /// @brief Perform necessary start up processes before entering Home interface
     void Home::StartUp() {
-        
+        // Without a server the files are loaded in this process by the first request
+        connection = make_unique<BookingClient>();
     }
 
     /// @brief Portal function between different interface modules
@@ -258,7 +310,10 @@ namespace AdminInterface {
             cout << "Enter the associated number for your choice:" << endl;
             cout << "0 - Create Inventory" << endl;
             cout << "1 - Reset All Files" << endl;
-            cout << "2 - Exit" << endl;
+            cout << "2 - Build Snapshot" << endl;
+            cout << "3 - Storage Format" << endl;
+            cout << "4 - Statistics" << endl;
+            cout << "5 - Exit" << endl;
             cin >> selection;
             return Menu(selection + 1);
         }
@@ -275,6 +330,45 @@ namespace AdminInterface {
             clearAll();
             return Menu(0);
         }
+        else if (menu_num == 3) {
+            if (SnapshotConverter::convert())
+                cout << "Snapshot saved to " << Snapshot::getSavePath() << endl;
+            cout << "Enter any number to return..." << endl;
+            cin >> selection;
+            return Menu(0);
+        }
+        else if (menu_num == 4) {
+            cout << "Storage Format" << endl;
+            cout << "Enter the associated number of the file to convert and -1 to return:" << endl;
+            for (int i = 0; i < NUM_SOURCES; i++)
+                cout << i << " - " << paths[i] << " (" << RecordFile::formatName(RecordFile::detect(paths[i])) << ")" << endl;
+            cin >> selection;
+            if (selection < 0 || selection >= NUM_SOURCES)
+                return Menu(0);
+            int file = selection;
+            cout << "New format:" << endl;
+            cout << "0 - CSV (encrypted per character)" << endl;
+            cout << "1 - Block (encrypted per record)" << endl;
+            cin >> selection;
+            if (selection == 0 || selection == 1) {
+                if (RecordFile::migrate(paths[file], selection == 1 ? RecordFile::BLOCK : RecordFile::CSV))
+                    cout << paths[file] << " is now stored as " << RecordFile::formatName(RecordFile::detect(paths[file])) << endl;
+            }
+            cout << "Enter any number to return..." << endl;
+            cin >> selection;
+            return Menu(0);
+        }
+        else if (menu_num == 5) {
+            cout << "Statistics" << endl;
+            cout << "Enter the associated number for your choice:" << endl;
+            cout << "0 - Text" << endl;
+            cout << "1 - JSON" << endl;
+            cin >> selection;
+            cout << connection->stats(selection == 1);
+            cout << "Enter any number to return..." << endl;
+            cin >> selection;
+            return Menu(0);
+        }
         return -1;
     }
 }
@@ -283,11 +377,15 @@ using namespace AdminInterface;
 using namespace std;
 
 int main() {
+    // Tracing starts here when TRACE_FILE is set, the trace is written at exit
+    Trace::enabled();
 
     // Starting the interface
+    Home::StartUp();
     Home::Menu(0);
 
     // Only reached when the user chooses to exit
+    Stats::dumpAtExit();
     cout << "Thanks for using our services..." << endl;
     return 0;
 }
\ No newline at end of file
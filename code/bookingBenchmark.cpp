@@ -0,0 +1,205 @@
+#include <iostream>
+#include <iomanip>
+#include <filesystem>
+#include <unistd.h>
+#include "ParallelLoader.h"
+#include "Booking.h"
+#include "Benchmark.h"
+
+using namespace std;
+
+/// @brief Measures end to end booking latency without the menus.
+/// Copies a data set (e.g. one written by dataGenerator) to a temporary directory, loads it like the client interface does
+/// and runs searches and bookings through the same booking path as ClientInterface::Flights::BookFlightSeat,
+/// then itinerary searches with connections between random airports of the schedule, and week long availability searches from one
+/// airport through the availability index and, for comparison, by looking at every flight. Last come group bookings of two to six seats.
+/// Usage: ./bookingBenchmark [bookings=10000] [SaveData directory=SaveData] [seed=1]
+namespace BookingBenchmark {
+
+    /// @brief xorshift64* generator, enough to pick flights, seats and clients
+    uint64_t random_state = 1;
+
+    uint64_t random(uint64_t bound) {
+        random_state ^= random_state >> 12;
+        random_state ^= random_state << 25;
+        random_state ^= random_state >> 27;
+        return (uint64_t) (((unsigned __int128) (random_state * 0x2545F4914F6CDD1DULL) * bound) >> 64);
+    }
+
+    /// @brief Latencies of every phase, in nanoseconds
+    vector<double> search_times, reserve_times, persist_times, total_times, connection_times, available_times, scan_times, group_times;
+
+    /// @brief Searches the route and day of a flight like a client would and picks a free seat on it
+    /// @param flights Loaded flights
+    /// @param target Flight the client is looking for
+    /// @param category Set to the category of the free seat
+    /// @param row Set to the row of the free seat
+    /// @param col Set to the column of the free seat
+    /// @return False if the flight is not found or is full
+    bool search(vector<Flight> &flights, const Flight &target, int &category, int &row, int &col) {
+        vector<Flight*> found = Flight::findFlights(flights, target.getOrigin(), target.getDestination(), target.getT_Depart());
+        Flight* flight = nullptr;
+        for (int i = 0; i < found.size() && flight == nullptr; i++) {
+            if (found[i]->getID() == target.getID())
+                flight = found[i];
+        }
+        // Full flights are known from the free seat counters without scanning their seats
+        if (flight == nullptr || !flight->hasFreeSeats(1))
+            return false;
+        // Seats are scanned from a random position, like clients picking different seats
+        SeatMap* seat_map = flight->getSeatMap();
+        int capacity = seat_map->getTotalCapacity();
+        int start = random(capacity);
+        for (int n = 0; n < capacity; n++) {
+            seat_map->seatAt((start + n) % capacity, category, row, col);
+            if (!flight->isSeatReserved(category, row, col))
+                return true;
+        }
+        return false;
+    }
+
+    /// @brief Prints the latency percentiles of one phase
+    void report(const string &phase, vector<double> &times) {
+        sort(times.begin(), times.end());
+        double mean = 0;
+        for (int i = 0; i < times.size(); i++)
+            mean += times[i] / times.size();
+        Benchmark::Result result = {phase, 1, times, mean};
+        cout << left << setw(12) << phase << right << fixed << setprecision(1)
+            << setw(12) << result.percentile(50) / 1000 << setw(12) << result.percentile(99) / 1000 << setw(12) << result.percentile(99.9) / 1000
+            << setw(12) << result.samples.back() / 1000 << setw(12) << mean / 1000 << endl;
+    }
+}
+
+using namespace BookingBenchmark;
+
+int main(int argc, char* argv[]) {
+    int bookings = argc > 1 ? atoi(argv[1]) : 10000;
+    string source = filesystem::absolute(argc > 2 ? argv[2] : "SaveData").string();
+    random_state = argc > 3 ? max(1L, atol(argv[3])) : 1;
+
+    // Bookings are written to a copy of the data set so the original stays the same between runs
+    char directory[] = "/tmp/bookingBenchmarkXXXXXX";
+    error_code error;
+    bool created = mkdtemp(directory) != nullptr;
+    if (created)
+        filesystem::copy(source, string(directory) + "/SaveData", filesystem::copy_options::recursive, error);
+    if (!created || error || chdir(directory) != 0) {
+        cerr << "Error copying " << source << " to a benchmark directory..." << endl;
+        return 1;
+    }
+
+    vector<Airplane> planes;
+    vector<Flight> flights;
+    vector<Client> clients;
+    vector<Record> records;
+    auto start = chrono::steady_clock::now();
+    ParallelLoader::loadFiles(&planes, &flights, &clients, &records);
+    cout << "Loaded " << flights.size() << " flights, " << clients.size() << " clients and " << records.size() << " records in "
+        << fixed << setprecision(1) << Booking::nanoseconds(start) / 1e6 << " ms" << endl;
+    if (flights.empty() || clients.empty()) {
+        cerr << "Error: the data set needs flights and clients, see dataGenerator..." << endl;
+        filesystem::remove_all(directory);
+        return 1;
+    }
+    records.reserve(records.size() + bookings);
+
+    int booked = 0, full = 0;
+    start = chrono::steady_clock::now();
+    while (booked < bookings && full < 100 * (bookings + 1)) {
+        auto begin = chrono::steady_clock::now();
+        int category, row, col;
+        Flight &target = flights[random(flights.size())];
+        if (!search(flights, target, category, row, col)) {
+            full++;
+            continue;
+        }
+        double search_time = Booking::nanoseconds(begin);
+        Booking::PhaseTimes times;
+        if (Booking::bookFlightSeat(flights, records, target, &clients[random(clients.size())], category, row, col, &times) != Booking::BOOKED) {
+            cerr << "Error booking a free seat..." << endl;
+            break;
+        }
+        search_times.push_back(search_time + times.search);
+        reserve_times.push_back(times.reserve);
+        persist_times.push_back(times.persist);
+        total_times.push_back(Booking::nanoseconds(begin));
+        booked++;
+    }
+    double seconds = Booking::nanoseconds(start) / 1e9;
+
+    // Itinerary searches start where one flight departs and end where another one lands, so most pairs need connections
+    int searches = min(bookings, 1000), connected = 0;
+    for (int i = 0; i < searches; i++) {
+        const Flight &first = flights[random(flights.size())];
+        Airport destination = flights[random(flights.size())].getDestination();
+        auto begin = chrono::steady_clock::now();
+        vector<vector<Flight*>> found = Flight::findItineraries(flights, first.getOrigin(), destination, first.getT_Depart(), ConnectionScan::default_min_connection, ConnectionScan::default_max_legs);
+        connection_times.push_back(Booking::nanoseconds(begin));
+        connected += !found.empty();
+    }
+
+    // Availability searches ask for a week of departures from the airport of a random flight
+    int mismatches = 0;
+    for (int i = 0; i < searches; i++) {
+        const Flight &target = flights[random(flights.size())];
+        Airport origin = target.getOrigin();
+        DateTime first_day = target.getT_Depart().getDate();
+        int category = random(target.getSeatMap()->getNumCategories());
+        int min_free = 1 + random(8), min_together = random(5);
+        auto begin = chrono::steady_clock::now();
+        vector<Flight*> found = Flight::findAvailable(flights, &origin, first_day, 7, category, min_free, min_together);
+        available_times.push_back(Booking::nanoseconds(begin));
+        begin = chrono::steady_clock::now();
+        size_t scanned = 0;
+        for (int f = 0; f < flights.size(); f++) {
+            const Flight &flight = flights[f];
+            int day = flight.getT_Depart().getDayNumber() - first_day.getDayNumber();
+            if (flight.getOrigin() == origin && day >= 0 && day < 7 && flight.hasFreeSeats(min_free, category)
+                && flight.getSeatMap()->longestFreeBlock(category) >= min_together)
+                scanned++;
+        }
+        scan_times.push_back(Booking::nanoseconds(begin));
+        mismatches += scanned != found.size();
+    }
+
+    // Groups are seated together by the booking path, with one record write and one journal append per group
+    int groups = min(bookings, 1000), grouped = 0;
+    for (int i = 0; i < groups; i++) {
+        Flight &target = flights[random(flights.size())];
+        int category = random(target.getSeatMap()->getNumCategories());
+        vector<pair<int, int>> seats;
+        auto begin = chrono::steady_clock::now();
+        Booking::Result result = Booking::bookGroup(flights, records, target, &clients[random(clients.size())], category, 2 + random(5),
+            (Airplane::SeatPreference) random(3), seats);
+        group_times.push_back(Booking::nanoseconds(begin));
+        grouped += result == Booking::BOOKED;
+    }
+
+    cout << booked << " bookings in " << setprecision(2) << seconds << " s (" << setprecision(0) << booked / seconds << " bookings/s)";
+    if (full > 0)
+        cout << ", " << full << " picks landed on full flights";
+    cout << endl << endl;
+    cout << left << setw(12) << "phase (us)" << right << setw(12) << "p50" << setw(12) << "p99" << setw(12) << "p999" << setw(12) << "max" << setw(12) << "mean" << endl;
+    if (booked > 0) {
+        report("search", search_times);
+        report("reserve", reserve_times);
+        report("persist", persist_times);
+        report("total", total_times);
+    }
+    if (searches > 0) {
+        report("itinerary", connection_times);
+        report("available", available_times);
+        report("avail scan", scan_times);
+        cout << endl << connected << " of " << searches << " itinerary searches found a connection" << endl;
+        if (mismatches > 0)
+            cout << "Error: " << mismatches << " availability searches differ from the scan..." << endl;
+    }
+    if (groups > 0) {
+        report("group", group_times);
+        cout << grouped << " of " << groups << " groups were seated" << endl;
+    }
+
+    filesystem::remove_all(directory);
+    return 0;
+}
@@ -0,0 +1,319 @@
+#include <iostream>
+#include <memory>
+#include <unordered_map>
+#include <csignal>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <cstring>
+#include <unistd.h>
+#include "ClientSession.h"
+
+using namespace std;
+
+/// @brief Long running booking server. Loads SaveData once and serves the client and admin interfaces over a Unix domain socket,
+/// so their start up is only a connect and bookings from every terminal go through one in-memory model.
+/// It also hosts interactive client sessions on a second socket (e.g. nc -U SaveData/Session.sock). All connections are multiplexed
+/// by one epoll loop: a session is a ClientSession state machine plus its buffers, so idle sessions cost a few hundred bytes and no thread.
+/// Run it from the directory holding SaveData, the interfaces started from there connect to it on their own.
+/// Usage: ./bookingServer   (stop with Ctrl+C or SIGTERM)
+namespace BookingServer {
+
+    BookingService service;
+
+    /// @brief Set by SIGINT and SIGTERM
+    volatile sig_atomic_t stopping = 0;
+
+    void stop(int) {
+        stopping = 1;
+    }
+
+    /// @brief What is on the other end of a socket
+    enum Kind { PROTOCOL_LISTENER, SESSION_LISTENER, PROTOCOL, SESSION };
+
+    /// @brief Requests are small, a larger frame means a broken or hostile peer
+    const uint32_t max_request = 64 << 10;
+    /// @brief Output a connection may have pending before the server stops reading from it
+    const size_t max_pending_output = 1 << 20;
+
+    /// @brief State of one socket in the event loop
+    struct Connection {
+        int fd;
+        Kind kind;
+        /// @brief Received bytes of a protocol connection not forming a complete frame yet
+        string input;
+        /// @brief Bytes waiting to be written, from sent on
+        string output;
+        size_t sent = 0;
+        /// @brief Screens of a session connection
+        unique_ptr<ClientSession> session;
+        /// @brief Client logged in on a protocol connection, the bookings and cancellations of the connection are made as this client
+        string client_ID;
+        /// @brief Close once the pending output is written
+        bool closing = false;
+        /// @brief Events the socket is registered for
+        uint32_t events = 0;
+    };
+
+    int epoll_fd = -1;
+    unordered_map<int, unique_ptr<Connection>> connections;
+    /// @brief Connections closed while handling the current batch of events, freed after it
+    vector<unique_ptr<Connection>> closed;
+
+    void closeConnection(Connection* connection) {
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, connection->fd, nullptr);
+        close(connection->fd);
+        auto it = connections.find(connection->fd);
+        closed.push_back(move(it->second));
+        connections.erase(it);
+    }
+
+    /// @brief Registers for reading unless too much output piles up, and for writing while output is pending
+    void updateEvents(Connection* connection) {
+        size_t pending = connection->output.length() - connection->sent;
+        uint32_t events = 0;
+        if (!connection->closing && pending < max_pending_output)
+            events |= EPOLLIN;
+        if (pending > 0)
+            events |= EPOLLOUT;
+        if (events == connection->events)
+            return;
+        epoll_event event = {};
+        event.events = events;
+        event.data.ptr = connection;
+        epoll_ctl(epoll_fd, EPOLL_CTL_MOD, connection->fd, &event);
+        connection->events = events;
+    }
+
+    /// @brief Adds a socket to the event loop
+    Connection* addConnection(int fd, Kind kind) {
+        unique_ptr<Connection> connection = make_unique<Connection>();
+        connection->fd = fd;
+        connection->kind = kind;
+        connection->events = EPOLLIN;
+        epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.ptr = connection.get();
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0) {
+            close(fd);
+            return nullptr;
+        }
+        Connection* added = connection.get();
+        connections[fd] = move(connection);
+        return added;
+    }
+
+    /// @brief Writes as much pending output as the socket takes
+    void flush(Connection* connection) {
+        while (connection->sent < connection->output.length()) {
+            ssize_t written = write(connection->fd, connection->output.data() + connection->sent, connection->output.length() - connection->sent);
+            if (written < 0 && errno == EINTR)
+                continue;
+            if (written < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                break;
+            if (written <= 0) {
+                closeConnection(connection);
+                return;
+            }
+            connection->sent += written;
+        }
+        if (connection->sent == connection->output.length()) {
+            connection->output.clear();
+            connection->sent = 0;
+            if (connection->closing) {
+                closeConnection(connection);
+                return;
+            }
+        }
+        updateEvents(connection);
+    }
+
+    /// @brief Serves every complete request frame received on a protocol connection
+    /// @return False if the connection sent an oversized frame
+    bool serveFrames(Connection* connection) {
+        size_t consumed = 0, size;
+        while (true) {
+            string_view rest = string_view(connection->input).substr(consumed);
+            if (!Protocol::peekFrame(rest, max_request, size))
+                return false;
+            if (size == 0)
+                break;
+            Protocol::Writer response;
+            Protocol::Status status = service.handle((uint8_t) rest[4], string(rest.substr(5, size - 5)), response, connection->client_ID);
+            Protocol::appendFrame(connection->output, status, response.bytes());
+            consumed += size;
+        }
+        connection->input.erase(0, consumed);
+        return true;
+    }
+
+    /// @brief Reads what arrived on a connection and serves it
+    void receive(Connection* connection) {
+        char buffer[16 << 10];
+        while (true) {
+            ssize_t got = read(connection->fd, buffer, sizeof(buffer));
+            if (got < 0 && errno == EINTR)
+                continue;
+            if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                break;
+            if (got <= 0) {
+                // The peer is done sending. A session still answers its last input before the socket is closed
+                if (connection->kind == SESSION) {
+                    connection->session->close();
+                    connection->output += connection->session->takeOutput();
+                }
+                connection->closing = true;
+                break;
+            }
+            if (connection->kind == PROTOCOL) {
+                connection->input.append(buffer, got);
+                if (!serveFrames(connection)) {
+                    cerr << "Closing a connection that sent an oversized request..." << endl;
+                    closeConnection(connection);
+                    return;
+                }
+            }
+            else {
+                connection->session->feed(string_view(buffer, got));
+                connection->output += connection->session->takeOutput();
+                if (connection->session->overflowing()) {
+                    closeConnection(connection);
+                    return;
+                }
+                if (connection->session->finished())
+                    connection->closing = true;
+            }
+            // Stop reading while the peer is not taking its output, it is read again once the output drained
+            if (connection->closing || connection->output.length() - connection->sent >= max_pending_output)
+                break;
+        }
+        flush(connection);
+    }
+
+    /// @brief Accepts every pending connection of a listener
+    void acceptAll(Connection* listener) {
+        while (true) {
+            int fd = accept4(listener->fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) {
+                if (errno == EINTR)
+                    continue;
+                if (errno != EAGAIN && errno != EWOULDBLOCK)
+                    cerr << "Error accepting a connection..." << endl;
+                return;
+            }
+            if (listener->kind == PROTOCOL_LISTENER) {
+                addConnection(fd, PROTOCOL);
+                continue;
+            }
+            Connection* connection = addConnection(fd, SESSION);
+            if (connection == nullptr)
+                continue;
+            connection->session = make_unique<ClientSession>(service);
+            connection->output = connection->session->takeOutput();
+            flush(connection);
+        }
+    }
+
+    /// @brief Opens a listening socket, replacing the socket file left behind by a server that is gone
+    /// @return Listening socket or -1 on failure
+    int listenOn(const string &path) {
+        sockaddr_un address = {};
+        address.sun_family = AF_UNIX;
+        if (path.length() >= sizeof(address.sun_path)) {
+            cerr << "Error: socket path " << path << " is too long..." << endl;
+            return -1;
+        }
+        strcpy(address.sun_path, path.c_str());
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            cerr << "Error creating socket..." << endl;
+            return -1;
+        }
+        // A socket file nobody answers on is stale, one that answers belongs to a running server
+        if (connect(fd, (sockaddr*) &address, sizeof(address)) == 0 || errno == EAGAIN) {
+            cerr << "Error: a booking server is already running on " << path << "..." << endl;
+            close(fd);
+            return -1;
+        }
+        unlink(path.c_str());
+        if (bind(fd, (sockaddr*) &address, sizeof(address)) != 0 || listen(fd, SOMAXCONN) != 0) {
+            cerr << "Error listening on " << path << "..." << endl;
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+}
+
+using namespace BookingServer;
+
+int main() {
+    // Tracing starts here when TRACE_FILE is set, the trace is written at exit
+    Trace::enabled();
+
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    int protocol_listener = listenOn(Protocol::socket_path);
+    int session_listener = protocol_listener < 0 ? -1 : listenOn(ClientSession::socket_path);
+    if (epoll_fd < 0 || protocol_listener < 0 || session_listener < 0) {
+        if (protocol_listener >= 0)
+            unlink(Protocol::socket_path.c_str());
+        return 1;
+    }
+    addConnection(protocol_listener, PROTOCOL_LISTENER);
+    addConnection(session_listener, SESSION_LISTENER);
+
+    // Every session is a socket, so allow as many as the hard limit
+    rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    // Interrupted waits return so the server can clean up, and a peer that closes mid-response must not kill the server
+    struct sigaction action = {};
+    action.sa_handler = stop;
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+    signal(SIGPIPE, SIG_IGN);
+
+    auto start = chrono::steady_clock::now();
+    service.load();
+    cout << "Loaded SaveData in " << chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() << " ms, listening on "
+        << Protocol::socket_path << " and " << ClientSession::socket_path << endl;
+
+    epoll_event events[256];
+    while (!stopping) {
+        int count = epoll_wait(epoll_fd, events, 256, -1);
+        if (count < 0) {
+            if (errno != EINTR) {
+                cerr << "Error waiting for events..." << endl;
+                break;
+            }
+            continue;
+        }
+        for (int i = 0; i < count; i++) {
+            Connection* connection = (Connection*) events[i].data.ptr;
+            // Skip events of connections closed earlier in this batch
+            bool gone = false;
+            for (int j = 0; j < closed.size() && !gone; j++)
+                gone = closed[j].get() == connection;
+            if (gone)
+                continue;
+            if (connection->kind == PROTOCOL_LISTENER || connection->kind == SESSION_LISTENER)
+                acceptAll(connection);
+            else if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+                receive(connection);
+            else if (events[i].events & EPOLLOUT)
+                flush(connection);
+        }
+        closed.clear();
+    }
+
+    connections.clear();
+    unlink(Protocol::socket_path.c_str());
+    unlink(ClientSession::socket_path.c_str());
+    Stats::dumpAtExit();
+    cout << "Booking server stopped..." << endl;
+    return 0;
+}
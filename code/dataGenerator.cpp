@@ -0,0 +1,295 @@
+#include <iostream>
+#include <chrono>
+#include <cstring>
+#include "Flight.h"
+#include "Client.h"
+#include "Column.h"
+
+using namespace std;
+
+/// @brief Fills SaveData with a synthetic data set of any size.
+/// Every run with the same counts and seed writes the same records. Flights and their bookings are written
+/// one flight at a time, so the data set can be much larger than memory.
+namespace DataGenerator {
+
+    /// @brief Small and fast pseudo random generator (xoshiro256**), seeded with splitmix64.
+    /// <random> is not used since its <cmath> defines a NAN macro that clashes with the airport codes
+    class Random {
+        private:
+        uint64_t state[4];
+
+        static uint64_t rotate(uint64_t x, int k) {
+            return (x << k) | (x >> (64 - k));
+        }
+
+        public:
+        Random(uint64_t seed) {
+            for (int i = 0; i < 4; i++) {
+                seed += 0x9e3779b97f4a7c15ULL;
+                uint64_t z = seed;
+                z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+                z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+                state[i] = z ^ (z >> 31);
+            }
+        }
+
+        /// @brief Next 64 random bits
+        uint64_t next() {
+            uint64_t result = rotate(state[1] * 5, 7) * 9;
+            uint64_t t = state[1] << 17;
+            state[2] ^= state[0];
+            state[3] ^= state[1];
+            state[1] ^= state[2];
+            state[0] ^= state[3];
+            state[2] ^= t;
+            state[3] = rotate(state[3], 45);
+            return result;
+        }
+
+        /// @brief Random integer from 0 to bound - 1
+        uint64_t below(uint64_t bound) {
+            return (uint64_t) (((unsigned __int128) next() * bound) >> 64);
+        }
+
+        /// @brief Random integer from low to high, both included
+        int between(int low, int high) {
+            return low + (int) below(high - low + 1);
+        }
+
+        /// @brief Random number from 0 (included) to 1 (excluded)
+        double fraction() {
+            return (next() >> 11) * (1.0 / 9007199254740992.0);
+        }
+    };
+
+    /// @brief Aircraft types the fleet is drawn from, with the [rows, columns] of each seating category
+    struct PlaneModel {
+        const char* name;
+        vector<vector<int>> dimensions;
+    };
+
+    const PlaneModel models[] = {
+        {"Airbus A320", {{3, 4}, {26, 6}}},
+        {"Airbus A321neo", {{5, 4}, {30, 6}}},
+        {"Boeing 737-800", {{4, 4}, {27, 6}}},
+        {"Boeing 787-9", {{7, 4}, {6, 7}, {30, 9}}},
+        {"Airbus A350-900", {{8, 4}, {4, 8}, {32, 9}}},
+        {"Boeing 777-300ER", {{2, 4}, {10, 6}, {40, 10}}},
+        {"Airbus A380-800", {{3, 4}, {16, 6}, {50, 10}}},
+    };
+    const int num_models = sizeof(models) / sizeof(models[0]);
+
+    /// @brief Busy airports in order of traffic. Routes pick them with a Zipf-like weight, so a few hubs get most flights
+    const char* hubs[] = {
+        "ATL", "DXB", "DFW", "LHR", "HND", "DEN", "IST", "LAX", "ORD", "DEL", "CDG", "JFK", "CAN", "AMS", "FRA",
+        "SIN", "ICN", "MAD", "BCN", "PEK", "PVG", "BKK", "SFO", "SEA", "MIA", "YYZ", "SYD", "DOH", "MUC", "KUL",
+        "HKG", "CGK", "MEX", "GRU", "JNB", "NRT", "LAS", "MCO", "CLT", "PHX", "FCO", "ZRH", "VIE", "CPH", "OSL",
+        "ARN", "DUB", "LIS", "BOM", "AUH", "KHI", "LHE", "ISB", "CAI", "NBO"
+    };
+
+    const char* first_names[] = {"James", "Mary", "Ahmed", "Fatima", "Wei", "Mei", "Carlos", "Sofia", "Ivan", "Olga", "Kenji", "Yuki", "Omar", "Aisha", "Lucas", "Emma", "Ravi", "Priya", "Noah", "Chloe"};
+    const char* last_names[] = {"Smith", "Khan", "Wang", "Garcia", "Ivanov", "Tanaka", "Hassan", "Silva", "Muller", "Patel", "Brown", "Kim", "Rossi", "Dubois", "Nguyen", "Cohen"};
+    const char* domains[] = {"gmail.com", "yahoo.com", "outlook.com", "mail.com"};
+
+    /// @brief First day flights depart on
+    const DateTime first_day(2025, 1, 1);
+
+    /// @brief Settings of one run
+    struct Settings {
+        int planes = 50;
+        long flights = 10000;
+        long clients = 10000;
+        long bookings = 100000;
+        uint64_t seed = 1;
+        int days = 365;
+        RecordFile::Format format = RecordFile::CSV;
+    };
+
+    /// @brief Picks an index with weight 1 / (index + 1)
+    /// @param cumulative Running sum of the weights
+    int pickWeighted(Random &random, const vector<double> &cumulative) {
+        double target = random.fraction() * cumulative.back();
+        return upper_bound(cumulative.begin(), cumulative.end(), target) - cumulative.begin();
+    }
+
+    /// @brief Formats a price the way Flight stores it
+    string price(double value) {
+        return to_string((double) (long) value);
+    }
+
+    /// @brief Writes the planes
+    /// @return Model of every plane
+    vector<int> writePlanes(const Settings &settings, Random &random, bool &written) {
+        vector<int> fleet;
+        RecordFile::Writer writer(Airplane::getSavePath(), settings.format);
+        for (int i = 0; i < settings.planes; i++) {
+            int model = random.below(num_models);
+            fleet.push_back(model);
+            vector<string> fields = {to_string(i), models[model].name, to_string(models[model].dimensions.size())};
+            for (const vector<int> &dimension : models[model].dimensions)
+                fields.push_back(to_string(dimension[0]) + ' ' + to_string(dimension[1]));
+            writer.add(fields);
+        }
+        written = writer.finish();
+        return fleet;
+    }
+
+    /// @brief Writes the flights together with the bookings of their seats
+    /// @return Number of bookings written
+    long writeFlights(const Settings &settings, Random &random, const vector<int> &fleet, const vector<Airport> &airports, bool &written) {
+        vector<double> cumulative;
+        for (int i = 0; i < airports.size(); i++)
+            cumulative.push_back((cumulative.empty() ? 0 : cumulative.back()) + 1.0 / (i + 1));
+
+        RecordFile::Writer flight_writer(Flight::getSavePath(), settings.format);
+        RecordFile::Writer record_writer(Record::getSavePath(), settings.format);
+        long records = 0;
+        vector<int> seats;
+        for (long i = 0; i < settings.flights; i++) {
+            int plane = random.below(fleet.size());
+            const PlaneModel &model = models[fleet[plane]];
+            int origin = pickWeighted(random, cumulative), destination;
+            do {
+                destination = pickWeighted(random, cumulative);
+            } while (destination == origin);
+            DateTime depart(first_day.getMinutes() + (int32_t) random.below(settings.days) * 1440 + random.between(5, 23) * 60 + random.between(0, 11) * 5);
+            int duration = random.between(12, 180) * 5;
+            DateTime arrive(depart.getMinutes() + duration);
+
+            vector<string> fields = {to_string(i), to_string(plane), DateTime_to_date_time(depart), DateTime_to_date_time(arrive), Airport_to_String(airports[origin]), Airport_to_String(airports[destination])};
+            // Economy is priced by duration, higher categories are multiples of it
+            double economy = 40 + duration * (0.8 + random.fraction() * 0.6);
+            int num_categories = model.dimensions.size();
+            for (int c = 0; c < num_categories; c++) {
+                int multiple = num_categories - 1 - c;
+                fields.push_back(price(economy * (multiple == 0 ? 1 : multiple == 1 ? 3.5 : 7)));
+            }
+
+            // Bookings are spread evenly over the remaining flights with some flights fuller than others
+            int capacity = 0;
+            for (int c = 0; c < num_categories; c++)
+                capacity += model.dimensions[c][0] * model.dimensions[c][1];
+            long remaining = settings.clients > 0 ? settings.bookings - records : 0;
+            long average = remaining / (settings.flights - i);
+            int booked = min((long) capacity, (long) (average * (0.5 + random.fraction())));
+            if (i == settings.flights - 1)
+                booked = min((long) capacity, remaining);
+
+            // Partial shuffle picks the booked seats without repeats
+            seats.resize(capacity);
+            for (int s = 0; s < capacity; s++)
+                seats[s] = s;
+            for (int s = 0; s < booked; s++)
+                swap(seats[s], seats[s + random.below(capacity - s)]);
+            vector<string> seat_strings;
+            for (int c = 0; c < num_categories; c++)
+                seat_strings.push_back(string(model.dimensions[c][0] * model.dimensions[c][1], '0'));
+            for (int s = 0; s < booked; s++) {
+                int category = 0, index = seats[s];
+                while (index >= seat_strings[category].length())
+                    index -= seat_strings[category++].length();
+                seat_strings[category][index] = '1';
+                int cols = model.dimensions[category][1];
+                string seat_ID = to_string(i) + '-' + to_string(category) + Col_to_String((Column) (index % cols)) + to_string(index / cols);
+                record_writer.add({to_string(records++), seat_ID, to_string(random.below(settings.clients)), DateTime_to_date(depart)});
+            }
+            for (int c = 0; c < num_categories; c++)
+                fields.push_back(seat_strings[c]);
+            flight_writer.add(fields);
+        }
+        written = flight_writer.finish() && record_writer.finish();
+        return records;
+    }
+
+    /// @brief Writes the clients
+    void writeClients(const Settings &settings, Random &random, bool &written) {
+        RecordFile::Writer writer(Client::getSavePath(), settings.format);
+        int num_first = sizeof(first_names) / sizeof(first_names[0]), num_last = sizeof(last_names) / sizeof(last_names[0]);
+        const char alphabet[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+        for (long i = 0; i < settings.clients; i++) {
+            int first = random.below(num_first), last = random.below(num_last);
+            string name = string(first_names[first]) + ' ' + last_names[last];
+            string handle = string(first_names[first]) + '.' + last_names[last] + to_string(i);
+            for (char &c : handle)
+                c = tolower(c);
+            char passport_ID[10];
+            snprintf(passport_ID, sizeof(passport_ID), "P%08d", (int) random.below(100000000));
+            DateTime DoB(random.between(1940, 2006), random.between(1, 12), random.between(1, 28));
+            DateTime DoI(random.between(2015, 2024), random.between(1, 12), random.between(1, 28));
+            DateTime DoE(DoI.getYear() + 10, DoI.getMonth(), DoI.getDay());
+            char sex = random.below(2) == 0 ? 'M' : 'F';
+            string password;
+            for (int c = 0; c < 10; c++)
+                password += alphabet[random.below(sizeof(alphabet) - 1)];
+            writer.add({
+                to_string(i), name, passport_ID, to_string('P'), name, CountryEnum_to_string((CountryEnum) random.below(Country::size)),
+                DateTime_to_date(DoB), DateTime_to_date(DoI), DateTime_to_date(DoE), to_string(sex),
+                handle + '@' + domains[random.below(4)], to_string(1000000000L + (long) random.below(9000000000L)), handle, password
+            });
+        }
+        written = writer.finish();
+    }
+
+    /// @brief Reads a count from the command line
+    bool readCount(const char* arg, long &value) {
+        char* end;
+        value = strtol(arg, &end, 10);
+        return *end == '\0' && value >= 0;
+    }
+}
+
+using namespace DataGenerator;
+
+int main(int argc, char* argv[]) {
+    Settings settings;
+    long values[6] = {settings.planes, settings.flights, settings.clients, settings.bookings, (long) settings.seed, settings.days};
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "block") == 0)
+            settings.format = RecordFile::BLOCK;
+        else if (strcmp(argv[i], "csv") == 0)
+            settings.format = RecordFile::CSV;
+        else if (i > 6 || !readCount(argv[i], values[i - 1])) {
+            cerr << "Usage: ./dataGenerator [planes=50] [flights=10000] [clients=10000] [bookings=100000] [seed=1] [days=365] [csv|block]" << endl;
+            return 1;
+        }
+    }
+    settings.planes = values[0];
+    settings.flights = values[1];
+    settings.clients = values[2];
+    settings.bookings = values[3];
+    settings.seed = values[4];
+    settings.days = values[5];
+    if (settings.flights > 0 && (settings.planes == 0 || settings.days == 0)) {
+        cerr << "Error: flights need at least one plane and one day..." << endl;
+        return 1;
+    }
+
+    vector<Airport> airports;
+    for (const char* code : hubs) {
+        Airport airport;
+        if (string_to_Airport(code, airport))
+            airports.push_back(airport);
+    }
+
+    auto start = chrono::steady_clock::now();
+    Random random(settings.seed);
+    bool planes_written, flights_written, clients_written;
+    vector<int> fleet = writePlanes(settings, random, planes_written);
+    long bookings = writeFlights(settings, random, fleet, airports, flights_written);
+    writeClients(settings, random, clients_written);
+    if (!planes_written || !flights_written || !clients_written) {
+        cerr << "Error writing SaveData..." << endl;
+        return 1;
+    }
+
+    // Journal entries and the snapshot belong to the old data
+    int journal = BookingJournal::lock();
+    if (journal >= 0)
+        BookingJournal::clearAndUnlock(journal);
+    remove(Snapshot::getSavePath().c_str());
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << "Wrote " << settings.planes << " planes, " << settings.flights << " flights, " << settings.clients << " clients and " << bookings << " bookings ("
+        << RecordFile::formatName(settings.format) << " format, seed " << settings.seed << ") in " << seconds << " s" << endl;
+    return 0;
+}
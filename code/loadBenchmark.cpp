@@ -0,0 +1,235 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <filesystem>
+#include <unistd.h>
+#include "ParallelLoader.h"
+
+using namespace std;
+
+/// @brief Measures how many storage file lines per second the loaders parse.
+/// Generates storage files in a temporary directory, then compares the old getline/stringstream/stoi parsing
+/// with the shared tokenizer, times the full loadAll of every class in both storage formats
+/// and times the parallel startup loader with different numbers of workers.
+namespace LoadBenchmark {
+
+    const string paths[] = {"SaveData/Airplanes.csv", "SaveData/Flights.csv", "SaveData/Clients.csv", "SaveData/Records.csv"};
+    const string names[] = {"Airplanes", "Flights", "Clients", "Records"};
+    const int num_files = 4;
+
+    /// @brief Lines written to each storage file
+    size_t line_counts[num_files];
+
+    /// @brief Seconds since start
+    double seconds(chrono::steady_clock::time_point start) {
+        return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    }
+
+    /// @brief Writes the storage files
+    /// @param count Number of flights, clients and records
+    void generate(int count) {
+        int num_planes = 50;
+        vector<vector<string>> lines;
+        for (int i = 0; i < num_planes; i++)
+            lines.push_back({to_string(i), "Model " + to_string(i), "2", "5 4", "30 6"});
+        line_counts[0] = lines.size();
+        RecordFile::rewrite(paths[0], lines, RecordFile::CSV);
+
+        lines.clear();
+        const char* airports[] = {"DXB", "LHR", "JFK", "CDG", "SIN", "HND"};
+        for (int i = 0; i < count; i++) {
+            char depart[17], arrive[17];
+            snprintf(depart, sizeof(depart), "%02d:%02d %02d/%02d/2024", i % 24, i % 60, i % 28 + 1, i % 12 + 1);
+            snprintf(arrive, sizeof(arrive), "%02d:%02d %02d/%02d/2024", (i + 7) % 24, i % 60, i % 28 + 1, i % 12 + 1);
+            string business(20, '0'), economy(180, '0');
+            for (int s = i % 7; s < economy.length(); s += 7)
+                economy[s] = '1';
+            lines.push_back({to_string(i), to_string(i % num_planes), depart, arrive, airports[i % 6], airports[(i + 1) % 6], "1250.000000", "320.500000", business, economy});
+        }
+        line_counts[1] = lines.size();
+        RecordFile::rewrite(paths[1], lines, RecordFile::CSV);
+
+        lines.clear();
+        for (int i = 0; i < count; i++) {
+            string name = "Client Name " + to_string(i);
+            lines.push_back({to_string(i), name, "P" + to_string(1000000 + i), "80", name, "Canada", "01/01/1990", "01/01/2020", "01/01/2030", "77",
+                "client" + to_string(i) + "@mail.com", to_string(5550000000L + i), "user" + to_string(i), "password" + to_string(i)});
+        }
+        line_counts[2] = lines.size();
+        RecordFile::rewrite(paths[2], lines, RecordFile::CSV);
+
+        lines.clear();
+        for (int i = 0; i < count; i++)
+            lines.push_back({to_string(i), to_string(i) + "-1" + Col_to_String((Column) (i % 6)) + to_string(i % 30), to_string(i), "15/03/2024"});
+        line_counts[3] = lines.size();
+        RecordFile::rewrite(paths[3], lines, RecordFile::CSV);
+    }
+
+    /// @brief Parses a CSV storage file the way the loaders used to: a string per line and per field, decrypted one field at a time and converted with stoi
+    /// @return Sum of the IDs, so the work cannot be optimized away
+    long legacyParse(const string &path) {
+        ifstream reader(path);
+        string temp;
+        long sum = 0;
+        while (getline(reader, temp)) {
+            stringstream s_stream(temp);
+            bool first = true;
+            while (getline(s_stream, temp, ',')) {
+                string field(SaveItem::maxDecryptedLength(temp.length()), '\0');
+                field.resize(SaveItem::decryptInto(temp.data(), temp.length(), &field[0]));
+                if (first)
+                    sum += stoi(field);
+                first = false;
+            }
+        }
+        return sum;
+    }
+
+    /// @brief Parses a storage file with the shared tokenizer
+    /// @return Sum of the IDs, so the work cannot be optimized away
+    long tokenizerParse(const string &path) {
+        string plain;
+        RecordFile::readPlain(path, 0, plain);
+        Tokenizer lines(plain, RecordFile::record_separator);
+        string_view line, field;
+        long sum = 0;
+        while (lines.next(line)) {
+            if (line.empty())
+                continue;
+            Tokenizer fields(line, RecordFile::field_separator);
+            int ID = 0;
+            fields.nextInt(ID);
+            sum += ID;
+            while (fields.next(field));
+        }
+        return sum;
+    }
+
+    /// @brief Times a function over one storage file and prints lines per second
+    template <class F>
+    void measure(const string &label, int file, int repetitions, F run) {
+        run();
+        auto start = chrono::steady_clock::now();
+        for (int i = 0; i < repetitions; i++)
+            run();
+        double elapsed = seconds(start) / repetitions;
+        cout << left << setw(28) << label << setw(12) << names[file] << right << setw(14) << fixed << setprecision(0) << line_counts[file] / elapsed << " lines/s" << endl;
+    }
+
+    /// @brief Times the full loadAll of every class
+    void measureLoaders(const string &format, int repetitions) {
+        vector<Airplane> planes;
+        vector<Flight> flights;
+        vector<Client> clients;
+        measure("loadAll (" + format + ")", 0, repetitions, [&]() { planes = Airplane::loadAll(); });
+        measure("loadAll (" + format + ")", 1, repetitions, [&]() { flights = Flight::loadAll(planes); });
+        measure("loadAll (" + format + ")", 2, repetitions, [&]() { clients = Client::loadAll(); });
+        IdRegistry<Flight> flight_registry(flights);
+        measure("loadAll (" + format + ")", 3, repetitions, [&]() {
+            Record::loadAll(clients, [&](const string &ID) -> Inventory* { return Flight::findSeatfromID(ID, flight_registry); });
+        });
+    }
+
+    /// @brief Describes every loaded object in one string, to check that two loads give the same result
+    string describe(vector<Airplane> &planes, vector<Flight> &flights, vector<Client> &clients, vector<Record> &records) {
+        string description;
+        for (int i = 0; i < planes.size(); i++) {
+            description += planes[i].getID() + ' ' + to_string(planes[i].getNumCategories());
+            for (const vector<int> &dimension : planes[i].getDimensions())
+                description += ' ' + to_string(dimension[0]) + 'x' + to_string(dimension[1]);
+            description += '\n';
+        }
+        for (int i = 0; i < flights.size(); i++) {
+            for (const string &field : flights[i].toFields())
+                description += field + ' ';
+            description += '\n';
+        }
+        for (int i = 0; i < clients.size(); i++) {
+            Passport passport = clients[i].getPassport();
+            description += clients[i].getID() + ' ' + clients[i].getName() + ' ' + clients[i].getEmail() + ' ' + to_string(clients[i].getPhone()) + ' ' + clients[i].getUsername() + ' ';
+            description += passport.getID() + ' ' + CountryEnum_to_string(passport.getCountry()) + ' ' + DateTime_to_date(passport.getDoB()) + ' ' + DateTime_to_date(passport.getDoE()) + '\n';
+        }
+        for (int i = 0; i < records.size(); i++)
+            description += records[i].getID() + ' ' + records[i].getInventory()->getID() + ' ' + records[i].getClient()->getID() + ' ' + DateTime_to_date(records[i].getReserevationDate()) + '\n';
+        return description;
+    }
+
+    /// @brief Times loading all four storage files one after another and with the parallel loader
+    void measureStartup(int repetitions) {
+        vector<Airplane> planes;
+        vector<Flight> flights;
+        vector<Client> clients;
+        vector<Record> records;
+        auto sequential = [&]() {
+            planes = Airplane::loadAll();
+            flights = Flight::loadAll(planes);
+            clients = Client::loadAll();
+            IdRegistry<Flight> flight_registry(flights);
+            records = Record::loadAll(clients, [&](const string &ID) -> Inventory* { return Flight::findSeatfromID(ID, flight_registry); });
+        };
+        sequential();
+        string expected = describe(planes, flights, clients, records);
+        auto start = chrono::steady_clock::now();
+        for (int i = 0; i < repetitions; i++)
+            sequential();
+        double sequential_time = seconds(start) / repetitions;
+        cout << left << setw(28) << "sequential loadAll" << right << setw(12) << fixed << setprecision(1) << sequential_time * 1000 << " ms" << endl;
+
+        unsigned cores = max(1u, thread::hardware_concurrency());
+        for (unsigned workers = 1; workers <= 2 * cores || workers <= 4; workers *= 2) {
+            ParallelLoader::worker_count = workers;
+            ParallelLoader::loadFiles(&planes, &flights, &clients, &records);
+            bool identical = describe(planes, flights, clients, records) == expected;
+            start = chrono::steady_clock::now();
+            for (int i = 0; i < repetitions; i++)
+                ParallelLoader::loadFiles(&planes, &flights, &clients, &records);
+            double elapsed = seconds(start) / repetitions;
+            cout << left << setw(28) << "parallel (" + to_string(workers) + " workers)" << right << setw(12) << elapsed * 1000 << " ms"
+                << setw(8) << setprecision(2) << sequential_time / elapsed << "x" << (identical ? "" : "  RESULT DIFFERS FROM SEQUENTIAL LOAD") << endl;
+            cout << setprecision(1);
+        }
+        ParallelLoader::worker_count = 0;
+    }
+}
+
+using namespace LoadBenchmark;
+
+int main(int argc, char* argv[]) {
+    int count = argc > 1 ? atoi(argv[1]) : 20000;
+    int repetitions = argc > 2 ? atoi(argv[2]) : 5;
+
+    // Work in a temporary directory so real storage files are never touched
+    char directory[] = "/tmp/loadBenchmarkXXXXXX";
+    if (mkdtemp(directory) == nullptr || chdir(directory) != 0) {
+        cerr << "Error creating benchmark directory..." << endl;
+        return 1;
+    }
+    filesystem::create_directory("SaveData");
+    generate(count);
+
+    cout << "Parsing only (CSV format, " << count << " lines per file, " << repetitions << " repetitions)" << endl;
+    long legacy_sum = 0, tokenizer_sum = 0;
+    for (int i = 0; i < num_files; i++) {
+        measure("getline + stringstream", i, repetitions, [&]() { legacy_sum += legacyParse(paths[i]); });
+        measure("string_view tokenizer", i, repetitions, [&]() { tokenizer_sum += tokenizerParse(paths[i]); });
+    }
+    if (legacy_sum != tokenizer_sum)
+        cerr << "Parsers disagree..." << endl;
+
+    cout << endl << "Full loaders" << endl;
+    measureLoaders("CSV", repetitions);
+    for (int i = 0; i < num_files; i++)
+        RecordFile::migrate(paths[i], RecordFile::BLOCK);
+    measureLoaders("Block", repetitions);
+
+    cout << endl << "Startup, all files (" << thread::hardware_concurrency() << " cores)" << endl;
+    measureStartup(repetitions);
+    for (int i = 0; i < num_files; i++)
+        RecordFile::migrate(paths[i], RecordFile::CSV);
+    measureStartup(repetitions);
+
+    filesystem::remove_all(directory);
+    return 0;
+}
@@ -0,0 +1,133 @@
+#include <iostream>
+#include <fstream>
+#include "Benchmark.h"
+#include "Flight.h"
+#include "Column.h"
+
+using namespace std;
+
+/// @brief Micro benchmarks of the hot paths: the field codec, enum lookups, date conversions and seat operations.
+/// Usage: ./microBenchmark [output.json] [repetitions=30]
+namespace MicroBenchmark {
+
+    /// @brief Inputs are cycled through so no single value stays in the branch predictor
+    const int num_inputs = 64;
+
+    void codec(Benchmark &benchmark) {
+        vector<string> plain, encrypted;
+        for (int i = 0; i < num_inputs; i++) {
+            plain.push_back("Client Name " + to_string(i * 7919) + " <client" + to_string(i) + "@mail.com>");
+            string field(SaveItem::maxEncryptedLength(plain.back().length()), '\0');
+            field.resize(SaveItem::encryptInto(plain.back().data(), plain.back().length(), &field[0]));
+            encrypted.push_back(field);
+        }
+        // Buffers are sized once like the storage code does
+        string buffer(SaveItem::maxEncryptedLength(64), '\0');
+        int i = 0;
+        benchmark.run("SaveItem::encryptInto (40 chars)", [&]() {
+            const string &field = plain[i++ % num_inputs];
+            Benchmark::keep(SaveItem::encryptInto(field.data(), field.length(), &buffer[0]));
+        });
+        benchmark.run("SaveItem::decryptInto (40 chars)", [&]() {
+            const string &field = encrypted[i++ % num_inputs];
+            Benchmark::keep(SaveItem::decryptInto(field.data(), field.length(), &buffer[0]));
+        });
+    }
+
+    void enums(Benchmark &benchmark) {
+        vector<string> airports, countries, columns;
+        for (int i = 0; i < num_inputs; i++) {
+            airports.push_back(Airport_to_String((Airport) (i * 997 % AirportInfo::size)));
+            countries.push_back(CountryEnum_to_string((CountryEnum) (i * 37 % Country::size)));
+            columns.push_back(Col_to_String((Column) (i % ColumnInfo::size)));
+        }
+        int i = 0;
+        benchmark.run("AirportInfo::string_to_Airport", [&]() {
+            Airport airport;
+            Benchmark::keep(string_to_Airport(airports[i++ % num_inputs], airport));
+            Benchmark::keep(airport);
+        });
+        benchmark.run("Country::string_to_CountryEnum", [&]() { Benchmark::keep(string_to_CountryEnum(countries[i++ % num_inputs])); });
+        benchmark.run("ColumnInfo::string_to_Column", [&]() { Benchmark::keep(string_to_Column(columns[i++ % num_inputs])); });
+    }
+
+    void dates(Benchmark &benchmark) {
+        vector<string> dates, times;
+        vector<DateTime> values;
+        for (int i = 0; i < num_inputs; i++) {
+            values.push_back(DateTime(1990 + i % 40, i % 12 + 1, i % 28 + 1, i % 24, i % 60));
+            dates.push_back(DateTime_to_date(values.back()));
+            times.push_back(DateTime_to_date_time(values.back()).substr(0, 5));
+        }
+        int i = 0;
+        DateTime date;
+        benchmark.run("Conversions::date_to_DateTime", [&]() { Benchmark::keep(date_to_DateTime(dates[i++ % num_inputs], date)); });
+        benchmark.run("Conversions::date_time_to_DateTime", [&]() {
+            int n = i++ % num_inputs;
+            Benchmark::keep(date_time_to_DateTime(dates[n], times[n], date));
+        });
+        benchmark.run("Conversions::DateTime_to_date", [&]() { Benchmark::keep(DateTime_to_date(values[i++ % num_inputs])); });
+        benchmark.run("Conversions::DateTime_to_date_time", [&]() { Benchmark::keep(DateTime_to_date_time(values[i++ % num_inputs])); });
+        benchmark.run("DateTime::formatDateTime (buffer)", [&]() {
+            char buffer[DateTime::date_time_length];
+            Benchmark::keep(values[i++ % num_inputs].formatDateTime(buffer));
+            Benchmark::keep(buffer);
+        });
+    }
+
+    void seats(Benchmark &benchmark) {
+        // Wide body layout with three categories, a third of the seats taken
+        Airplane plane("0", "Benchmark", 3, {{3, 4}, {16, 6}, {50, 10}});
+        Flight flight("0", &plane, DateTime(2025, 1, 1, 10, 0), DateTime(2025, 1, 1, 18, 0), DXB, LHR, {4000, 2000, 600});
+        for (int c = 0; c < 3; c++) {
+            vector<int> dimension = plane.getDimensions()[c];
+            for (int s = 0; s < dimension[0] * dimension[1]; s += 3)
+                flight.getSeat(c, s / dimension[1], s % dimension[1])->Reserve();
+        }
+        vector<string> states = flight.getAllSeatStates();
+        benchmark.run("Flight::getAllSeatStates (624 seats)", [&]() { Benchmark::keep(flight.getAllSeatStates()); });
+        benchmark.run("Flight::AssignSeatStatesfromStrings", [&]() {
+            flight.AssignSeatStatesfromStrings(states);
+            Benchmark::keep(flight);
+        });
+
+        vector<Seat*> seats;
+        for (int row = 0; row < 50; row++)
+            seats.push_back(flight.getSeat(2, row, row % 10));
+        int i = 0;
+        benchmark.run("Seat::Reserve + Cancel", [&]() {
+            Seat* seat = seats[i++ % seats.size()];
+            Benchmark::keep(seat->Reserve());
+            seat->Cancel();
+        });
+        benchmark.run("Flight::getSeat (existing)", [&]() {
+            int row = i++ % 50;
+            Benchmark::keep(flight.getSeat(2, row, row % 10));
+        });
+    }
+}
+
+using namespace MicroBenchmark;
+
+int main(int argc, char* argv[]) {
+    string output = argc > 1 ? argv[1] : "";
+    int repetitions = argc > 2 ? atoi(argv[2]) : 30;
+
+    Benchmark benchmark("microBenchmark", 5, repetitions);
+    benchmark.printHeader(cout);
+    codec(benchmark);
+    enums(benchmark);
+    dates(benchmark);
+    seats(benchmark);
+
+    if (!output.empty()) {
+        ofstream writer(output);
+        if (writer.fail()) {
+            cerr << "Error writing " << output << "..." << endl;
+            return 1;
+        }
+        benchmark.writeJSON(writer);
+        cout << "Results written to " << output << endl;
+    }
+    return 0;
+}
@@ -0,0 +1,384 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <filesystem>
+#include <thread>
+#include <atomic>
+#include <unordered_set>
+#include <unistd.h>
+#include "Booking.h"
+#include "Benchmark.h"
+
+using namespace std;
+
+/// @brief Stress test of concurrent seat reservation.
+/// race: all threads try to reserve every seat of one flight at once, each seat must have exactly one winner and the free seat counters
+/// and the availability index must match.
+/// scaling: threads reserve seats and allocate record IDs on different flights, the throughput should grow with the threads.
+/// groups: all threads seat groups of one to four travellers on one flight until it is full, no seat may go to two groups.
+/// booking: threads book different flights through the full booking path (record line and journal entry) in a temporary SaveData.
+/// Usage: ./reservationStress [threads=max(4, cores)] [rounds=200] [bookings=2000]
+namespace ReservationStress {
+
+    /// @brief Seat layout of the test plane, 196 seats over two categories
+    Airplane plane("0", "Stress", 2, {{4, 4}, {30, 6}});
+
+    /// @brief Number of seats of a flight
+    int capacity(const Flight &flight) {
+        return flight.getSeatMap()->getTotalCapacity();
+    }
+
+    /// @brief Creates flights with empty seat maps, IDs starting at 0
+    vector<Flight> makeFlights(int count) {
+        vector<Flight> flights;
+        for (int i = 0; i < count; i++)
+            flights.push_back(Flight(to_string(i), &plane, DateTime(2025, 1, 1 + i % 28, 8, 0), DateTime(2025, 1, 1 + i % 28, 11, 0), DXB, LHR, {1200, 300}));
+        return flights;
+    }
+
+    /// @brief Frees every seat of the flights
+    void clearSeats(vector<Flight> &flights) {
+        vector<uint64_t> empty(Flight::countSeatWords(&plane), 0);
+        for (int i = 0; i < flights.size(); i++)
+            flights[i].AssignSeatStatesfromWords(empty.data());
+    }
+
+    /// @brief Runs a function on several threads that all start at the same time
+    /// @param threads Number of threads
+    /// @param work Called with the thread number
+    /// @return Seconds from the start until the last thread finished
+    template <typename F>
+    double runThreads(int threads, F work) {
+        atomic<int> ready{0};
+        atomic<bool> go{false};
+        vector<thread> workers;
+        for (int t = 0; t < threads; t++) {
+            workers.emplace_back([&, t]() {
+                ready++;
+                while (!go.load(memory_order_acquire))
+                    this_thread::yield();
+                work(t);
+            });
+        }
+        while (ready.load() < threads)
+            this_thread::yield();
+        auto start = chrono::steady_clock::now();
+        go.store(true, memory_order_release);
+        for (int t = 0; t < threads; t++)
+            workers[t].join();
+        return Booking::nanoseconds(start) / 1e9;
+    }
+
+    /// @brief Thread counts to measure: powers of two up to the maximum, and the maximum itself
+    vector<int> threadCounts(int max_threads) {
+        vector<int> counts;
+        for (int threads = 1; threads < max_threads; threads *= 2)
+            counts.push_back(threads);
+        counts.push_back(max_threads);
+        return counts;
+    }
+
+    /// @brief Checks that the availability index finds a flight for exactly the seat counts it has
+    bool indexAgrees(AvailabilityIndex &index, const Flight &flight) {
+        SeatMap* seat_map = flight.getSeatMap();
+        for (int category = 0; category < seat_map->getNumCategories(); category++) {
+            for (int count = 1; count <= AvailabilityIndex::levels[AvailabilityIndex::num_levels - 1]; count++) {
+                bool exact;
+                bool free_found = !index.find(nullptr, flight.getT_Depart(), 1, category, count, 0, exact).empty();
+                bool free_expected = seat_map->getFree(category) >= count;
+                bool together_found = !index.find(nullptr, flight.getT_Depart(), 1, category, 0, count, exact).empty();
+                bool together_expected = seat_map->longestFreeBlock(category) >= count;
+                // A count between two levels may find flights with fewer seats, but never miss one with enough
+                if ((free_expected && !free_found) || (together_expected && !together_found) || (exact && (free_found != free_expected || together_found != together_expected)))
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    /// @brief All threads race for every seat of one flight, in different orders
+    /// @return False if a seat had no winner or more than one
+    bool race(int threads, int rounds) {
+        AvailabilityIndex index;
+        vector<Flight> flights = makeFlights(1);
+        Flight &flight = flights[0];
+        index.add(0, flight.getOrigin(), flight.getT_Depart(), flight.getSeatMap());
+        int seats = capacity(flight);
+        vector<atomic<int>> owner(seats);
+        atomic<int> double_wins{0};
+        for (int round = 0; round < rounds; round++) {
+            for (int i = 0; i < seats; i++)
+                owner[i] = -1;
+            runThreads(threads, [&](int t) {
+                // Every thread walks the seats with a different stride, so threads collide on different seats each round
+                int stride = 2 * (t + round) + 1;
+                while (seats % stride == 0 || stride % seats == 0)
+                    stride += 2;
+                for (int n = 0, i = t; n < seats; n++, i = (i + stride) % seats) {
+                    int category, row, col;
+                    flight.getSeatMap()->seatAt(i, category, row, col);
+                    if (flight.getSeat(category, row, col)->Reserve() && owner[i].exchange(t) != -1)
+                        double_wins++;
+                }
+            });
+            if (flight.getSeatMap()->getTotalFree() != 0) {
+                cerr << "Error: " << flight.getSeatMap()->getTotalFree() << " seats counted free after round " << round << "..." << endl;
+                return false;
+            }
+            if (!indexAgrees(index, flight)) {
+                cerr << "Error: the availability index is out of date after round " << round << "..." << endl;
+                return false;
+            }
+            for (int i = 0; i < seats; i++) {
+                int category, row, col;
+                flight.getSeatMap()->seatAt(i, category, row, col);
+                if (owner[i] == -1 || !flight.isSeatReserved(category, row, col)) {
+                    cerr << "Error: seat " << i << " has no winner in round " << round << "..." << endl;
+                    return false;
+                }
+                flight.getSeat(category, row, col)->Cancel();
+            }
+            if (!indexAgrees(index, flight)) {
+                cerr << "Error: the availability index is out of date after cancelling round " << round << "..." << endl;
+                return false;
+            }
+        }
+        cout << "race: " << threads << " threads, " << rounds << " rounds of " << seats << " seats, "
+            << double_wins << " seats won twice" << endl;
+        return double_wins == 0;
+    }
+
+    /// @brief All threads fill one flight with groups through findSeatGroup and reserveGroup, falling back to single seats once groups no longer fit
+    /// @return False if a seat went to two groups, a group was partly reserved or the flight did not fill up
+    bool groups(int threads, int rounds) {
+        AvailabilityIndex index;
+        vector<Flight> flights = makeFlights(1);
+        Flight &flight = flights[0];
+        SeatMap* seat_map = flight.getSeatMap();
+        int seats = capacity(flight);
+        vector<atomic<int>> owner(seats);
+        atomic<int> double_wins{0}, groups_won{0};
+        for (int round = 0; round < rounds; round++) {
+            // Loading seat states is not watched, so the index starts over with the empty flight
+            clearSeats(flights);
+            index.clear();
+            index.add(0, flight.getOrigin(), flight.getT_Depart(), seat_map);
+            for (int i = 0; i < seats; i++)
+                owner[i] = -1;
+            atomic<int> seated{0};
+            runThreads(threads, [&](int t) {
+                for (int category = 0; category < seat_map->getNumCategories(); category++) {
+                    int size = 1 + (t + round) % 4;
+                    Airplane::SeatPreference preference = (Airplane::SeatPreference) (t % 3);
+                    while (true) {
+                        vector<pair<int, int>> group = flight.findSeatGroup(category, size, preference);
+                        if (group.empty() && size == 1)
+                            break;
+                        if (group.empty()) {
+                            size = 1;
+                            continue;
+                        }
+                        if (!seat_map->reserveGroup(category, group))
+                            continue;
+                        groups_won++;
+                        seated += group.size();
+                        for (int i = 0; i < group.size(); i++) {
+                            int n = group[i].first * seat_map->getCols(category) + group[i].second;
+                            for (int c = 0; c < category; c++)
+                                n += seat_map->getRows(c) * seat_map->getCols(c);
+                            if (owner[n].exchange(t) != -1)
+                                double_wins++;
+                        }
+                    }
+                }
+            });
+            if (seated != seats || seat_map->getTotalFree() != 0) {
+                cerr << "Error: " << seated << " of " << seats << " seats seated and " << seat_map->getTotalFree() << " counted free after round " << round << "..." << endl;
+                return false;
+            }
+            if (!indexAgrees(index, flight)) {
+                cerr << "Error: the availability index is out of date after group round " << round << "..." << endl;
+                return false;
+            }
+        }
+        cout << "groups: " << threads << " threads, " << rounds << " rounds, " << groups_won << " groups seated, " << double_wins << " seats won twice" << endl;
+        return double_wins == 0;
+    }
+
+    /// @brief Reserves every seat of the flights of each thread and allocates a record ID per seat, without touching the disk
+    void scaling(int max_threads) {
+        const int flights_per_thread = 512;
+        vector<Flight> flights = makeFlights(flights_per_thread * max_threads);
+        cout << endl << "scaling: reserve + record ID on different flights" << endl;
+        cout << setw(8) << "threads" << setw(16) << "seats/s" << setw(12) << "speedup" << setw(12) << "efficiency" << endl;
+        double base = 0;
+        for (int threads : threadCounts(max_threads)) {
+            clearSeats(flights);
+            int per_thread = flights.size() / threads;
+            atomic<long> booked{0};
+            double seconds = runThreads(threads, [&](int t) {
+                long count = 0;
+                for (int f = t * per_thread; f < (t + 1) * per_thread; f++) {
+                    SeatMap* seat_map = flights[f].getSeatMap();
+                    for (int c = 0; c < seat_map->getNumCategories(); c++)
+                        for (int row = 0; row < seat_map->getRows(c); row++)
+                            for (int col = 0; col < seat_map->getCols(c); col++) {
+                                if (seat_map->reserve(c, row, col)) {
+                                    Benchmark::keep(Record::allocateID());
+                                    count++;
+                                }
+                            }
+                }
+                booked += count;
+            });
+            double rate = booked / seconds;
+            if (base == 0)
+                base = rate;
+            cout << setw(8) << threads << setw(16) << fixed << setprecision(0) << rate << setw(12) << setprecision(2) << rate / base
+                << setw(11) << setprecision(0) << 100 * rate / base / threads << "%" << endl;
+        }
+    }
+
+    /// @brief Creates an empty SaveData holding only the test flights
+    /// @return False if the files cannot be written
+    bool resetSaveData(vector<Flight> &flights) {
+        error_code error;
+        filesystem::remove_all("SaveData", error);
+        filesystem::create_directory("SaveData", error);
+        for (const string &path : {Airplane::getSavePath(), Flight::getSavePath(), Client::getSavePath(), Record::getSavePath(), BookingJournal::getSavePath()}) {
+            ofstream writer(path);
+            if (writer.fail())
+                return false;
+        }
+        clearSeats(flights);
+        for (int i = 0; i < flights.size(); i++) {
+            if (!flights[i].save())
+                return false;
+        }
+        BookingJournal::readAll();
+        BookingJournal::forgetApplied();
+        Record::setCount(0);
+        return true;
+    }
+
+    /// @brief Books seats of different flights through Booking::bookFlightSeat and checks that no booking was lost or duplicated
+    /// @return False if the records or seats do not match the bookings
+    bool booking(int max_threads, int bookings) {
+        // Enough flights for a single thread to make all bookings on its share
+        vector<Flight> flights = makeFlights(1);
+        flights = makeFlights(max_threads * (bookings / capacity(flights[0]) + 1));
+        Client client("0", "Stress", Passport("P0", 'P', "Stress", (CountryEnum) 0, DateTime(1990, 1, 1), DateTime(2020, 1, 1), DateTime(2030, 1, 1), 'M'), "stress@mail.com", 0, "stress", "stress");
+        cout << endl << "booking: full booking path on different flights, " << bookings << " bookings" << endl;
+        cout << setw(8) << "threads" << setw(16) << "bookings/s" << setw(12) << "speedup" << endl;
+        double base = 0;
+        for (int threads : threadCounts(max_threads)) {
+            if (!resetSaveData(flights)) {
+                cerr << "Error creating the test SaveData..." << endl;
+                return false;
+            }
+            vector<Record> records;
+            records.reserve(bookings);
+            int per_thread = flights.size() / threads;
+            atomic<int> failed{0};
+            double seconds = runThreads(threads, [&](int t) {
+                int count = bookings / threads + (t < bookings % threads ? 1 : 0);
+                int f = t * per_thread, seat = 0;
+                for (int n = 0; n < count; n++) {
+                    if (seat == capacity(flights[f])) {
+                        f++;
+                        seat = 0;
+                    }
+                    int category, row, col;
+                    flights[f].getSeatMap()->seatAt(seat++, category, row, col);
+                    if (Booking::bookFlightSeat(flights, records, flights[f], &client, category, row, col) != Booking::BOOKED)
+                        failed++;
+                }
+            });
+
+            // Every booking must have one record with its own ID, one record line and one reserved seat
+            unordered_set<string> IDs;
+            for (int i = 0; i < records.size(); i++)
+                IDs.insert(records[i].getID());
+            vector<vector<string>> lines;
+            RecordFile::readAll(Record::getSavePath(), 0, lines);
+            int reserved = 0;
+            for (int i = 0; i < flights.size(); i++) {
+                for (int n = 0; n < capacity(flights[i]); n++) {
+                    int category, row, col;
+                    flights[i].getSeatMap()->seatAt(n, category, row, col);
+                    reserved += flights[i].isSeatReserved(category, row, col);
+                }
+            }
+            if (failed > 0 || records.size() != bookings || IDs.size() != bookings || lines.size() != bookings || reserved != bookings) {
+                cerr << "Error with " << threads << " threads: " << failed << " failed bookings, " << records.size() << " records, " << IDs.size()
+                    << " record IDs, " << lines.size() << " record lines and " << reserved << " reserved seats for " << bookings << " bookings..." << endl;
+                return false;
+            }
+            double rate = bookings / seconds;
+            if (base == 0)
+                base = rate;
+            cout << setw(8) << threads << setw(16) << fixed << setprecision(0) << rate << setw(12) << setprecision(2) << rate / base << endl;
+        }
+        return true;
+    }
+
+    /// @brief Books and cancels the seats of each thread over and over while the checkpoints the bookings trigger run.
+    /// A checkpoint must not replay journal entries of this process onto seats that changed again since
+    /// @return False if a booking or cancellation found its own seat in the wrong state
+    bool churn(int threads, int rounds) {
+        vector<Flight> flights = makeFlights(1);
+        Client client("0", "Stress", Passport("P0", 'P', "Stress", (CountryEnum) 0, DateTime(1990, 1, 1), DateTime(2020, 1, 1), DateTime(2030, 1, 1), 'M'), "stress@mail.com", 0, "stress", "stress");
+        if (!resetSaveData(flights)) {
+            cerr << "Error creating the test SaveData..." << endl;
+            return false;
+        }
+        vector<Record> records;
+        atomic<int> wrong{0};
+        int seats = capacity(flights[0]);
+        runThreads(threads, [&](int t) {
+            for (int round = 0; round < rounds; round++) {
+                for (bool book : {true, false}) {
+                    for (int n = t; n < seats; n += threads) {
+                        int category, row, col;
+                        flights[0].getSeatMap()->seatAt(n, category, row, col);
+                        Booking::Result result = book ? Booking::bookFlightSeat(flights, records, flights[0], &client, category, row, col)
+                            : Booking::cancelFlightSeat(flights, flights[0], &client, category, row, col);
+                        if (result != (book ? Booking::BOOKED : Booking::CANCELLED))
+                            wrong++;
+                    }
+                }
+            }
+        });
+        cout << endl << "churn: " << threads << " threads, " << rounds << " rounds of booking and cancelling every seat, " << wrong << " seats found in the wrong state" << endl;
+        return wrong == 0;
+    }
+}
+
+using namespace ReservationStress;
+
+int main(int argc, char* argv[]) {
+    int threads = argc > 1 ? atoi(argv[1]) : max(4, (int) thread::hardware_concurrency());
+    int rounds = argc > 2 ? atoi(argv[2]) : 200;
+    int bookings = argc > 3 ? atoi(argv[3]) : 2000;
+    if (threads < 1 || rounds < 1 || bookings < 1) {
+        cerr << "Usage: ./reservationStress [threads] [rounds] [bookings]" << endl;
+        return 1;
+    }
+
+    // Bookings are written to a temporary SaveData so no real data is touched
+    char directory[] = "/tmp/reservationStressXXXXXX";
+    if (mkdtemp(directory) == nullptr || chdir(directory) != 0) {
+        cerr << "Error creating a test directory..." << endl;
+        return 1;
+    }
+
+    bool passed = race(threads, rounds);
+    passed = groups(threads, rounds) && passed;
+    scaling(threads);
+    passed = booking(threads, bookings) && passed;
+    passed = churn(threads, max(1, rounds / 10)) && passed;
+
+    filesystem::remove_all(directory);
+    cout << endl << (passed ? "All checks passed" : "Checks FAILED") << endl;
+    return passed ? 0 : 1;
+}